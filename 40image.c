@@ -12,6 +12,17 @@
  *     If no file is given it will read from standard input. 
  *     Depending on the command given, it will then call a function
  *     to either compress or decompress the input. 
+ *     The -s option selects the staged (whole-image) version of
+ *     the codec instead of the streaming one, and -j sets the
+ *     number of threads the streaming codec uses. -w picks how
+ *     the compressed words are written: through stdio (the
+ *     default), with write, or into a memory map of the output
+ *     file, which must be open for reading and writing
+ *     (1<>file); with a plain > redirect mmap warns and uses
+ *     stdio. -a picks the arithmetic of the streaming codec:
+ *     float (the default) or fixed, its integer-only version.
+ *     -l picks how the staged codec lays out pixels: plain rows
+ *     (the default) or blocked, in cache-sized square blocks.
  *     
  *     Note
  *     If the given file is null, an unknown command is supplied,
@@ -22,6 +33,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdbool.h>
 
 #include <assert.h>
 #include <compress40.h>
@@ -35,25 +47,75 @@
 #include "quantize.h"
 #include "codeword.h"
 #include "dctrans.h"
+#include "codec40.h"
 
 static void (*compress_or_decompress)(FILE *input) = compress40;
 
 int main(int argc, char *argv[])
 {
     int i;
+    bool staged = false;
 
     for (i = 1; i < argc; i++) {
             if (strcmp(argv[i], "-c") == 0) {
                     compress_or_decompress = compress40;
             } else if (strcmp(argv[i], "-d") == 0) {
                     compress_or_decompress = decompress40;
+            } else if (strcmp(argv[i], "-s") == 0) {
+                    staged = true;
+            } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+                    int threads = atoi(argv[++i]);
+                    if (threads < 1) {
+                            fprintf(stderr, "%s: bad thread count '%s'\n",
+                                    argv[0], argv[i]);
+                            exit(1);
+                    }
+                    set_codec_threads(threads);
+            } else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+                    i++;
+                    if (strcmp(argv[i], "stdio") == 0) {
+                            set_word_output(WORDS_STDIO);
+                    } else if (strcmp(argv[i], "write") == 0) {
+                            set_word_output(WORDS_WRITE);
+                    } else if (strcmp(argv[i], "mmap") == 0) {
+                            set_word_output(WORDS_MMAP);
+                    } else {
+                            fprintf(stderr, "%s: bad word output '%s'\n",
+                                    argv[0], argv[i]);
+                            exit(1);
+                    }
+            } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+                    i++;
+                    if (strcmp(argv[i], "float") == 0) {
+                            set_codec_arithmetic(CODEC_FLOAT);
+                    } else if (strcmp(argv[i], "fixed") == 0) {
+                            set_codec_arithmetic(CODEC_FIXED);
+                    } else {
+                            fprintf(stderr, "%s: bad arithmetic '%s'\n",
+                                    argv[0], argv[i]);
+                            exit(1);
+                    }
+            } else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+                    i++;
+                    if (strcmp(argv[i], "plain") == 0) {
+                            set_pixel_layout(PIXELS_PLAIN);
+                    } else if (strcmp(argv[i], "blocked") == 0) {
+                            set_pixel_layout(PIXELS_BLOCKED);
+                    } else {
+                            fprintf(stderr, "%s: bad pixel layout '%s'\n",
+                                    argv[0], argv[i]);
+                            exit(1);
+                    }
             } else if (*argv[i] == '-') {
                     fprintf(stderr, "%s: unknown option '%s'\n",
                             argv[0], argv[i]);
                     exit(1);
             } else if (argc - i > 2) {
-                fprintf(stderr, "Usage: %s -d [filename]\n"
-                        "       %s -c [filename]\n",
+                fprintf(stderr, "Usage: %s [-s] [-l plain|blocked] "
+                        "[-j threads] [-a float|fixed] -d [filename]\n"
+                        "       %s [-s] [-l plain|blocked] [-j threads] "
+                        "[-a float|fixed] [-w stdio|write|mmap] "
+                        "-c [filename]\n",
                         argv[0], argv[0]);
                 exit(1);
             } else {
@@ -61,6 +123,11 @@ int main(int argc, char *argv[])
             }
         }
         assert(argc - i <= 1);    /* at most one file on command line */
+        if (staged && compress_or_decompress == compress40) {
+                compress_or_decompress = compress40_staged;
+        } else if (staged) {
+                compress_or_decompress = decompress40_staged;
+        }
         if (i < argc) {
                 FILE *fp = fopen(argv[i], "r");
                 assert(fp != NULL);
@@ -10,12 +10,15 @@
  *     Implementation of the bitpack class. Contains functions that
  *     check to see if values can be packed into certain amounts
  *     of bits, pack values into words, and retrieve packed values
- *     from words. 
+ *     from words, one word at a time or a whole row of words at once
+ *     (see bitpackrows.h).
  *     
  **************************************************************/
 #include <bitpack.h>
 #include <stdio.h>
 #include "assert.h"
+#include "bitpackrows.h"
+#include "simd.h"
 
 Except_T Bitpack_Overflow = { "Overflow packing bits" };
 
@@ -23,6 +26,16 @@ uint64_t shift_left(uint64_t input, unsigned shift);
 uint64_t shift_right_u(uint64_t input, unsigned shift);
 int64_t shift_right_s(int64_t input, unsigned shift);
 uint64_t zero_out_field(uint64_t word, unsigned width, unsigned lsb);
+bool row_fits(const uint64_t *values, int count, unsigned width,
+              uint64_t bias);
+#ifdef HAVE_AVX2_KERNELS
+bool row_fits_avx2(const uint64_t *values, int count, unsigned width,
+                   uint64_t bias);
+void row_get_avx2(const uint64_t *words, int count, unsigned width,
+                  unsigned lsb, bool sign, uint64_t *values);
+void row_new_avx2(uint64_t *words, int count, unsigned width,
+                  unsigned lsb, const uint64_t *values);
+#endif
 
 /* Bitpack_fitsu
  * Purpose: Checks to see if a given unsigned 64 bit integer value
@@ -193,7 +206,8 @@ uint64_t Bitpack_newu(uint64_t word, unsigned width, unsigned lsb,
  *                  of that value, and the lsb in the word where that
  *                  value will be inserted
  * Success output: A 64 bit word with the given field filled in with the
- *                  proper value
+ *                  proper value. Every bit outside the field is left as
+ *                  it was, even when the value is negative.
  * Failure output: Raises an exception of the given width plus the
  *                  given lsb is greater than 64, or the given width is
  *                  greater than 64
@@ -208,13 +222,353 @@ uint64_t Bitpack_news(uint64_t word, unsigned width, unsigned lsb,
         RAISE(Bitpack_Overflow);
     }
 
+    /* Keep only the field's bits, so a negative value does not set
+     * every bit above it */
+    uint64_t field = shift_right_u(~(uint64_t)0, 64 - width);
+
     word = zero_out_field(word, width, lsb);
-    value = shift_left(value, lsb);
-    word |= value;
+    word |= shift_left((uint64_t)value & field, lsb);
 
     return word;
 }
 
+/* Bitpack_fitsu_row
+ * Purpose: Checks to see if every value in an array of unsigned 64 bit
+ *              integers can fit in the supplied bit width
+ * Parameters: An array of values, the number of values, and a width
+ * Returns: A boolean
+ *
+ * Expected input: An array of at least count values and a bit width
+ * Success output: True if Bitpack_fitsu is true for every value
+ * Failure output: Raises an exception if the given width is greater
+ *                  than 64 or the array is NULL
+ */
+bool Bitpack_fitsu_row(const uint64_t *values, int count, unsigned width)
+{
+    assert(width <= 64);
+    assert(count == 0 || values != NULL);
+
+    if (width == 64) {
+        return true;
+    } else if (width == 0) {
+        return count == 0;
+    }
+
+    return row_fits(values, count, width, 0);
+}
+
+/* Bitpack_fitss_row
+ * Purpose: Checks to see if every value in an array of signed 64 bit
+ *              integers can fit in the supplied bit width
+ * Parameters: An array of values, the number of values, and a width
+ * Returns: A boolean
+ *
+ * Expected input: An array of at least count values and a bit width
+ * Success output: True if Bitpack_fitss is true for every value
+ * Failure output: Raises an exception if the given width is greater
+ *                  than 64 or the array is NULL
+ */
+bool Bitpack_fitss_row(const int64_t *values, int count, unsigned width)
+{
+    assert(width <= 64);
+    assert(count == 0 || values != NULL);
+
+    if (width == 64) {
+        return true;
+    } else if (width == 0) {
+        return count == 0;
+    }
+
+    /* Adding 2^(width - 1) moves the signed range onto [0, 2^width) */
+    return row_fits((const uint64_t *)values, count, width,
+                    shift_left(1, width - 1));
+}
+
+/* Bitpack_getu_row
+ * Purpose: Gets the value of the same field from every word in an array
+ * Parameters: An array of words, the number of words, the width and lsb
+ *             of the field, and an array for the values
+ * Returns: nothing
+ *
+ * Expected input: Arrays of at least count elements, and the width and
+ *                  lsb of a field
+ * Success output: values[i] holds Bitpack_getu(words[i], width, lsb)
+ * Failure output: Raises an exception if the given width plus the
+ *                  given lsb is greater than 64, or a pointer is NULL
+ */
+void Bitpack_getu_row(const uint64_t *words, int count, unsigned width,
+                      unsigned lsb, uint64_t *values)
+{
+    assert(width <= 64);
+    assert(width + lsb <= 64);
+    assert(count == 0 || (words != NULL && values != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (width > 0 && width < 64 && cpu_has_avx2()) {
+        row_get_avx2(words, count, width, lsb, false, values);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        values[i] = Bitpack_getu(words[i], width, lsb);
+    }
+}
+
+/* Bitpack_gets_row
+ * Purpose: Gets the signed value of the same field from every word in
+ *          an array
+ * Parameters: An array of words, the number of words, the width and lsb
+ *             of the field, and an array for the values
+ * Returns: nothing
+ *
+ * Expected input: Arrays of at least count elements, and the width and
+ *                  lsb of a field
+ * Success output: values[i] holds Bitpack_gets(words[i], width, lsb)
+ * Failure output: Raises an exception if the given width plus the
+ *                  given lsb is greater than 64, or a pointer is NULL
+ */
+void Bitpack_gets_row(const uint64_t *words, int count, unsigned width,
+                      unsigned lsb, int64_t *values)
+{
+    assert(width <= 64);
+    assert(width + lsb <= 64);
+    assert(count == 0 || (words != NULL && values != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (width > 0 && width < 64 && cpu_has_avx2()) {
+        row_get_avx2(words, count, width, lsb, true, (uint64_t *)values);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        values[i] = Bitpack_gets(words[i], width, lsb);
+    }
+}
+
+/* Bitpack_newu_row
+ * Purpose: Sets the same field in every word of an array to the
+ *          matching unsigned value
+ * Parameters: An array of words, the number of words, the width and
+ *             lsb of the field, and an array of values
+ * Returns: nothing
+ *
+ * Expected input: Arrays of at least count elements, and the width and
+ *                  lsb of a field
+ * Success output: words[i] is Bitpack_newu(words[i], width, lsb,
+ *                  values[i])
+ * Failure output: Raises Bitpack_Overflow, once for the whole array and
+ *                  before any word is changed, if a value does not fit
+ *                  the width. Raises an exception if the given width
+ *                  plus the given lsb is greater than 64, or a pointer
+ *                  is NULL.
+ */
+void Bitpack_newu_row(uint64_t *words, int count, unsigned width,
+                      unsigned lsb, const uint64_t *values)
+{
+    assert(width <= 64);
+    assert(width + lsb <= 64);
+    assert(count == 0 || (words != NULL && values != NULL));
+
+    if (!Bitpack_fitsu_row(values, count, width)) {
+        RAISE(Bitpack_Overflow);
+    }
+
+#ifdef HAVE_AVX2_KERNELS
+    if (width < 64 && cpu_has_avx2()) {
+        row_new_avx2(words, count, width, lsb, values);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        words[i] = Bitpack_newu(words[i], width, lsb, values[i]);
+    }
+}
+
+/* Bitpack_news_row
+ * Purpose: Sets the same field in every word of an array to the
+ *          matching signed value
+ * Parameters: An array of words, the number of words, the width and
+ *             lsb of the field, and an array of values
+ * Returns: nothing
+ *
+ * Expected input: Arrays of at least count elements, and the width and
+ *                  lsb of a field
+ * Success output: words[i] is Bitpack_news(words[i], width, lsb,
+ *                  values[i])
+ * Failure output: Raises Bitpack_Overflow, once for the whole array and
+ *                  before any word is changed, if a value does not fit
+ *                  the width. Raises an exception if the given width
+ *                  plus the given lsb is greater than 64, or a pointer
+ *                  is NULL.
+ */
+void Bitpack_news_row(uint64_t *words, int count, unsigned width,
+                      unsigned lsb, const int64_t *values)
+{
+    assert(width <= 64);
+    assert(width + lsb <= 64);
+    assert(count == 0 || (words != NULL && values != NULL));
+
+    if (!Bitpack_fitss_row(values, count, width)) {
+        RAISE(Bitpack_Overflow);
+    }
+
+#ifdef HAVE_AVX2_KERNELS
+    if (width < 64 && cpu_has_avx2()) {
+        row_new_avx2(words, count, width, lsb, (const uint64_t *)values);
+        return;
+    }
+#endif
+
+    for (int i = 0; i < count; i++) {
+        words[i] = Bitpack_news(words[i], width, lsb, values[i]);
+    }
+}
+
+/* row_fits
+ * Purpose: Helper function that checks whether every value of an array,
+ *          once bias is added, is below 2^width
+ * Parameters: An array of values, the number of values, a width, and
+ *             the bias to add
+ * Returns: A boolean
+ *
+ * Expected input: A width in [1, 63] and a bias of 0 for unsigned values
+ *                  or 2^(width - 1) for signed ones
+ * Success output: True if every value fits
+ * Failure output: none
+ */
+bool row_fits(const uint64_t *values, int count, unsigned width,
+              uint64_t bias)
+{
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        return row_fits_avx2(values, count, width, bias);
+    }
+#endif
+
+    uint64_t outside = 0;
+    for (int i = 0; i < count; i++) {
+        outside |= (values[i] + bias) >> width;
+    }
+
+    return outside == 0;
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* row_fits_avx2
+ * Purpose: AVX2 version of row_fits that checks 4 values at a time,
+ *          or-ing together every bit left after shifting out the width
+ * Parameters: Same as row_fits
+ * Returns: A boolean
+ *
+ * Expected input: Same as row_fits, on a CPU with AVX2
+ * Success output: Same as row_fits
+ * Failure output: none
+ */
+AVX2_KERNEL
+bool row_fits_avx2(const uint64_t *values, int count, unsigned width,
+                   uint64_t bias)
+{
+    const __m256i vbias = _mm256_set1_epi64x(bias);
+    const __m128i shift = _mm_cvtsi32_si128(width);
+    __m256i outside = _mm256_setzero_si256();
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&values[i]);
+        outside = _mm256_or_si256(outside, _mm256_srl_epi64(
+                                        _mm256_add_epi64(v, vbias), shift));
+    }
+
+    uint64_t rest = 0;
+    for (; i < count; i++) {
+        rest |= (values[i] + bias) >> width;
+    }
+
+    return _mm256_testz_si256(outside, outside) && rest == 0;
+}
+
+/* row_get_avx2
+ * Purpose: Helper function that extracts a field from 4 words at a
+ *          time. A signed field is sign extended by flipping its sign
+ *          bit and subtracting it back, since AVX2 has no 64-bit
+ *          arithmetic shift.
+ * Parameters: An array of words, the number of words, the width and
+ *             lsb of the field, whether the field is signed, and an
+ *             array for the values
+ * Returns: nothing
+ *
+ * Expected input: A width in [1, 63], with width + lsb no larger than
+ *                  64, on a CPU with AVX2
+ * Success output: values[i] holds the field of words[i], as Bitpack_getu
+ *                  or Bitpack_gets returns it
+ * Failure output: none
+ */
+AVX2_KERNEL
+void row_get_avx2(const uint64_t *words, int count, unsigned width,
+                  unsigned lsb, bool sign, uint64_t *values)
+{
+    const __m256i mask = _mm256_set1_epi64x(shift_right_u(~(uint64_t)0,
+                                                          64 - width));
+    const __m256i sign_bit = _mm256_set1_epi64x(sign ? shift_left(1,
+                                                        width - 1) : 0);
+    const __m128i shift = _mm_cvtsi32_si128(lsb);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&words[i]);
+        v = _mm256_and_si256(_mm256_srl_epi64(v, shift), mask);
+        v = _mm256_sub_epi64(_mm256_xor_si256(v, sign_bit), sign_bit);
+        _mm256_storeu_si256((__m256i *)&values[i], v);
+    }
+
+    for (; i < count; i++) {
+        values[i] = sign ? (uint64_t)Bitpack_gets(words[i], width, lsb)
+                         : Bitpack_getu(words[i], width, lsb);
+    }
+}
+
+/* row_new_avx2
+ * Purpose: Helper function that replaces a field in 4 words at a time
+ * Parameters: An array of words, the number of words, the width and
+ *             lsb of the field, and an array of values
+ * Returns: nothing
+ *
+ * Expected input: A width in [1, 63], with width + lsb no larger than
+ *                  64, values that already fit the width (signed ones
+ *                  as two's complement), on a CPU with AVX2
+ * Success output: Each word holds the low width bits of its value in
+ *                  the field and is otherwise unchanged
+ * Failure output: none
+ */
+AVX2_KERNEL
+void row_new_avx2(uint64_t *words, int count, unsigned width,
+                  unsigned lsb, const uint64_t *values)
+{
+    uint64_t field = shift_right_u(~(uint64_t)0, 64 - width);
+    const __m256i mask = _mm256_set1_epi64x(field);
+    const __m256i keep = _mm256_set1_epi64x(~shift_left(field, lsb));
+    const __m128i shift = _mm_cvtsi32_si128(lsb);
+    int i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m256i word = _mm256_loadu_si256((const __m256i *)&words[i]);
+        __m256i value = _mm256_loadu_si256((const __m256i *)&values[i]);
+
+        value = _mm256_sll_epi64(_mm256_and_si256(value, mask), shift);
+        word = _mm256_or_si256(_mm256_and_si256(word, keep), value);
+        _mm256_storeu_si256((__m256i *)&words[i], word);
+    }
+
+    for (; i < count; i++) {
+        words[i] = (words[i] & ~shift_left(field, lsb))
+                 | shift_left(values[i] & field, lsb);
+    }
+}
+#endif
+
 /* shift_left
  * Purpose: Helper function that shifts a 64 bit word to the left
  * Parameters: A 64 bit word and a shift amount
@@ -0,0 +1,80 @@
+/**************************************************************
+ *
+ *                     bitpackrows.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Row versions of the Bitpack interface. Each function does what
+ *     its scalar namesake in bitpack.h does, to every element of an
+ *     array of words or values at once, so bit-level format code can
+ *     work a whole row at a time. bitpack.h is the course interface
+ *     and cannot change, so these are declared here and implemented
+ *     in bitpack.c next to the scalar functions.
+ *
+ **************************************************************/
+#ifndef BITPACKROWS_INCLUDED
+#define BITPACKROWS_INCLUDED
+#include <stdbool.h>
+#include <stdint.h>
+#include <assert.h>
+#include <bitpack.h>
+
+/* Bitpack_fitsu_row, Bitpack_fitss_row
+ * Purpose: Checks to see if every value in an array can fit in the
+ *              supplied bit width
+ * Parameters: An array of values, the number of values, and a width
+ * Returns: A boolean
+ *
+ * Expected input: An array of at least count values and a bit width
+ * Success output: True if Bitpack_fitsu (or Bitpack_fitss) is true for
+ *                  every value, false otherwise
+ * Failure output: Raises an exception if the given width is greater
+ *                  than 64 or the array is NULL
+ */
+bool Bitpack_fitsu_row(const uint64_t *values, int count, unsigned width);
+bool Bitpack_fitss_row(const int64_t *values, int count, unsigned width);
+
+/* Bitpack_getu_row, Bitpack_gets_row
+ * Purpose: Gets the value of the same field from every word in an array
+ * Parameters: An array of words, the number of words, the width and lsb
+ *             of the field, and an array for the values
+ * Returns: nothing
+ *
+ * Expected input: Arrays of at least count elements, and the width and
+ *                  lsb of a field
+ * Success output: values[i] holds what Bitpack_getu (or Bitpack_gets)
+ *                  returns for words[i]
+ * Failure output: Raises an exception if the given width plus the
+ *                  given lsb is greater than 64, or a pointer is NULL
+ */
+void Bitpack_getu_row(const uint64_t *words, int count, unsigned width,
+                      unsigned lsb, uint64_t *values);
+void Bitpack_gets_row(const uint64_t *words, int count, unsigned width,
+                      unsigned lsb, int64_t *values);
+
+/* Bitpack_newu_row, Bitpack_news_row
+ * Purpose: Sets the same field in every word of an array to the
+ *          matching value
+ * Parameters: An array of words, the number of words, the width and
+ *             lsb of the field, and an array of values
+ * Returns: nothing
+ *
+ * Expected input: Arrays of at least count elements, and the width and
+ *                  lsb of a field
+ * Success output: words[i] is what Bitpack_newu (or Bitpack_news)
+ *                  returns for words[i] and values[i]
+ * Failure output: Raises Bitpack_Overflow, once for the whole array and
+ *                  before any word is changed, if a value does not fit
+ *                  the width. Raises an exception if the given width
+ *                  plus the given lsb is greater than 64, or a pointer
+ *                  is NULL.
+ */
+void Bitpack_newu_row(uint64_t *words, int count, unsigned width,
+                      unsigned lsb, const uint64_t *values);
+void Bitpack_news_row(uint64_t *words, int count, unsigned width,
+                      unsigned lsb, const int64_t *values);
+
+#endif
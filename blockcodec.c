@@ -0,0 +1,187 @@
+/**************************************************************
+ *
+ *                     blockcodec.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Implementation of the blockcodec class. With float arithmetic
+ *     each block goes through the same colorspace, quantize, dctrans
+ *     and codeword functions as the staged pipeline, so both produce
+ *     identical output. With fixed-point arithmetic the fixedcodec
+ *     class takes the place of the first three.
+ *
+ **************************************************************/
+#include "blockcodec.h"
+#include "colorspace.h"
+#include "quantize.h"
+#include "codeword.h"
+#include "dctrans.h"
+#include "fixedcodec.h"
+
+struct Blockcodec {
+    int blocks;         /* most blocks in one call */
+    Codec_arithmetic arithmetic;
+
+    /* Luma of the top (index 0) and bottom (index 1) scanlines, and
+     * the average chroma of each block */
+    float *y[2], *pb, *pr;
+
+    /* Coefficients and chroma indices of each block, one lane per
+     * block, so each step runs on the whole row at once */
+    uint32_t *lane_a, *lane_pb, *lane_pr;
+    int32_t *lane_b, *lane_c, *lane_d;
+};
+
+/* blockcodec_new
+ * Purpose: Allocates the scratch space needed to code a row of blocks
+ * Parameters: The most blocks that will be coded in one call and the
+ *             arithmetic to code them with
+ * Returns: A Blockcodec
+ *
+ * Expected input: A nonnegative number of blocks
+ * Success output: A Blockcodec that can be reused for every row of
+ *                  blocks of an image
+ * Failure output: Raises a Checked Runtime Error if allocation fails
+ */
+Blockcodec blockcodec_new(int blocks, Codec_arithmetic arithmetic)
+{
+    assert(blocks >= 0);
+    assert(arithmetic == CODEC_FLOAT || arithmetic == CODEC_FIXED);
+
+    Blockcodec codec = malloc(sizeof(struct Blockcodec));
+    assert(codec);
+
+    codec->blocks = blocks;
+    codec->arithmetic = arithmetic;
+
+    /* Two luma rows of 2 * blocks floats and two chroma rows of blocks
+     * floats in one allocation */
+    float *planes = malloc(6 * (size_t)blocks * sizeof(float));
+    assert(blocks == 0 || planes != NULL);
+
+    codec->y[0] = planes;
+    codec->y[1] = planes + 2 * (size_t)blocks;
+    codec->pb = planes + 4 * (size_t)blocks;
+    codec->pr = planes + 5 * (size_t)blocks;
+
+    /* Four coefficient lanes and two index lanes of blocks elements */
+    int32_t *lanes = malloc(6 * (size_t)blocks * sizeof(int32_t));
+    assert(blocks == 0 || lanes != NULL);
+
+    codec->lane_a = (uint32_t *)lanes;
+    codec->lane_b = lanes + (size_t)blocks;
+    codec->lane_c = lanes + 2 * (size_t)blocks;
+    codec->lane_d = lanes + 3 * (size_t)blocks;
+    codec->lane_pb = (uint32_t *)(lanes + 4 * (size_t)blocks);
+    codec->lane_pr = (uint32_t *)(lanes + 5 * (size_t)blocks);
+
+    return codec;
+}
+
+/* blockcodec_free
+ * Purpose: Frees a Blockcodec and its scratch space
+ * Parameters: A pointer to a Blockcodec
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Blockcodec
+ * Success output: The Blockcodec is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if codec is NULL
+ */
+void blockcodec_free(Blockcodec *codec)
+{
+    assert(codec != NULL && *codec != NULL);
+
+    free((*codec)->y[0]);
+    free((*codec)->lane_a);
+    free(*codec);
+    *codec = NULL;
+}
+
+/* encode_block_row
+ * Purpose: Compresses a pair of scanlines into a row of codewords
+ * Parameters: A Blockcodec, the top and bottom scanlines of a row of
+ *             blocks as packed samples (see ppmstream.h), the
+ *             denominator of the image, an array to hold the words,
+ *             and the number of blocks in the row
+ * Returns: nothing
+ *
+ * Expected input: Two scanlines of at least 2 * blocks pixels and an
+ *                 array of at least blocks words, with blocks no
+ *                 larger than the codec was made for
+ * Success output: words[i] holds the codeword for the block whose
+ *                 top-left pixel is pixel 2 * i of top
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void encode_block_row(Blockcodec codec, const unsigned char *top,
+                      const unsigned char *bottom, unsigned denominator,
+                      uint32_t *words, int blocks)
+{
+    assert(codec != NULL);
+    assert(blocks <= codec->blocks);
+    assert(blocks == 0 || (top != NULL && bottom != NULL && words != NULL));
+
+    if (codec->arithmetic == CODEC_FIXED) {
+        fixed_encode_block_row(top, bottom, blocks, denominator,
+                               codec->lane_a, codec->lane_b, codec->lane_c,
+                               codec->lane_d, codec->lane_pb,
+                               codec->lane_pr);
+    } else {
+        samples_to_ypbpr_blocks(top, bottom, blocks, denominator,
+                                codec->y[0], codec->y[1], codec->pb,
+                                codec->pr);
+
+        dct_block_row(codec->y[0], codec->y[1], blocks, codec->lane_a,
+                      codec->lane_b, codec->lane_c, codec->lane_d);
+        quantize_chroma(codec->pb, blocks, codec->lane_pb);
+        quantize_chroma(codec->pr, blocks, codec->lane_pr);
+    }
+
+    pack_codeword_row(codec->lane_a, codec->lane_b, codec->lane_c,
+                      codec->lane_d, codec->lane_pb, codec->lane_pr,
+                      blocks, words);
+}
+
+/* decode_block_row
+ * Purpose: Decompresses a row of codewords into a pair of scanlines
+ * Parameters: A Blockcodec, an array of words, the number of words,
+ *             the denominator of the output image, and the top and
+ *             bottom scanlines to fill in with packed samples
+ * Returns: nothing
+ *
+ * Expected input: An array of at least blocks words and two scanlines
+ *                 of at least 2 * blocks pixels, with blocks no
+ *                 larger than the codec was made for
+ * Success output: top and bottom hold the pixels of the row of blocks
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void decode_block_row(Blockcodec codec, const uint32_t *words, int blocks,
+                      unsigned denominator, unsigned char *top,
+                      unsigned char *bottom)
+{
+    assert(codec != NULL);
+    assert(blocks <= codec->blocks);
+    assert(blocks == 0 || (top != NULL && bottom != NULL && words != NULL));
+
+    unpack_codeword_row(words, blocks, codec->lane_a, codec->lane_b,
+                        codec->lane_c, codec->lane_d, codec->lane_pb,
+                        codec->lane_pr);
+
+    if (codec->arithmetic == CODEC_FIXED) {
+        fixed_decode_block_row(codec->lane_a, codec->lane_b, codec->lane_c,
+                               codec->lane_d, codec->lane_pb,
+                               codec->lane_pr, blocks, denominator, top,
+                               bottom);
+        return;
+    }
+
+    reverse_dct_block_row(codec->lane_a, codec->lane_b, codec->lane_c,
+                          codec->lane_d, blocks, codec->y[0], codec->y[1]);
+    reverse_quantize_chroma(codec->lane_pb, blocks, codec->pb);
+    reverse_quantize_chroma(codec->lane_pr, blocks, codec->pr);
+
+    ypbpr_blocks_to_samples(codec->y[0], codec->y[1], codec->pb, codec->pr,
+                            blocks, denominator, top, bottom);
+}
@@ -0,0 +1,92 @@
+/**************************************************************
+ *
+ *                     blockcodec.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     This file is the interface of our blockcodec class. It runs
+ *     the whole per-block pipeline (color conversion, chroma
+ *     quantization, DCT and bitpacking) on a pair of scanlines at
+ *     once, in either direction, so the compressor can go straight
+ *     from rgb rows to packed words, and the decompressor from
+ *     words back to rows, without building any full-image arrays.
+ *
+ **************************************************************/
+#ifndef BLOCKCODEC_INCLUDED
+#define BLOCKCODEC_INCLUDED
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+
+typedef struct Blockcodec *Blockcodec;
+
+/* The arithmetic a Blockcodec codes with. CODEC_FLOAT runs the same
+ * float steps as the staged pipeline; CODEC_FIXED runs the integer-only
+ * steps of fixedcodec.h, which are bit-reproducible everywhere and
+ * stay within the deviation documented there. */
+typedef enum { CODEC_FLOAT, CODEC_FIXED } Codec_arithmetic;
+
+/* blockcodec_new
+ * Purpose: Allocates the scratch space needed to code a row of blocks
+ * Parameters: The most blocks that will be coded in one call and the
+ *             arithmetic to code them with
+ * Returns: A Blockcodec
+ *
+ * Expected input: A nonnegative number of blocks
+ * Success output: A Blockcodec that can be reused for every row of
+ *                  blocks of an image
+ * Failure output: Raises a Checked Runtime Error if allocation fails
+ */
+Blockcodec blockcodec_new(int blocks, Codec_arithmetic arithmetic);
+
+/* blockcodec_free
+ * Purpose: Frees a Blockcodec and its scratch space
+ * Parameters: A pointer to a Blockcodec
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Blockcodec
+ * Success output: The Blockcodec is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if codec is NULL
+ */
+void blockcodec_free(Blockcodec *codec);
+
+/* encode_block_row
+ * Purpose: Compresses a pair of scanlines into a row of codewords
+ * Parameters: A Blockcodec, the top and bottom scanlines of a row of
+ *             blocks as packed samples (see ppmstream.h), the
+ *             denominator of the image, an array to hold the words,
+ *             and the number of blocks in the row
+ * Returns: nothing
+ *
+ * Expected input: Two scanlines of at least 2 * blocks pixels and an
+ *                 array of at least blocks words, with blocks no
+ *                 larger than the codec was made for
+ * Success output: words[i] holds the codeword for the block whose
+ *                 top-left pixel is pixel 2 * i of top
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void encode_block_row(Blockcodec codec, const unsigned char *top,
+                      const unsigned char *bottom, unsigned denominator,
+                      uint32_t *words, int blocks);
+
+/* decode_block_row
+ * Purpose: Decompresses a row of codewords into a pair of scanlines
+ * Parameters: A Blockcodec, an array of words, the number of words,
+ *             the denominator of the output image, and the top and
+ *             bottom scanlines to fill in with packed samples
+ * Returns: nothing
+ *
+ * Expected input: An array of at least blocks words and two scanlines
+ *                 of at least 2 * blocks pixels, with blocks no
+ *                 larger than the codec was made for
+ * Success output: top and bottom hold the pixels of the row of blocks
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void decode_block_row(Blockcodec codec, const uint32_t *words, int blocks,
+                      unsigned denominator, unsigned char *top,
+                      unsigned char *bottom);
+
+#endif
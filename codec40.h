@@ -0,0 +1,106 @@
+/**************************************************************
+ *
+ *                     codec40.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     This file extends the compress40 interface. compress40 and
+ *     decompress40 stream the image through the codec a few
+ *     scanlines at a time; the staged versions declared here run
+ *     each step of the codec over the whole image in turn and are
+ *     kept as a reference implementation. The streaming versions
+ *     can spread each band of rows across several threads, and can
+ *     code with fixed-point rather than float arithmetic; the staged
+ *     versions always use float, but can keep the image's pixels in
+ *     square blocks rather than rows.
+ *
+ **************************************************************/
+#ifndef CODEC40_INCLUDED
+#define CODEC40_INCLUDED
+#include <stdio.h>
+
+#include "wordstream.h"
+#include "blockcodec.h"
+
+/* How the staged codec stores the pixels of an image: as a plain
+ * UArray2, row after row, or as a UArray2b of PIXEL_BLOCKSIZE blocks
+ * that the color conversion visits one block at a time */
+typedef enum { PIXELS_PLAIN, PIXELS_BLOCKED } Pixel_layout;
+
+/* compress40_staged
+ * Purpose: Reads a file and compresses a ppm from within that file,
+ *          converting the whole image one step at a time
+ * Parameters: A file pointer
+ * Returns: nothing
+ *
+ * Expected input: A file containing a valid ppm
+ * Success output: Prints the compressed output to stdout
+ * Failure output: Will raise Pnm_Badformat if the ppm supplied is not
+ *                  in the proper format
+ */
+void compress40_staged(FILE *input);
+
+/* decompress40_staged
+ * Purpose: Reads a comp40 compressed image from a file and writes the
+ *          decompressed ppm to stdout, one whole-image step at a time
+ * Parameters: A file pointer
+ * Returns: nothing
+ *
+ * Expected input: A file containing a comp40 compressed image
+ * Success output: Prints the decompressed ppm to stdout
+ * Failure output: Will raise an exception if the header is malformed
+ */
+void decompress40_staged(FILE *input);
+
+/* set_codec_threads
+ * Purpose: Sets the number of threads compress40 and decompress40 use
+ * Parameters: The number of threads
+ * Returns: nothing
+ *
+ * Expected input: A number of threads of at least 1
+ * Success output: none
+ * Failure output: Will raise an exception if threads is less than 1
+ */
+void set_codec_threads(int threads);
+
+/* set_word_output
+ * Purpose: Sets how compress40 and compress40_staged write the words
+ *          of the compressed image
+ * Parameters: A Word_output
+ * Returns: nothing
+ *
+ * Expected input: WORDS_STDIO, WORDS_WRITE or WORDS_MMAP
+ * Success output: none
+ * Failure output: none
+ */
+void set_word_output(Word_output how);
+
+/* set_codec_arithmetic
+ * Purpose: Sets the arithmetic compress40 and decompress40 code with.
+ *          The default is CODEC_FLOAT, or CODEC_FIXED when built with
+ *          -DCODEC_FIXED_POINT.
+ * Parameters: A Codec_arithmetic
+ * Returns: nothing
+ *
+ * Expected input: CODEC_FLOAT or CODEC_FIXED
+ * Success output: none
+ * Failure output: Will raise an exception if arithmetic is neither
+ */
+void set_codec_arithmetic(Codec_arithmetic arithmetic);
+
+/* set_pixel_layout
+ * Purpose: Sets how compress40_staged and decompress40_staged store
+ *          the pixels of an image. The default is PIXELS_PLAIN.
+ * Parameters: A Pixel_layout
+ * Returns: nothing
+ *
+ * Expected input: PIXELS_PLAIN or PIXELS_BLOCKED
+ * Success output: none
+ * Failure output: Will raise an exception if layout is neither
+ */
+void set_pixel_layout(Pixel_layout layout);
+
+#endif
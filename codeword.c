@@ -11,6 +11,24 @@
  *     
  **************************************************************/
 #include "codeword.h"
+#include "plainrows.h"
+#include "simd.h"
+
+/* Width and lsb of each field of a packed codeword. The layout never
+ * changes, so the field helpers below fold down to a shift and a mask
+ * once they are inlined. */
+#define A_WIDTH 6
+#define A_LSB 26
+#define BCD_WIDTH 6
+#define B_LSB 20
+#define C_LSB 14
+#define D_LSB 8
+#define INDEX_WIDTH 4
+#define PB_LSB 4
+#define PR_LSB 0
+
+/* Codewords packed or unpacked per call by the staged row functions */
+#define ROW_CHUNK 256
 
 /* Codeword stores the color data that is encoded in a codeword */
 struct Codeword {
@@ -22,138 +40,186 @@ struct Codeword {
     uint32_t pr_index;
 };
 
+static inline uint32_t pack_fields(uint32_t a, int32_t b, int32_t c,
+                                   int32_t d, uint32_t pb_index,
+                                   uint32_t pr_index, uint32_t *overflow);
+static inline uint32_t new_field_u(uint32_t value, unsigned width,
+                                   unsigned lsb);
+static inline uint32_t new_field_s(int32_t value, unsigned width,
+                                   unsigned lsb);
+static inline uint32_t get_field_u(uint32_t word, unsigned width,
+                                   unsigned lsb);
+static inline int32_t get_field_s(uint32_t word, unsigned width,
+                                  unsigned lsb);
+uint32_t pack_codeword_row_scalar(const uint32_t *a, const int32_t *b,
+                                  const int32_t *c, const int32_t *d,
+                                  const uint32_t *pb_index,
+                                  const uint32_t *pr_index, int count,
+                                  uint32_t *words);
+void unpack_codeword_row_scalar(const uint32_t *words, int count,
+                                uint32_t *a, int32_t *b, int32_t *c,
+                                int32_t *d, uint32_t *pb_index,
+                                uint32_t *pr_index);
+#ifdef HAVE_AVX2_KERNELS
+uint32_t pack_codeword_row_avx2(const uint32_t *a, const int32_t *b,
+                                const int32_t *c, const int32_t *d,
+                                const uint32_t *pb_index,
+                                const uint32_t *pr_index, int count,
+                                uint32_t *words);
+void unpack_codeword_row_avx2(const uint32_t *words, int count,
+                              uint32_t *a, int32_t *b, int32_t *c,
+                              int32_t *d, uint32_t *pb_index,
+                              uint32_t *pr_index);
+#endif
+
 /* print_codewords
- * Purpose: Prints the words in a 2D array of int32_t words to stdout
- *          using the apply function apply_print
- * Parameters: a 2D array of int32_t words
+ * Purpose: Writes the words in a 2D array of int32_t words to the
+ *          output of a Word_writer one row at a time
+ * Parameters: a 2D array of int32_t words and a Word_writer
  * Returns: void
  *
- * Expected input: a valid word array filled with int32_t words
- * Success output: the words will be printed as characters to stdout
- * Failure output: words are not printed to stdout as expected
+ * Expected input: a valid word array filled with int32_t words and a
+ *                 writer with room for all of them
+ * Success output: the words will be written in row-major order
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
  */
-void print_codewords(A2Methods_UArray2 word_array)
+void print_codewords(A2Methods_UArray2 word_array, Word_writer writer)
 {
     assert(word_array != NULL);
-    A2Methods_T methods = uarray2_methods_plain; 
-    methods->small_map_row_major(word_array, apply_print, NULL);
+    assert(writer != NULL);
+
+    int width = plain_width(word_array);
+    int height = plain_height(word_array);
+
+    /* Each row of a plain array is already a run of words */
+    for (int j = 0; j < height; j++) {
+        word_write_row(writer, plain_row(word_array, j), width);
+    }
 }
 
-/* apply_print
- * Purpose: Apply function to print the current int32_t word to stdout
- * Parameters: a void pointer representing the current word to print and
- *             a closure void pointer that is not used
+/* read_codewords
+ * Purpose: Fills a 2D array of int32_t words from the input of a
+ *          Word_reader one row at a time
+ * Parameters: a 2D array of int32_t words and a Word_reader
  * Returns: void
  *
- * Expected input: called on a valid word array
- * Success output: words will be printed as characters to stdout
- * Failure output: words are not printed to stdout as expected
+ * Expected input: a valid word array and a reader holding at least
+ *                 as many words as the array
+ * Success output: the words will be stored in row-major order
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
+ *                 or the input ends before the array is full
  */
-void apply_print(void *curr_word, void *cl)
+void read_codewords(A2Methods_UArray2 word_array, Word_reader reader)
 {
-    (void)cl;
+    assert(word_array != NULL);
+    assert(reader != NULL);
+
+    int width = plain_width(word_array);
+    int height = plain_height(word_array);
 
-    uint32_t word = *(int32_t *)curr_word;
-    
-    for (int i = 24; i >= 0; i -= 8) {
-        char c = Bitpack_getu(word, 8, i);
-        putchar(c);
+    for (int j = 0; j < height; j++) {
+        word_read_row(reader, plain_row(word_array, j), width);
     }
 }
 
 /* bitpack_codewords
  * Purpose: Packs the given Codeword array into int32_t words and stores
- *          them in the word_array, all using apply function apply_bitpack
+ *          them in the word_array. Each row is gathered into field
+ *          arrays a chunk of codewords at a time and packed with
+ *          pack_codeword_row, straight into the row of words.
  * Parameters: a 2D array of Codeword structs and a 2D array of int32_t words
  * Returns: void
  *
  * Expected input: called on a valid Codeword array and a valid word array
+ *                 of the same size
  * Success output: words will be stored in word_array
- * Failure output: words are not stored in word_array as expected
+ * Failure output: raises Bitpack_Overflow if a field does not fit its
+ *                 width, and a Checked Runtime Error if a pointer is NULL
  */
 void bitpack_codewords(A2Methods_UArray2 cw_array,
                                      A2Methods_UArray2 word_array)
 {
     assert(cw_array != NULL);
     assert(word_array != NULL);
-    A2Methods_T methods = uarray2_methods_plain; 
-    methods->map_row_major(cw_array, apply_bitpack, word_array);
-}
 
-/* apply_bitpack
- * Purpose: Apply function to pack the current Codeword into an int32_t word 
- *          and stores it in the given element of the word_array
- * Parameters: two ints representing column and row to store the word at,
- *             a Codeword array, a void pointer to store the current Codeword,
- *             and a void pointer closure that holds the word_array
- * Returns: void
- *
- * Expected input: called on a valid Codeword array and passed a valid word
- *                 array as a closure
- * Success output: the current Codeword will be stored in word_array as a word
- * Failure output: the Codeword data is not stored in word_array
- */
-void apply_bitpack(int col, int row, A2Methods_UArray2 cw_array,
-                                             void *curr_cw, void *word_arr)
-{
-    (void)cw_array;
-
-    Codeword cw = (Codeword)curr_cw;
-    A2Methods_UArray2 word_array = (A2Methods_UArray2)word_arr;
-    A2Methods_T methods = uarray2_methods_plain; 
-
-    int32_t word = pack_codeword(cw);
-    *(int32_t *)methods->at(word_array, col, row) = word;
+    int width = plain_width(cw_array);
+    int height = plain_height(cw_array);
+    uint32_t a[ROW_CHUNK], pb[ROW_CHUNK], pr[ROW_CHUNK];
+    int32_t b[ROW_CHUNK], c[ROW_CHUNK], d[ROW_CHUNK];
+
+    for (int j = 0; j < height; j++) {
+        struct Codeword *cws = plain_row(cw_array, j);
+        uint32_t *out = plain_row(word_array, j);
+
+        for (int done = 0; done < width; ) {
+            int chunk = width - done;
+            if (chunk > ROW_CHUNK) {
+                chunk = ROW_CHUNK;
+            }
+
+            for (int i = 0; i < chunk; i++) {
+                Codeword cw = &cws[done + i];
+                a[i] = cw->a;
+                b[i] = cw->b;
+                c[i] = cw->c;
+                d[i] = cw->d;
+                pb[i] = cw->pb_index;
+                pr[i] = cw->pr_index;
+            }
+
+            pack_codeword_row(a, b, c, d, pb, pr, chunk, out + done);
+            done += chunk;
+        }
+    }
 }
 
 /* unpack_codewords
  * Purpose: Unpacks the given word_array of int32_t words into Codeword
- *          structs and stores them in cw_array using the apply
- *          function apply_bitpack
+ *          structs and stores them in cw_array, unpacking a chunk of
+ *          each row at a time with unpack_codeword_row
  * Parameters: a 2D array of int32_t words and a 2D array of Codeword structs
  * Returns: void
  *
  * Expected input: called on a valid word_array and a valid Codeword array
+ *                 at least as large
  * Success output: words will be stored in cw_array
- * Failure output: words are not stored in cw_array as expected
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
  */
 void unpack_codewords(A2Methods_UArray2 word_array,
                                  A2Methods_UArray2 cw_array)
 {
     assert(cw_array != NULL);
     assert(word_array != NULL);
-    A2Methods_T methods = uarray2_methods_plain; 
-    methods->map_row_major(word_array, apply_unpack, cw_array);
-}
 
-/* apply_unpack
- * Purpose: Apply function to unpack the current int32_t word into a Codeword
- *          struct and store it in the given element of the cw_array
- * Parameters: two ints representing column and row to store the Codeword at,
- *             a word array, a void pointer to store the current word,
- *             and a void pointer closure that holds the Codeword array
- * Returns: void
- *
- * Expected input: called on a valid word array and passed a valid Codeword
- *                 array as a closure
- * Success output: the current word will be stored in cw_array as a Codeword
- * Failure output: the word is not stored in cw_array
- */
-void apply_unpack(int col, int row, A2Methods_UArray2 word_array,
-                                         void *curr_word, void *cw_arr)
-{
-    (void)word_array;
-
-    uint32_t word = *(uint32_t *)curr_word;
-    A2Methods_UArray2 cw_array = (A2Methods_UArray2)cw_arr;
-    A2Methods_T methods = uarray2_methods_plain; 
-
-    Codeword cw = malloc(sizeof(struct Codeword));
-    assert(cw);
-
-    unpack_codeword(word, cw);
-    *(Codeword)methods->at(cw_array, col, row) = *cw;
-    free(cw);
+    int width = plain_width(word_array);
+    int height = plain_height(word_array);
+    uint32_t a[ROW_CHUNK], pb[ROW_CHUNK], pr[ROW_CHUNK];
+    int32_t b[ROW_CHUNK], c[ROW_CHUNK], d[ROW_CHUNK];
+
+    for (int j = 0; j < height; j++) {
+        const uint32_t *in = plain_row(word_array, j);
+        struct Codeword *cws = plain_row(cw_array, j);
+
+        for (int done = 0; done < width; ) {
+            int chunk = width - done;
+            if (chunk > ROW_CHUNK) {
+                chunk = ROW_CHUNK;
+            }
+
+            unpack_codeword_row(in + done, chunk, a, b, c, d, pb, pr);
+
+            for (int i = 0; i < chunk; i++) {
+                Codeword cw = &cws[done + i];
+                cw->a = a[i];
+                cw->b = b[i];
+                cw->c = c[i];
+                cw->d = d[i];
+                cw->pb_index = pb[i];
+                cw->pr_index = pr[i];
+            }
+            done += chunk;
+        }
+    }
 }
 
 /* pack_codeword
@@ -164,18 +230,18 @@ void apply_unpack(int col, int row, A2Methods_UArray2 word_array,
  *
  * Expected input: called on a valid Codeword
  * Success output: word storing Codeword data is successfully returned
- * Failure output: word storing Codeword data is not returned
+ * Failure output: raises Bitpack_Overflow if a field does not fit its
+ *                 width, as Bitpack_newu and Bitpack_news would
  */
 uint64_t pack_codeword(Codeword cw)
 {
     assert(cw != NULL);
-    uint64_t word = 0;
-    word = Bitpack_newu(word, 4, 0, get_pr_index(cw));
-    word = Bitpack_newu(word, 4, 4, get_pb_index(cw));
-    word = Bitpack_news(word, 6, 8, get_d_value(cw));
-    word = Bitpack_news(word, 6, 14, get_c_value(cw));
-    word = Bitpack_news(word, 6, 20, get_b_value(cw));
-    word = Bitpack_newu(word, 6, 26, get_a_value(cw));
+    uint32_t overflow = 0;
+    uint32_t word = pack_fields(cw->a, cw->b, cw->c, cw->d, cw->pb_index,
+                                cw->pr_index, &overflow);
+    if (overflow != 0) {
+        RAISE(Bitpack_Overflow);
+    }
 
     return word;
 }
@@ -195,16 +261,266 @@ uint64_t pack_codeword(Codeword cw)
 Codeword unpack_codeword(uint64_t word, Codeword cw)
 {
     assert(cw != NULL);
-    set_a_value(cw, Bitpack_getu(word, 6, 26));
-    set_b_value(cw, Bitpack_gets(word, 6, 20));
-    set_c_value(cw, Bitpack_gets(word, 6, 14));
-    set_d_value(cw, Bitpack_gets(word, 6, 8));
-    set_pb_index(cw, Bitpack_getu(word, 4, 4));
-    set_pr_index(cw, Bitpack_getu(word, 4, 0));
+    cw->a = get_field_u(word, A_WIDTH, A_LSB);
+    cw->b = get_field_s(word, BCD_WIDTH, B_LSB);
+    cw->c = get_field_s(word, BCD_WIDTH, C_LSB);
+    cw->d = get_field_s(word, BCD_WIDTH, D_LSB);
+    cw->pb_index = get_field_u(word, INDEX_WIDTH, PB_LSB);
+    cw->pr_index = get_field_u(word, INDEX_WIDTH, PR_LSB);
 
     return cw;
 }
 
+/* pack_codeword_row
+ * Purpose: Packs a row of codewords whose fields are held in separate
+ *          arrays, one element per codeword. Uses an AVX2 kernel that
+ *          packs 8 words at a time with vector shifts and masks when
+ *          the CPU supports it and pack_fields otherwise; both give
+ *          the same words.
+ * Parameters: arrays of the a, b, c and d values and the pb and pr
+ *             indices, the number of codewords, and an array for the
+ *             words
+ * Returns: void
+ *
+ * Expected input: arrays holding at least count elements
+ * Success output: words[i] holds the codeword made from the ith element
+ *                 of each field array
+ * Failure output: raises Bitpack_Overflow, once for the whole row, if
+ *                 any field does not fit its width, and a Checked
+ *                 Runtime Error if a pointer is NULL
+ */
+void pack_codeword_row(const uint32_t *a, const int32_t *b,
+                       const int32_t *c, const int32_t *d,
+                       const uint32_t *pb_index, const uint32_t *pr_index,
+                       int count, uint32_t *words)
+{
+    assert(count == 0 || (a != NULL && b != NULL && c != NULL && d != NULL
+                          && pb_index != NULL && pr_index != NULL
+                          && words != NULL));
+    uint32_t overflow;
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        overflow = pack_codeword_row_avx2(a, b, c, d, pb_index, pr_index,
+                                          count, words);
+    } else
+#endif
+    {
+        overflow = pack_codeword_row_scalar(a, b, c, d, pb_index, pr_index,
+                                            count, words);
+    }
+
+    if (overflow != 0) {
+        RAISE(Bitpack_Overflow);
+    }
+}
+
+/* unpack_codeword_row
+ * Purpose: Unpacks a row of words into separate arrays of fields, the
+ *          reverse of pack_codeword_row. Uses an AVX2 kernel that
+ *          unpacks 8 words at a time when the CPU supports it.
+ * Parameters: an array of words, the number of words, and arrays for
+ *             the a, b, c and d values and the pb and pr indices
+ * Returns: void
+ *
+ * Expected input: arrays holding at least count elements
+ * Success output: the ith element of each field array holds that field
+ *                 of words[i]
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
+ */
+void unpack_codeword_row(const uint32_t *words, int count, uint32_t *a,
+                         int32_t *b, int32_t *c, int32_t *d,
+                         uint32_t *pb_index, uint32_t *pr_index)
+{
+    assert(count == 0 || (a != NULL && b != NULL && c != NULL && d != NULL
+                          && pb_index != NULL && pr_index != NULL
+                          && words != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        unpack_codeword_row_avx2(words, count, a, b, c, d, pb_index,
+                                 pr_index);
+        return;
+    }
+#endif
+
+    unpack_codeword_row_scalar(words, count, a, b, c, d, pb_index,
+                               pr_index);
+}
+
+/* pack_codeword_row_scalar
+ * Purpose: Reference version of pack_codeword_row that packs one word
+ *          at a time
+ * Parameters: Same as pack_codeword_row
+ * Returns: Nonzero if any field did not fit its width
+ *
+ * Expected input: Same as pack_codeword_row
+ * Success output: Same as pack_codeword_row
+ * Failure output: none
+ */
+uint32_t pack_codeword_row_scalar(const uint32_t *a, const int32_t *b,
+                                  const int32_t *c, const int32_t *d,
+                                  const uint32_t *pb_index,
+                                  const uint32_t *pr_index, int count,
+                                  uint32_t *words)
+{
+    uint32_t overflow = 0;
+
+    for (int i = 0; i < count; i++) {
+        words[i] = pack_fields(a[i], b[i], c[i], d[i], pb_index[i],
+                               pr_index[i], &overflow);
+    }
+
+    return overflow;
+}
+
+/* unpack_codeword_row_scalar
+ * Purpose: Reference version of unpack_codeword_row that unpacks one
+ *          word at a time
+ * Parameters: Same as unpack_codeword_row
+ * Returns: void
+ *
+ * Expected input: Same as unpack_codeword_row
+ * Success output: Same as unpack_codeword_row
+ * Failure output: none
+ */
+void unpack_codeword_row_scalar(const uint32_t *words, int count,
+                                uint32_t *a, int32_t *b, int32_t *c,
+                                int32_t *d, uint32_t *pb_index,
+                                uint32_t *pr_index)
+{
+    for (int i = 0; i < count; i++) {
+        uint32_t word = words[i];
+
+        a[i] = get_field_u(word, A_WIDTH, A_LSB);
+        b[i] = get_field_s(word, BCD_WIDTH, B_LSB);
+        c[i] = get_field_s(word, BCD_WIDTH, C_LSB);
+        d[i] = get_field_s(word, BCD_WIDTH, D_LSB);
+        pb_index[i] = get_field_u(word, INDEX_WIDTH, PB_LSB);
+        pr_index[i] = get_field_u(word, INDEX_WIDTH, PR_LSB);
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* pack_codeword_row_avx2
+ * Purpose: AVX2 version of pack_codeword_row_scalar. Masks and shifts
+ *          each field of 8 codewords into place at once and gathers
+ *          the bits that fall outside the fields to check for overflow.
+ * Parameters: Same as pack_codeword_row
+ * Returns: Nonzero if any field did not fit its width
+ *
+ * Expected input: Same as pack_codeword_row, on a CPU with AVX2
+ * Success output: Same as pack_codeword_row
+ * Failure output: none
+ */
+AVX2_KERNEL
+uint32_t pack_codeword_row_avx2(const uint32_t *a, const int32_t *b,
+                                const int32_t *c, const int32_t *d,
+                                const uint32_t *pb_index,
+                                const uint32_t *pr_index, int count,
+                                uint32_t *words)
+{
+    const __m256i bcd_mask = _mm256_set1_epi32((1 << BCD_WIDTH) - 1);
+    const __m256i bcd_bias = _mm256_set1_epi32(1 << (BCD_WIDTH - 1));
+    __m256i overflow = _mm256_setzero_si256();
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i va = _mm256_loadu_si256((const __m256i *)&a[i]);
+        __m256i vb = _mm256_loadu_si256((const __m256i *)&b[i]);
+        __m256i vc = _mm256_loadu_si256((const __m256i *)&c[i]);
+        __m256i vd = _mm256_loadu_si256((const __m256i *)&d[i]);
+        __m256i vpb = _mm256_loadu_si256((const __m256i *)&pb_index[i]);
+        __m256i vpr = _mm256_loadu_si256((const __m256i *)&pr_index[i]);
+
+        /* A value fits when nothing is left after shifting out its
+         * width; signed values are biased into [0, 2^width) first */
+        overflow = _mm256_or_si256(overflow, _mm256_or_si256(
+                _mm256_or_si256(_mm256_srli_epi32(va, A_WIDTH),
+                                _mm256_srli_epi32(_mm256_or_si256(vpb, vpr),
+                                                  INDEX_WIDTH)),
+                _mm256_or_si256(
+                    _mm256_srli_epi32(_mm256_add_epi32(vb, bcd_bias),
+                                      BCD_WIDTH),
+                    _mm256_or_si256(
+                        _mm256_srli_epi32(_mm256_add_epi32(vc, bcd_bias),
+                                          BCD_WIDTH),
+                        _mm256_srli_epi32(_mm256_add_epi32(vd, bcd_bias),
+                                          BCD_WIDTH)))));
+
+        __m256i word = _mm256_or_si256(
+                _mm256_or_si256(
+                    _mm256_slli_epi32(va, A_LSB),
+                    _mm256_slli_epi32(_mm256_and_si256(vb, bcd_mask),
+                                      B_LSB)),
+                _mm256_or_si256(
+                    _mm256_or_si256(
+                        _mm256_slli_epi32(_mm256_and_si256(vc, bcd_mask),
+                                          C_LSB),
+                        _mm256_slli_epi32(_mm256_and_si256(vd, bcd_mask),
+                                          D_LSB)),
+                    _mm256_or_si256(_mm256_slli_epi32(vpb, PB_LSB),
+                                    _mm256_slli_epi32(vpr, PR_LSB))));
+
+        _mm256_storeu_si256((__m256i *)&words[i], word);
+    }
+
+    uint32_t lanes[8];
+    _mm256_storeu_si256((__m256i *)lanes, overflow);
+
+    uint32_t any = pack_codeword_row_scalar(a + i, b + i, c + i, d + i,
+                                            pb_index + i, pr_index + i,
+                                            count - i, words + i);
+    for (int k = 0; k < 8; k++) {
+        any |= lanes[k];
+    }
+
+    return any;
+}
+
+/* unpack_codeword_row_avx2
+ * Purpose: AVX2 version of unpack_codeword_row_scalar. Shifts each
+ *          field of 8 words down at once, sign extending b, c and d by
+ *          shifting them to the top of the lane and back arithmetically.
+ * Parameters: Same as unpack_codeword_row
+ * Returns: void
+ *
+ * Expected input: Same as unpack_codeword_row, on a CPU with AVX2
+ * Success output: Same as unpack_codeword_row
+ * Failure output: none
+ */
+AVX2_KERNEL
+void unpack_codeword_row_avx2(const uint32_t *words, int count,
+                              uint32_t *a, int32_t *b, int32_t *c,
+                              int32_t *d, uint32_t *pb_index,
+                              uint32_t *pr_index)
+{
+    const __m256i index_mask = _mm256_set1_epi32((1 << INDEX_WIDTH) - 1);
+    const int bcd_shift = 32 - BCD_WIDTH;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i word = _mm256_loadu_si256((const __m256i *)&words[i]);
+
+        _mm256_storeu_si256((__m256i *)&a[i],
+                            _mm256_srli_epi32(word, A_LSB));
+        _mm256_storeu_si256((__m256i *)&b[i], _mm256_srai_epi32(
+                _mm256_slli_epi32(word, bcd_shift - B_LSB), bcd_shift));
+        _mm256_storeu_si256((__m256i *)&c[i], _mm256_srai_epi32(
+                _mm256_slli_epi32(word, bcd_shift - C_LSB), bcd_shift));
+        _mm256_storeu_si256((__m256i *)&d[i], _mm256_srai_epi32(
+                _mm256_slli_epi32(word, bcd_shift - D_LSB), bcd_shift));
+        _mm256_storeu_si256((__m256i *)&pb_index[i], _mm256_and_si256(
+                _mm256_srli_epi32(word, PB_LSB), index_mask));
+        _mm256_storeu_si256((__m256i *)&pr_index[i], _mm256_and_si256(
+                _mm256_srli_epi32(word, PR_LSB), index_mask));
+    }
+
+    unpack_codeword_row_scalar(words + i, count - i, a + i, b + i, c + i,
+                               d + i, pb_index + i, pr_index + i);
+}
+#endif
+
 /*****************************************************************
 *                        Getter functions
 *****************************************************************/
@@ -442,4 +758,154 @@ void set_cw_array(A2Methods_UArray2 cw_array, int row, int col, Codeword cw,
     assert(methods != NULL);
     assert(cw_array != NULL);
     *(Codeword)methods->at(cw_array, row, col) = *cw;
-}
\ No newline at end of file
+}
+
+/* store_codeword_row
+ * Purpose: Sets every Codeword in one row of a plain Codeword array
+ *          from lanes of fields, straight through the row's cells
+ *          rather than the methods suite
+ * Parameters: a Codeword array, the row, and arrays of the a, b, c and
+ *             d values and pb and pr indices
+ * Returns: void
+ *
+ * Expected input: a Codeword array made by uarray2_methods_plain, a row
+ *                 within it, and arrays as long as the row
+ * Success output: Codeword i of the row holds element i of each array
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
+ *                 or the row is out of range
+ */
+void store_codeword_row(A2Methods_UArray2 cw_array, int row,
+                        const uint32_t *a, const int32_t *b,
+                        const int32_t *c, const int32_t *d,
+                        const uint32_t *pb_index, const uint32_t *pr_index)
+{
+    int width = plain_width(cw_array);
+    struct Codeword *cws = plain_row(cw_array, row);
+
+    assert(width == 0 || (a != NULL && b != NULL && c != NULL && d != NULL
+                          && pb_index != NULL && pr_index != NULL));
+
+    for (int i = 0; i < width; i++) {
+        cws[i].a = a[i];
+        cws[i].b = b[i];
+        cws[i].c = c[i];
+        cws[i].d = d[i];
+        cws[i].pb_index = pb_index[i];
+        cws[i].pr_index = pr_index[i];
+    }
+}
+
+/* load_codeword_row
+ * Purpose: Gets the fields of every Codeword in one row of a plain
+ *          Codeword array as lanes; the reverse of store_codeword_row
+ * Parameters: a Codeword array, the row, and arrays for the a, b, c
+ *             and d values and pb and pr indices
+ * Returns: void
+ *
+ * Expected input: a Codeword array made by uarray2_methods_plain, a row
+ *                 within it, and arrays as long as the row
+ * Success output: element i of each array holds the field of Codeword i
+ *                 of the row
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
+ *                 or the row is out of range
+ */
+void load_codeword_row(A2Methods_UArray2 cw_array, int row, uint32_t *a,
+                       int32_t *b, int32_t *c, int32_t *d,
+                       uint32_t *pb_index, uint32_t *pr_index)
+{
+    int width = plain_width(cw_array);
+    const struct Codeword *cws = plain_row(cw_array, row);
+
+    assert(width == 0 || (a != NULL && b != NULL && c != NULL && d != NULL
+                          && pb_index != NULL && pr_index != NULL));
+
+    for (int i = 0; i < width; i++) {
+        a[i] = cws[i].a;
+        b[i] = cws[i].b;
+        c[i] = cws[i].c;
+        d[i] = cws[i].d;
+        pb_index[i] = cws[i].pb_index;
+        pr_index[i] = cws[i].pr_index;
+    }
+}
+
+/*****************************************************************
+*                        Field helpers
+*****************************************************************/
+
+/* pack_fields
+ * Purpose: Packs the fields of one codeword into a word, in the layout
+ *          pack_codeword has always used: a, b, c, d, pb_index and
+ *          pr_index from the most significant bits down
+ * Parameters: the six fields and a pointer to an overflow flag
+ * Returns: the packed word
+ *
+ * Expected input: a valid pointer to the flag
+ * Success output: the word; any bits of a field that fall outside its
+ *                 width are or-ed into *overflow
+ * Failure output: none
+ */
+static inline uint32_t pack_fields(uint32_t a, int32_t b, int32_t c,
+                                   int32_t d, uint32_t pb_index,
+                                   uint32_t pr_index, uint32_t *overflow)
+{
+    const uint32_t bias = 1u << (BCD_WIDTH - 1);
+
+    *overflow |= (a >> A_WIDTH) | ((pb_index | pr_index) >> INDEX_WIDTH)
+                 | (((uint32_t)b + bias) >> BCD_WIDTH)
+                 | (((uint32_t)c + bias) >> BCD_WIDTH)
+                 | (((uint32_t)d + bias) >> BCD_WIDTH);
+
+    return new_field_u(a, A_WIDTH, A_LSB)
+         | new_field_s(b, BCD_WIDTH, B_LSB)
+         | new_field_s(c, BCD_WIDTH, C_LSB)
+         | new_field_s(d, BCD_WIDTH, D_LSB)
+         | new_field_u(pb_index, INDEX_WIDTH, PB_LSB)
+         | new_field_u(pr_index, INDEX_WIDTH, PR_LSB);
+}
+
+/* new_field_u, new_field_s
+ * Purpose: Place an unsigned or two's complement value in a field of
+ *          a 32-bit word. With constant width and lsb these fold down to
+ *          a mask and a shift.
+ * Parameters: the value, and the width and lsb of the field
+ * Returns: a word holding just that field
+ *
+ * Expected input: width in [1, 31] and width + lsb no larger than 32
+ * Success output: the low width bits of value, shifted up to lsb
+ * Failure output: none
+ */
+static inline uint32_t new_field_u(uint32_t value, unsigned width,
+                                   unsigned lsb)
+{
+    return (value & ((1u << width) - 1)) << lsb;
+}
+
+static inline uint32_t new_field_s(int32_t value, unsigned width,
+                                   unsigned lsb)
+{
+    return new_field_u((uint32_t)value, width, lsb);
+}
+
+/* get_field_u, get_field_s
+ * Purpose: Read an unsigned or two's complement field out of a 32-bit
+ *          word, as Bitpack_getu and Bitpack_gets do for this layout
+ * Parameters: a word, and the width and lsb of the field
+ * Returns: the value of the field
+ *
+ * Expected input: width in [1, 31] and width + lsb no larger than 32
+ * Success output: the field, sign extended for get_field_s
+ * Failure output: none
+ */
+static inline uint32_t get_field_u(uint32_t word, unsigned width,
+                                   unsigned lsb)
+{
+    return (word >> lsb) & ((1u << width) - 1);
+}
+
+static inline int32_t get_field_s(uint32_t word, unsigned width,
+                                  unsigned lsb)
+{
+    /* Move the field to the top, then shift it back arithmetically */
+    return (int32_t)(word << (32 - width - lsb)) >> (32 - width);
+}
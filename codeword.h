@@ -9,7 +9,9 @@
  *     Summary
  *     This class allows the user to create, access, and use Codeword
  *     structs, data structures that are designed to store the color
- *     and chroma components of a compressed image.
+ *     and chroma components of a compressed image. Codewords are
+ *     packed with fixed 6/6/6/6/4/4 bit fields, either one at a time
+ *     or a whole row of blocks at once.
  *     
  **************************************************************/
 #ifndef CODEWORD_INCLUDED
@@ -22,91 +24,69 @@
 #include <bitpack.h>
 #include <assert.h>
 
+#include "wordstream.h"
+
 /* Codeword is a pointer to a struct that holds the color data of a codeword*/
 typedef struct Codeword *Codeword;
 
 /* print_codewords
- * Purpose: Prints the words in a 2D array of int32_t words to stdout
- *          using the apply function apply_print
- * Parameters: a 2D array of int32_t words
+ * Purpose: Writes the words in a 2D array of int32_t words to the
+ *          output of a Word_writer one row at a time
+ * Parameters: a 2D array of int32_t words and a Word_writer
  * Returns: void
  *
- * Expected input: a valid word array filled with int32_t words
- * Success output: the words will be printed as characters to stdout
- * Failure output: words are not printed to stdout as expected
+ * Expected input: a valid word array filled with int32_t words and a
+ *                 writer with room for all of them
+ * Success output: the words will be written in row-major order
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
  */
-void print_codewords(A2Methods_UArray2 cw_array);
+void print_codewords(A2Methods_UArray2 word_array, Word_writer writer);
 
-/* apply_print
- * Purpose: Apply function to print the current int32_t word to stdout
- * Parameters: a void pointer representing the current word to print and
- *             a closure void pointer that is not used
+/* read_codewords
+ * Purpose: Fills a 2D array of int32_t words from the input of a
+ *          Word_reader one row at a time
+ * Parameters: a 2D array of int32_t words and a Word_reader
  * Returns: void
  *
- * Expected input: called on a valid word array
- * Success output: words will be printed as characters to stdout
- * Failure output: words are not printed to stdout as expected
+ * Expected input: a valid word array and a reader holding at least
+ *                 as many words as the array
+ * Success output: the words will be stored in row-major order
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
+ *                 or the input ends before the array is full
  */
-void apply_print(void *curr_cw, void *cl);
+void read_codewords(A2Methods_UArray2 word_array, Word_reader reader);
 
 /* bitpack_codewords
  * Purpose: Packs the given Codeword array into int32_t words and stores
- *          them in the word_array, all using apply function apply_bitpack
+ *          them in the word_array. Each row is gathered into field
+ *          arrays a chunk of codewords at a time and packed with
+ *          pack_codeword_row, straight into the row of words.
  * Parameters: a 2D array of Codeword structs and a 2D array of int32_t words
  * Returns: void
  *
  * Expected input: called on a valid Codeword array and a valid word array
+ *                 of the same size
  * Success output: words will be stored in word_array
- * Failure output: words are not stored in word_array as expected
+ * Failure output: raises Bitpack_Overflow if a field does not fit its
+ *                 width, and a Checked Runtime Error if a pointer is NULL
  */
 void bitpack_codewords(A2Methods_UArray2 cw_array,
-                    A2Methods_UArray2 word_array);
-
-/* apply_bitpack
- * Purpose: Apply function to pack the current Codeword into an int32_t word 
- *          and stores it in the given element of the word_array
- * Parameters: two ints representing column and row to store the word at,
- *             a Codeword array, a void pointer to store the current Codeword,
- *             and a void pointer closure that holds the word_array
- * Returns: void
- *
- * Expected input: called on a valid Codeword array and passed a valid word
- *                 array as a closure
- * Success output: the current Codeword will be stored in word_array as a word
- * Failure output: the Codeword data is not stored in word_array
- */
-void apply_bitpack(int col, int row, A2Methods_UArray2 cw_array, void *curr_cw,
-                                                               void *word_arr);
+                                     A2Methods_UArray2 word_array);
 
 /* unpack_codewords
  * Purpose: Unpacks the given word_array of int32_t words into Codeword
- *          structs and stores them in cw_array using the apply
- *          function apply_bitpack
+ *          structs and stores them in cw_array, unpacking a chunk of
+ *          each row at a time with unpack_codeword_row
  * Parameters: a 2D array of int32_t words and a 2D array of Codeword structs
  * Returns: void
  *
  * Expected input: called on a valid word_array and a valid Codeword array
+ *                 at least as large
  * Success output: words will be stored in cw_array
- * Failure output: words are not stored in cw_array as expected
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
  */
 void unpack_codewords(A2Methods_UArray2 word_array,
-                               A2Methods_UArray2 cw_array);
-
-/* apply_unpack
- * Purpose: Apply function to unpack the current int32_t word into a Codeword
- *          struct and store it in the given element of the cw_array
- * Parameters: two ints representing column and row to store the Codeword at,
- *             a word array, a void pointer to store the current word,
- *             and a void pointer closure that holds the Codeword array
- * Returns: void
- *
- * Expected input: called on a valid word array and passed a valid Codeword
- *                 array as a closure
- * Success output: the current word will be stored in cw_array as a Codeword
- * Failure output: the word is not stored in cw_array
- */
-void apply_unpack(int col, int row, A2Methods_UArray2 word_array,
-                                  void *curr_word, void *cw_arr);
+                                 A2Methods_UArray2 cw_array);
 
 /* pack_codeword
  * Purpose: Packs the given Codeword struct into the
@@ -116,7 +96,8 @@ void apply_unpack(int col, int row, A2Methods_UArray2 word_array,
  *
  * Expected input: called on a valid Codeword
  * Success output: word storing Codeword data is successfully returned
- * Failure output: word storing Codeword data is not returned
+ * Failure output: raises Bitpack_Overflow if a field does not fit its
+ *                 width, as Bitpack_newu and Bitpack_news would
  */
 uint64_t pack_codeword(Codeword cw);
 
@@ -134,6 +115,46 @@ uint64_t pack_codeword(Codeword cw);
  */
 Codeword unpack_codeword(uint64_t word, Codeword cw);
 
+/* pack_codeword_row
+ * Purpose: Packs a row of codewords whose fields are held in separate
+ *          arrays, one element per codeword. Uses an AVX2 kernel that
+ *          packs 8 words at a time with vector shifts and masks when
+ *          the CPU supports it and pack_fields otherwise; both give
+ *          the same words.
+ * Parameters: arrays of the a, b, c and d values and the pb and pr
+ *             indices, the number of codewords, and an array for the
+ *             words
+ * Returns: void
+ *
+ * Expected input: arrays holding at least count elements
+ * Success output: words[i] holds the codeword made from the ith element
+ *                 of each field array
+ * Failure output: raises Bitpack_Overflow, once for the whole row, if
+ *                 any field does not fit its width, and a Checked
+ *                 Runtime Error if a pointer is NULL
+ */
+void pack_codeword_row(const uint32_t *a, const int32_t *b,
+                       const int32_t *c, const int32_t *d,
+                       const uint32_t *pb_index, const uint32_t *pr_index,
+                       int count, uint32_t *words);
+
+/* unpack_codeword_row
+ * Purpose: Unpacks a row of words into separate arrays of fields, the
+ *          reverse of pack_codeword_row. Uses an AVX2 kernel that
+ *          unpacks 8 words at a time when the CPU supports it.
+ * Parameters: an array of words, the number of words, and arrays for
+ *             the a, b, c and d values and the pb and pr indices
+ * Returns: void
+ *
+ * Expected input: arrays holding at least count elements
+ * Success output: the ith element of each field array holds that field
+ *                 of words[i]
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
+ */
+void unpack_codeword_row(const uint32_t *words, int count, uint32_t *a,
+                         int32_t *b, int32_t *c, int32_t *d,
+                         uint32_t *pb_index, uint32_t *pr_index);
+
 /*****************************************************************
 *                        Getter functions
 *****************************************************************/
@@ -316,4 +337,41 @@ void set_pr_index(Codeword cw, uint32_t value);
 void set_cw_array(A2Methods_UArray2 cw_array, int row, int col, Codeword cw,
                                                        A2Methods_T methods);
 
+/* store_codeword_row
+ * Purpose: Sets every Codeword in one row of a plain Codeword array
+ *          from lanes of fields, straight through the row's cells
+ *          rather than the methods suite
+ * Parameters: a Codeword array, the row, and arrays of the a, b, c and
+ *             d values and pb and pr indices
+ * Returns: void
+ *
+ * Expected input: a Codeword array made by uarray2_methods_plain, a row
+ *                 within it, and arrays as long as the row
+ * Success output: Codeword i of the row holds element i of each array
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
+ *                 or the row is out of range
+ */
+void store_codeword_row(A2Methods_UArray2 cw_array, int row,
+                        const uint32_t *a, const int32_t *b,
+                        const int32_t *c, const int32_t *d,
+                        const uint32_t *pb_index, const uint32_t *pr_index);
+
+/* load_codeword_row
+ * Purpose: Gets the fields of every Codeword in one row of a plain
+ *          Codeword array as lanes; the reverse of store_codeword_row
+ * Parameters: a Codeword array, the row, and arrays for the a, b, c
+ *             and d values and pb and pr indices
+ * Returns: void
+ *
+ * Expected input: a Codeword array made by uarray2_methods_plain, a row
+ *                 within it, and arrays as long as the row
+ * Success output: element i of each array holds the field of Codeword i
+ *                 of the row
+ * Failure output: raises a Checked Runtime Error if a pointer is NULL
+ *                 or the row is out of range
+ */
+void load_codeword_row(A2Methods_UArray2 cw_array, int row, uint32_t *a,
+                       int32_t *b, int32_t *c, int32_t *d,
+                       uint32_t *pb_index, uint32_t *pr_index);
+
 #endif
\ No newline at end of file
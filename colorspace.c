@@ -15,353 +15,725 @@
  *     
  **************************************************************/
 #include "colorspace.h"
+#include "ppmstream.h"
+#include "plainrows.h"
+#include "uarray2b.h"
+#include "simd.h"
 
-struct YPbPr {
-    float y, pb, pr;
-};
+/* Plane rows are padded to a multiple of this many floats (64 bytes) */
+#define PLANE_ALIGN 16
+
+/* Most pixels the block conversions hand to the row kernels at once */
+#define ROW_CHUNK 128
 
-struct closure_data {
-    A2Methods_UArray2 array;
-    A2Methods_T methods;
+/* What the conversions of a blocked pixel array need in each block */
+struct block_data {
+    Ypbpr_planes planes;
     unsigned denominator;
 };
 
-unsigned force_values_into_range(float value, unsigned denominator);
+void convert_block_to_ypbpr(int col, int row, int width, int height,
+                            UArray2b_T pixels, void *block, void *cl);
+void convert_block_to_rgb(int col, int row, int width, int height,
+                          UArray2b_T pixels, void *block, void *cl);
 
-/* convert_rgb_to_ypbpr
- * Purpose: Converts an array of rgb structs into an array of ypbpr
- *          structs
- * Parameters: A ppm and methods
- * Returns: A UArray2 of ypbpr structs
+unsigned force_values_into_range(float value, unsigned denominator);
+void samples_to_ypbpr_scalar(const unsigned char *samples, int count,
+                             unsigned denominator, float *y, float *pb,
+                             float *pr);
+void ypbpr_to_samples_scalar(const float *y, const float *pb,
+                             const float *pr, int count,
+                             unsigned denominator, unsigned char *samples);
+#ifdef HAVE_AVX2_KERNELS
+void samples_to_ypbpr_avx2(const unsigned char *samples, int count,
+                           unsigned denominator, float *y, float *pb,
+                           float *pr);
+void ypbpr_to_samples_avx2(const float *y, const float *pb,
+                           const float *pr, int count,
+                           unsigned denominator, unsigned char *samples);
+#endif
+
+/* ypbpr_planes_new
+ * Purpose: Allocates the planes of a component video image. The
+ *          storage comes from the selected image arena when there is
+ *          one (see imagearena.h).
+ * Parameters: The width and height of the image
+ * Returns: A Ypbpr_planes
  *
- * Expected input: A valid ppm and methods
- * Success output: A UArray2 of ypbpr structs
- * Failure output: none
+ * Expected input: A nonnegative, even width and height
+ * Success output: A width by height y plane and two half width by half
+ *                  height chroma planes, all zero
+ * Failure output: Raises a Checked Runtime Error if allocation fails or
+ *                  either dimension is odd
  */
-A2Methods_UArray2 convert_rgb_to_ypbpr(Pnm_ppm ppm, A2Methods_T methods)
-{ 
-    assert(methods != NULL);
-    assert(ppm != NULL);
-    A2Methods_UArray2 rgb_array = ppm->pixels;
-    int width = ppm->width;
-    int height = ppm->height;
- 
-    A2Methods_UArray2 ypbpr_array = methods->new(width, height,
-                                             sizeof(struct YPbPr));
-
-    closure_data ypbpr_data = malloc(sizeof(struct closure_data));
-    assert(ypbpr_data);
-
-    ypbpr_data->array = ypbpr_array;
-    ypbpr_data->methods = methods;
-    ypbpr_data->denominator = ppm->denominator;
-                                             
-    methods->map_row_major(rgb_array, apply_rgb_to_ypbpr, ypbpr_data);
-
-    ypbpr_array = ypbpr_data->array;
-    free(ypbpr_data);
-
-    return ypbpr_array;
+Ypbpr_planes ypbpr_planes_new(int width, int height)
+{
+    assert(width >= 0 && height >= 0);
+    assert(width % 2 == 0 && height % 2 == 0);
+
+    Ypbpr_planes planes = malloc(sizeof(struct Ypbpr_planes));
+    assert(planes);
+
+    planes->width = width;
+    planes->height = height;
+    planes->stride = ((size_t)width + PLANE_ALIGN - 1)
+                                        & ~(size_t)(PLANE_ALIGN - 1);
+    planes->chroma_stride = ((size_t)width / 2 + PLANE_ALIGN - 1)
+                                        & ~(size_t)(PLANE_ALIGN - 1);
+
+    /* All three planes in one block, each a whole number of rows */
+    size_t plane = planes->stride * height;
+    size_t chroma_plane = planes->chroma_stride * (height / 2);
+    size_t bytes = (plane + 2 * chroma_plane) * sizeof(float);
+    float *block;
+
+    planes->arena = image_arena_selected();
+    if (planes->arena != NULL) {
+        block = image_arena_alloc(planes->arena, bytes);
+    } else {
+        void *storage = NULL;
+        int failed = posix_memalign(&storage, PLANE_ALIGN * sizeof(float),
+                                    bytes > 0 ? bytes : 1);
+        assert(!failed);
+
+        block = memset(storage, 0, bytes);
+    }
+
+    planes->y = block;
+    planes->pb = block + plane;
+    planes->pr = block + plane + chroma_plane;
+
+    return planes;
 }
 
-/* convert_ypbpr_to_rgb
- * Purpose: Converts an array of ypbpr structs into an array of rgb
- *          structs
- * Parameters: A UArray2 of ypbpr structs and methods
- * Returns: A UArray2 of rgb structs
+/* ypbpr_planes_free
+ * Purpose: Frees a set of planes. Storage that came from an arena is
+ *          left for the arena to take back.
+ * Parameters: A pointer to a Ypbpr_planes
+ * Returns: nothing
  *
- * Expected input: A UArray2 of ypbpr structs and methods
- * Success output: A UArray2 of rgb structs
- * Failure output: none
+ * Expected input: A pointer to valid planes
+ * Success output: The planes are freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if planes is NULL
  */
-A2Methods_UArray2 convert_ypbpr_to_rgb(A2Methods_UArray2 array,
-                                             A2Methods_T methods)
+void ypbpr_planes_free(Ypbpr_planes *planes)
 {
-    assert(array != NULL);
-    assert(methods != NULL);
+    assert(planes != NULL && *planes != NULL);
+
+    /* an arena takes its storage back all at once when reset */
+    if ((*planes)->arena == NULL) {
+        free((*planes)->y);
+    }
+    free(*planes);
+    *planes = NULL;
+}
 
-    int width = methods->width(array);
-    int height = methods->height(array);
+/* convert_rgb_to_ypbpr
+ * Purpose: Converts an array of packed rgb pixels into component video
+ *          planes, handing each pair of rows straight to
+ *          samples_to_ypbpr_blocks so that no full-resolution chroma
+ *          is ever stored. A blocked array is converted one of its
+ *          blocks at a time, a pair of the block's rows per call.
+ * Parameters: A ppm and methods
+ * Returns: The Ypbpr_planes of the image
+ *
+ * Expected input: A valid ppm of even width and height whose pixels are
+ *                  packed samples (see ppmstream.h), in a plain array
+ *                  or a blocked one of even blocksize, and the methods
+ *                  that made it
+ * Success output: Planes the size of the ppm holding its luma and the
+ *                  average chroma of each block
+ * Failure output: Will raise an exception if a pointer is NULL
+ */
+Ypbpr_planes convert_rgb_to_ypbpr(Pnm_ppm ppm, A2Methods_T methods)
+{ 
+    assert(ppm != NULL);
 
-    A2Methods_UArray2 rgb_array = methods->new(width, height,
-                                             sizeof(struct Pnm_rgb));
+    Ypbpr_planes planes = ypbpr_planes_new(ppm->width, ppm->height);
 
-    closure_data rgb_data = malloc(sizeof(struct closure_data));
-    assert(rgb_data);
+    if (methods == uarray2_methods_blocked) {
+        assert(methods->blocksize(ppm->pixels) % 2 == 0);
+        struct block_data data = { planes, ppm->denominator };
+        UArray2b_map_blocks(ppm->pixels, convert_block_to_ypbpr, &data);
+        return planes;
+    }
 
-    rgb_data->array = rgb_array;
-    rgb_data->methods = methods;
-                                             
-    methods->map_row_major(array, apply_ypbpr_to_rgb, rgb_data);
+    assert(methods == uarray2_methods_plain);
+    for (int row = 0; row < planes->height / 2; row++) {
+        float *y_top = planes->y + 2 * row * planes->stride;
 
-    rgb_array = rgb_data->array;
-    free(rgb_data);
+        samples_to_ypbpr_blocks(plain_row(ppm->pixels, 2 * row),
+                                plain_row(ppm->pixels, 2 * row + 1),
+                                planes->width / 2, ppm->denominator, y_top,
+                                y_top + planes->stride,
+                                planes->pb + row * planes->chroma_stride,
+                                planes->pr + row * planes->chroma_stride);
+    }
 
-    return rgb_array;
+    return planes;
 }
 
-/* apply_rgb_to_ypbpr
- * Purpose: Apply function to the mapping function that iterates over
- *          the array of rgb structs. Converts rgb values to ypbpr
- *          values and sets the correct ypbpr struct values in the
- *           array of ypbpr structs
- * Parameters: Two integers denoting a location, an array of rgb
- *              structs, the element at (i, j), and a closure, which
- *              holds a struct that contains methods, the correct
- *              denominator of the ppm, and the array of ypbpr structs
- * Returns: Nothing
+/* convert_ypbpr_to_rgb
+ * Purpose: Converts component video planes into an array of packed
+ *          rgb pixels with a denominator of 200, a pair of rows at a
+ *          time with ypbpr_blocks_to_samples. With blocked methods the
+ *          array has blocks of PIXEL_BLOCKSIZE and is filled one of
+ *          its blocks at a time.
+ * Parameters: A Ypbpr_planes and methods
+ * Returns: An array of packed rgb pixels made by methods
  *
- * Expected input: A valid location in the rgb array, an rgb array,
- *                  the element at that location, and a closure struct
- *                   that contains a ypbpr array, a denominator, and
- *                   methods.
- * Success output: none
- * Failure output: none
+ * Expected input: Valid planes, and uarray2_methods_plain or
+ *                  uarray2_methods_blocked
+ * Success output: An array whose elements are packed samples (see
+ *                  ppmstream.h), 3 bytes each, where every pixel of a
+ *                  block takes the block's chroma
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void apply_rgb_to_ypbpr(int i, int j, A2Methods_UArray2 rgb_array,
-                                                         void *elem, void *cl)
+A2Methods_UArray2 convert_ypbpr_to_rgb(Ypbpr_planes planes,
+                                       A2Methods_T methods)
 {
-    (void) rgb_array;
-
-    struct closure_data data = *(closure_data)cl;
-    A2Methods_UArray2 ypbpr_array = data.array;
-    A2Methods_T methods = data.methods;
-    unsigned denominator = data.denominator;
-
-    Pnm_rgb curr_rgb = (Pnm_rgb)elem;
-    float r = curr_rgb->red / (float)denominator;
-    float g = curr_rgb->green / (float)denominator;
-    float b = curr_rgb->blue / (float)denominator;
-
-    float y = 0.299 * r + 0.587 * g + 0.114 * b;
-    float pb = -0.168736 * r - 0.331264 * g + 0.5 * b;
-    float pr = 0.5 * r - 0.418688 * g - 0.081312 * b;
+    assert(planes != NULL);
+    assert(methods == uarray2_methods_plain
+           || methods == uarray2_methods_blocked);
+
+    A2Methods_UArray2 rgb_array =
+        methods->new_with_blocksize(planes->width, planes->height,
+                                    ppm_pixel_bytes(200), PIXEL_BLOCKSIZE);
+
+    if (methods == uarray2_methods_blocked) {
+        struct block_data data = { planes, 200 };
+        UArray2b_map_blocks(rgb_array, convert_block_to_rgb, &data);
+        return rgb_array;
+    }
 
-    YPbPr ypbpr = malloc(sizeof(struct YPbPr));
-    assert(ypbpr);
+    for (int row = 0; row < planes->height / 2; row++) {
+        const float *y_top = planes->y + 2 * row * planes->stride;
 
-    ypbpr->y = y;
-    ypbpr->pb = pb;
-    ypbpr->pr = pr;
+        ypbpr_blocks_to_samples(y_top, y_top + planes->stride,
+                                planes->pb + row * planes->chroma_stride,
+                                planes->pr + row * planes->chroma_stride,
+                                planes->width / 2, 200,
+                                plain_row(rgb_array, 2 * row),
+                                plain_row(rgb_array, 2 * row + 1));
+    }
 
-    *(YPbPr)methods->at(ypbpr_array, i, j) = *ypbpr;
-    free(ypbpr);
+    return rgb_array;
 }
 
-/* apply_ypbpr_to_rgb
- * Purpose: Apply function to the mapping function that iterates over
- *          the array of ypbpr structs. Converts ypbpr values to rgb
- *          values and sets the correct rgb struct values in the
- *           array of rgb structs
- * Parameters: Two integers denoting a location, an array of ypbpr
- *              structs, the element at (i, j), and a closure, which
- *              holds a struct that contains methods and the array 
- *              of rgb structs
- * Returns: Nothing
+/* convert_block_to_ypbpr
+ * Purpose: Converts one block of a blocked pixel array into the part of
+ *          the planes it covers; the apply function convert_rgb_to_ypbpr
+ *          hands to UArray2b_map_blocks
+ * Parameters: The column and row of the block's upper left pixel, the
+ *             width and height of the block within the image, the
+ *             array, a pointer to the block's first pixel, and a
+ *             block_data
+ * Returns: nothing
  *
- * Expected input: A valid location in the ypbpr array, a ypbpr array,
- *                  the element at that location, and a closure struct
- *                   that contains an rgb array, and methods.
- * Success output: none
+ * Expected input: A block at an even column and row, of even width and
+ *                  height, whose rows are blocksize pixels apart
+ * Success output: The planes hold the luma and average chroma of every
+ *                  2-by-2 block inside the block
  * Failure output: none
  */
-void apply_ypbpr_to_rgb(int i, int j, A2Methods_UArray2 ypbpr_array,
-                                                         void *elem, void *cl)
+void convert_block_to_ypbpr(int col, int row, int width, int height,
+                            UArray2b_T pixels, void *block, void *cl)
 {
-    (void) ypbpr_array;
-
-    Pnm_rgb curr_rgb = malloc(sizeof(struct Pnm_rgb));
-    assert(curr_rgb);
-    
-    struct closure_data rgb_data = *(closure_data)cl;
-    A2Methods_UArray2 rgb_array = rgb_data.array;
-    A2Methods_T methods = rgb_data.methods;
-
-    unsigned denominator = 200;
-
-    YPbPr curr_ypbpr = (YPbPr)elem;
-    float y = curr_ypbpr->y;
-    float pr = curr_ypbpr->pr;
-    float pb = curr_ypbpr->pb;
-
-    curr_rgb->red = 
-        force_values_into_range((1.0 * y + 0.0 * pb + 1.402 * pr)
-                                        * denominator, denominator);
-    curr_rgb->green = 
-        force_values_into_range((1.0 * y - 0.344136 * pb - 0.714136 * pr)
-                                             * denominator, denominator);
-    curr_rgb->blue = 
-        force_values_into_range((1.0 * y + 1.772 * pb + 0.0 * pr)
-                                     * denominator, denominator);
-
-
-    *(Pnm_rgb)methods->at(rgb_array, i, j) = *curr_rgb;
-    free(curr_rgb);
+    struct block_data *data = cl;
+    Ypbpr_planes planes = data->planes;
+    size_t row_bytes = (size_t)UArray2b_blocksize(pixels)
+                       * UArray2b_size(pixels);
+    unsigned char *top = block;
+
+    for (int r = row; r < row + height; r += 2) {
+        float *y_top = planes->y + r * planes->stride + col;
+        size_t chroma = (r / 2) * planes->chroma_stride + col / 2;
+
+        samples_to_ypbpr_blocks(top, top + row_bytes, width / 2,
+                                data->denominator, y_top,
+                                y_top + planes->stride,
+                                planes->pb + chroma, planes->pr + chroma);
+        top += 2 * row_bytes;
+    }
 }
 
-/* size_of_ypbpr
- * Purpose: returns the size of a ypbpr struct
- * Parameters: none
- * Returns: A size_t denoting the size of a ypbpr struct
+/* convert_block_to_rgb
+ * Purpose: Fills one block of a blocked pixel array from the part of
+ *          the planes it covers; the apply function convert_ypbpr_to_rgb
+ *          hands to UArray2b_map_blocks
+ * Parameters: The column and row of the block's upper left pixel, the
+ *             width and height of the block within the image, the
+ *             array, a pointer to the block's first pixel, and a
+ *             block_data
+ * Returns: nothing
  *
- * Expected input: none
- * Success output: The correct size of a ypbpr struct
+ * Expected input: A block at an even column and row, of even width and
+ *                  height, whose rows are blocksize pixels apart
+ * Success output: Every pixel of the block holds its packed samples
  * Failure output: none
  */
-size_t size_of_ypbpr()
+void convert_block_to_rgb(int col, int row, int width, int height,
+                          UArray2b_T pixels, void *block, void *cl)
 {
-    return sizeof(struct YPbPr);
+    struct block_data *data = cl;
+    Ypbpr_planes planes = data->planes;
+    size_t row_bytes = (size_t)UArray2b_blocksize(pixels)
+                       * UArray2b_size(pixels);
+    unsigned char *top = block;
+
+    for (int r = row; r < row + height; r += 2) {
+        const float *y_top = planes->y + r * planes->stride + col;
+        size_t chroma = (r / 2) * planes->chroma_stride + col / 2;
+
+        ypbpr_blocks_to_samples(y_top, y_top + planes->stride,
+                                planes->pb + chroma, planes->pr + chroma,
+                                width / 2, data->denominator, top,
+                                top + row_bytes);
+        top += 2 * row_bytes;
+    }
 }
 
-/* get_pb_value
- * Purpose: returns the value of pb in a given ypbpr struct
- * Parameters: a ypbpr struct
- * Returns: The float value pb in the ypbpr struct
+/* samples_to_ypbpr
+ * Purpose: Converts a run of packed rgb samples, as a raw ppm stores
+ *          them, to component video, storing the results as three
+ *          separate arrays (structure of arrays). Uses an AVX2 kernel
+ *          that converts 8 pixels at a time when the CPU supports it
+ *          and the scalar formulas otherwise; both give bit-for-bit
+ *          the same results.
+ * Parameters: An array of samples, the number of pixels, the
+ *              denominator of the image, and arrays for y, pb and pr
+ * Returns: Nothing
  *
- * Expected input: A ypbpr struct
- * Success output: The correct pb value stored 
- * Failure output: none
+ * Expected input: count pixels of red, green and blue samples, one
+ *                  byte each, or two bytes each (most significant
+ *                  first) if the denominator is larger than 255;
+ *                  arrays holding at least count elements and a
+ *                  nonzero denominator
+ * Success output: y[i], pb[i] and pr[i] hold the conversion of pixel i
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-float get_pb_value(YPbPr ypbpr)
+void samples_to_ypbpr(const unsigned char *samples, int count,
+                      unsigned denominator, float *y, float *pb, float *pr)
 {
-    assert(ypbpr != NULL);
-    return ypbpr->pb;
+    assert(count == 0 || (samples != NULL && y != NULL && pb != NULL
+                                                        && pr != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        samples_to_ypbpr_avx2(samples, count, denominator, y, pb, pr);
+        return;
+    }
+#endif
+
+    samples_to_ypbpr_scalar(samples, count, denominator, y, pb, pr);
 }
 
-/* get_pr_value
- * Purpose: returns the value of pr in a given ypbpr struct
- * Parameters: a ypbpr struct
- * Returns: The float value pr in the ypbpr struct
+/* samples_to_ypbpr_scalar
+ * Purpose: Reference version of samples_to_ypbpr that converts one
+ *          pixel at a time. These are the formulas every other
+ *          conversion kernel must match.
+ * Parameters: Same as samples_to_ypbpr
+ * Returns: Nothing
  *
- * Expected input: A ypbpr struct
- * Success output: The correct pr value stored 
+ * Expected input: Same as samples_to_ypbpr
+ * Success output: Same as samples_to_ypbpr
  * Failure output: none
  */
-float get_pr_value(YPbPr ypbpr)
+void samples_to_ypbpr_scalar(const unsigned char *samples, int count,
+                             unsigned denominator, float *y, float *pb,
+                             float *pr)
 {
-    assert(ypbpr != NULL);
-    return ypbpr->pr;
+    bool deep = denominator > 255;
+
+    for (int i = 0; i < count; i++) {
+        unsigned red, green, blue;
+
+        if (deep) {
+            red = samples[0] << 8 | samples[1];
+            green = samples[2] << 8 | samples[3];
+            blue = samples[4] << 8 | samples[5];
+            samples += 6;
+        } else {
+            red = samples[0];
+            green = samples[1];
+            blue = samples[2];
+            samples += 3;
+        }
+
+        float r = red / (float)denominator;
+        float g = green / (float)denominator;
+        float b = blue / (float)denominator;
+
+        y[i] = 0.299 * r + 0.587 * g + 0.114 * b;
+        pb[i] = -0.168736 * r - 0.331264 * g + 0.5 * b;
+        pr[i] = 0.5 * r - 0.418688 * g - 0.081312 * b;
+    }
 }
 
-/* get_y_value
- * Purpose: returns the value of y in a given ypbpr struct
- * Parameters: a ypbpr struct
- * Returns: The float value y in the ypbpr struct
+#ifdef HAVE_AVX2_KERNELS
+/* samples_to_ypbpr_avx2
+ * Purpose: AVX2 version of samples_to_ypbpr. Gathers each channel of
+ *          8 pixels straight out of the packed samples and divides
+ *          them in single precision, then widens to double for the
+ *          weighted sums, exactly as C promotes the scalar formulas,
+ *          so every result rounds to the same float.
+ * Parameters: Same as samples_to_ypbpr
+ * Returns: Nothing
  *
- * Expected input: A ypbpr struct
- * Success output: The correct y value stored 
+ * Expected input: Same as samples_to_ypbpr, on a CPU with AVX2
+ * Success output: Same as samples_to_ypbpr
  * Failure output: none
  */
-float get_y_value(YPbPr ypbpr)
+AVX2_KERNEL
+void samples_to_ypbpr_avx2(const unsigned char *samples, int count,
+                           unsigned denominator, float *y, float *pb,
+                           float *pr)
 {
-    assert(ypbpr != NULL);
-    return ypbpr->y;
-}
+    bool deep = denominator > 255;
+    int sample_bytes = deep ? 2 : 1;
+    int pixel_bytes = 3 * sample_bytes;
+
+    const __m256i lanes = _mm256_mullo_epi32(
+                                _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                                _mm256_set1_epi32(pixel_bytes));
+
+    /* Each gathered lane holds a sample in its low byte or, for deep
+     * images, a big-endian sample in its low two bytes; the shuffle
+     * keeps just the sample, in host order */
+    const __m256i narrow = deep
+        ? _mm256_setr_epi8(1, 0, -1, -1, 5, 4, -1, -1,
+                           9, 8, -1, -1, 13, 12, -1, -1,
+                           1, 0, -1, -1, 5, 4, -1, -1,
+                           9, 8, -1, -1, 13, 12, -1, -1)
+        : _mm256_setr_epi8(0, -1, -1, -1, 4, -1, -1, -1,
+                           8, -1, -1, -1, 12, -1, -1, -1,
+                           0, -1, -1, -1, 4, -1, -1, -1,
+                           8, -1, -1, -1, 12, -1, -1, -1);
+    const __m256 denom = _mm256_set1_ps((float)denominator);
+    int i = 0;
+
+    /* A gather reads 4 bytes from the start of a sample, which runs
+     * past the last pixel, so stop while at least one pixel follows */
+    for (; i + 8 < count; i += 8) {
+        const char *base = (const char *)samples + (size_t)i * pixel_bytes;
+        __m256 channel[3];
+
+        for (int c = 0; c < 3; c++) {
+            __m256i v = _mm256_i32gather_epi32(
+                        (const int *)(base + c * sample_bytes), lanes, 1);
+            channel[c] = _mm256_div_ps(_mm256_cvtepi32_ps(
+                                    _mm256_shuffle_epi8(v, narrow)), denom);
+        }
+
+        __m256 r8 = channel[0];
+        __m256 g8 = channel[1];
+        __m256 b8 = channel[2];
+
+        /* Four pixels at a time once widened to double */
+        for (int half = 0; half < 2; half++) {
+            __m256d r = _mm256_cvtps_pd(half ? _mm256_extractf128_ps(r8, 1)
+                                             : _mm256_castps256_ps128(r8));
+            __m256d g = _mm256_cvtps_pd(half ? _mm256_extractf128_ps(g8, 1)
+                                             : _mm256_castps256_ps128(g8));
+            __m256d b = _mm256_cvtps_pd(half ? _mm256_extractf128_ps(b8, 1)
+                                             : _mm256_castps256_ps128(b8));
+
+            __m256d y4 = _mm256_add_pd(_mm256_add_pd(
+                    _mm256_mul_pd(_mm256_set1_pd(0.299), r),
+                    _mm256_mul_pd(_mm256_set1_pd(0.587), g)),
+                    _mm256_mul_pd(_mm256_set1_pd(0.114), b));
+            __m256d pb4 = _mm256_add_pd(_mm256_sub_pd(
+                    _mm256_mul_pd(_mm256_set1_pd(-0.168736), r),
+                    _mm256_mul_pd(_mm256_set1_pd(0.331264), g)),
+                    _mm256_mul_pd(_mm256_set1_pd(0.5), b));
+            __m256d pr4 = _mm256_sub_pd(_mm256_sub_pd(
+                    _mm256_mul_pd(_mm256_set1_pd(0.5), r),
+                    _mm256_mul_pd(_mm256_set1_pd(0.418688), g)),
+                    _mm256_mul_pd(_mm256_set1_pd(0.081312), b));
+
+            int at = i + 4 * half;
+            _mm_storeu_ps(&y[at], _mm256_cvtpd_ps(y4));
+            _mm_storeu_ps(&pb[at], _mm256_cvtpd_ps(pb4));
+            _mm_storeu_ps(&pr[at], _mm256_cvtpd_ps(pr4));
+        }
+    }
 
-/* set_pb_value
- * Purpose: sets the value of pb in a given ypbpr struct
- * Parameters: a ypbpr struct and a float
- * Returns: nothing
+    samples_to_ypbpr_scalar(samples + (size_t)i * pixel_bytes, count - i,
+                            denominator, y + i, pb + i, pr + i);
+}
+#endif
+
+/* samples_to_ypbpr_blocks
+ * Purpose: Converts the two scanlines of a row of 2-by-2 blocks to
+ *          component video, keeping the luma of every pixel but only
+ *          the average chroma of each block. The scanlines go through
+ *          samples_to_ypbpr a chunk at a time, so full-resolution
+ *          chroma only ever exists in a small scratch buffer.
+ * Parameters: The top and bottom scanlines as packed samples, the
+ *              number of blocks, the denominator of the image, arrays
+ *              for the luma of the top and bottom scanlines, and arrays
+ *              for the average pb and pr of each block
+ * Returns: Nothing
  *
- * Expected input: A ypbpr struct and a float value
- * Success output: none
- * Failure output: none
+ * Expected input: Scanlines of at least 2 * blocks pixels, luma arrays
+ *                  of at least 2 * blocks elements, chroma arrays of at
+ *                  least blocks elements, and a nonzero denominator
+ * Success output: pb[i] and pr[i] hold the sum of the chroma of block
+ *                  i's pixels, added top-left, top-right, bottom-left,
+ *                  bottom-right, divided by 4
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void set_pb_value(YPbPr ypbpr, float value)
+void samples_to_ypbpr_blocks(const unsigned char *top,
+                             const unsigned char *bottom, int blocks,
+                             unsigned denominator, float *y_top,
+                             float *y_bottom, float *pb, float *pr)
 {
-    assert(ypbpr != NULL);
-    ypbpr->pb = value;
+    assert(blocks == 0 || (top != NULL && bottom != NULL && y_top != NULL
+                           && y_bottom != NULL && pb != NULL && pr != NULL));
+
+    size_t pixel_bytes = ppm_pixel_bytes(denominator);
+    float chroma[4][ROW_CHUNK];     /* pb and pr of the top and bottom */
+
+    for (int done = 0; done < 2 * blocks; done += ROW_CHUNK) {
+        int count = 2 * blocks - done;
+        if (count > ROW_CHUNK) {
+            count = ROW_CHUNK;
+        }
+
+        samples_to_ypbpr(top + done * pixel_bytes, count, denominator,
+                         y_top + done, chroma[0], chroma[1]);
+        samples_to_ypbpr(bottom + done * pixel_bytes, count, denominator,
+                         y_bottom + done, chroma[2], chroma[3]);
+
+        for (int k = 0; k < count / 2; k++) {
+            float pb_add = 0;
+            float pr_add = 0;
+
+            pb_add += chroma[0][2 * k];
+            pb_add += chroma[0][2 * k + 1];
+            pb_add += chroma[2][2 * k];
+            pb_add += chroma[2][2 * k + 1];
+
+            pr_add += chroma[1][2 * k];
+            pr_add += chroma[1][2 * k + 1];
+            pr_add += chroma[3][2 * k];
+            pr_add += chroma[3][2 * k + 1];
+
+            pb[done / 2 + k] = pb_add / 4.0;
+            pr[done / 2 + k] = pr_add / 4.0;
+        }
+    }
 }
 
-/* set_pr_value
- * Purpose: sets the value of pr in a given ypbpr struct
- * Parameters: a ypbpr struct and a float
- * Returns: nothing
+/* ypbpr_blocks_to_samples
+ * Purpose: Converts a row of 2-by-2 blocks in component video back to
+ *          two scanlines of packed samples; the reverse of
+ *          samples_to_ypbpr_blocks. Each pixel takes its block's
+ *          chroma.
+ * Parameters: Arrays for the luma of the top and bottom scanlines,
+ *              arrays of the pb and pr of each block, the number of
+ *              blocks, the denominator of the output image, and the
+ *              top and bottom scanlines to fill in
+ * Returns: Nothing
  *
- * Expected input: A ypbpr struct and a float value
- * Success output: none
- * Failure output: none
+ * Expected input: Luma arrays of at least 2 * blocks elements, chroma
+ *                  arrays of at least blocks elements, room for 2 *
+ *                  blocks pixels in each scanline, and a denominator no
+ *                  larger than 65535
+ * Success output: The scanlines hold the pixels of the blocks, as
+ *                  ypbpr_to_samples converts them
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void set_pr_value(YPbPr ypbpr, float value)
+void ypbpr_blocks_to_samples(const float *y_top, const float *y_bottom,
+                             const float *pb, const float *pr, int blocks,
+                             unsigned denominator, unsigned char *top,
+                             unsigned char *bottom)
 {
-    assert(ypbpr != NULL);
-    ypbpr->pr = value;
+    assert(blocks == 0 || (top != NULL && bottom != NULL && y_top != NULL
+                           && y_bottom != NULL && pb != NULL && pr != NULL));
+
+    size_t pixel_bytes = ppm_pixel_bytes(denominator);
+    float pixel_pb[ROW_CHUNK], pixel_pr[ROW_CHUNK];
+
+    for (int done = 0; done < 2 * blocks; done += ROW_CHUNK) {
+        int count = 2 * blocks - done;
+        if (count > ROW_CHUNK) {
+            count = ROW_CHUNK;
+        }
+
+        /* Both scanlines share the chroma of their blocks */
+        for (int k = 0; k < count / 2; k++) {
+            pixel_pb[2 * k] = pixel_pb[2 * k + 1] = pb[done / 2 + k];
+            pixel_pr[2 * k] = pixel_pr[2 * k + 1] = pr[done / 2 + k];
+        }
+
+        ypbpr_to_samples(y_top + done, pixel_pb, pixel_pr, count,
+                         denominator, top + done * pixel_bytes);
+        ypbpr_to_samples(y_bottom + done, pixel_pb, pixel_pr, count,
+                         denominator, bottom + done * pixel_bytes);
+    }
 }
 
-/* set_y_value
- * Purpose: sets the value of y in a given ypbpr struct
- * Parameters: a ypbpr struct and a float value
- * Returns: nothing
+/* ypbpr_to_samples
+ * Purpose: Converts a run of component video pixels, stored as three
+ *          separate arrays, back to packed rgb samples as a raw ppm
+ *          stores them, forcing each channel into the range
+ *          [0, denominator]. Uses an AVX2 kernel that converts 8
+ *          pixels at a time and clamps with vector min/max when the
+ *          CPU supports it and the scalar formulas otherwise; both
+ *          give the same results.
+ * Parameters: Arrays of y, pb and pr values, the number of pixels, the
+ *              denominator of the output image, and an array for the
+ *              samples
+ * Returns: Nothing
  *
- * Expected input: A ypbpr struct and a value
- * Success output: none
- * Failure output: none
+ * Expected input: Arrays holding at least count elements, room for
+ *                  count pixels of samples (one byte each, or two if
+ *                  the denominator is larger than 255), and a
+ *                  denominator no larger than 65535
+ * Success output: Pixel i of samples holds the conversion of y[i],
+ *                  pb[i] and pr[i]
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void set_y_value(YPbPr ypbpr, float value)
+void ypbpr_to_samples(const float *y, const float *pb, const float *pr,
+                      int count, unsigned denominator,
+                      unsigned char *samples)
 {
-    assert(ypbpr != NULL);
-    ypbpr->y = value;
+    assert(count == 0 || (samples != NULL && y != NULL && pb != NULL
+                                                        && pr != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        ypbpr_to_samples_avx2(y, pb, pr, count, denominator, samples);
+        return;
+    }
+#endif
+
+    ypbpr_to_samples_scalar(y, pb, pr, count, denominator, samples);
 }
 
-/* make_block_array
- * Purpose: makes a UArray_T of size 4 of a block in the ypbpr array
- * Parameters: an UArray2 of ypbpr structs, 2 ints denotinga a location
- *              in that array, and methods
- * Returns: A UArray of size 4
+/* ypbpr_to_samples_scalar
+ * Purpose: Reference version of ypbpr_to_samples that converts one
+ *          pixel at a time. These are the formulas every other
+ *          conversion kernel must match.
+ * Parameters: Same as ypbpr_to_samples
+ * Returns: Nothing
  *
- * Expected input: A valid ypbpr array, a location in that array,
- *                  methods
- * Success output: A UArray_T of size 4 of a block in the given
- *                  ypbpr array
+ * Expected input: Same as ypbpr_to_samples
+ * Success output: Same as ypbpr_to_samples
  * Failure output: none
  */
-UArray_T make_block_array(A2Methods_UArray2 ypbpr_array, int col, int row,
-                                                         A2Methods_T methods)
+void ypbpr_to_samples_scalar(const float *y, const float *pb,
+                             const float *pr, int count,
+                             unsigned denominator, unsigned char *samples)
 {
-    assert(ypbpr_array != NULL);
-    assert(methods != NULL);
-
-    UArray_T block_array = UArray_new(4, sizeof(struct YPbPr));
-
-    *(YPbPr)UArray_at(block_array, 0) = *(YPbPr)methods->at(ypbpr_array, col,
-                                                                         row);
-    *(YPbPr)UArray_at(block_array, 1) = *(YPbPr)methods->at(ypbpr_array,
-                                                                 col + 1, row);
-    *(YPbPr)UArray_at(block_array, 2) = *(YPbPr)methods->at(ypbpr_array, col,
-                                                                     row + 1);
-    *(YPbPr)UArray_at(block_array, 3) = *(YPbPr)methods->at(ypbpr_array,
-                                                             col + 1, row + 1);
-    return block_array;
+    bool deep = denominator > 255;
+
+    for (int i = 0; i < count; i++) {
+        unsigned red = 
+            force_values_into_range((1.0 * y[i] + 0.0 * pb[i]
+                            + 1.402 * pr[i]) * denominator, denominator);
+        unsigned green = 
+            force_values_into_range((1.0 * y[i] - 0.344136 * pb[i]
+                         - 0.714136 * pr[i]) * denominator, denominator);
+        unsigned blue = 
+            force_values_into_range((1.0 * y[i] + 1.772 * pb[i]
+                              + 0.0 * pr[i]) * denominator, denominator);
+
+        if (deep) {
+            samples[0] = red >> 8;
+            samples[1] = red;
+            samples[2] = green >> 8;
+            samples[3] = green;
+            samples[4] = blue >> 8;
+            samples[5] = blue;
+            samples += 6;
+        } else {
+            samples[0] = red;
+            samples[1] = green;
+            samples[2] = blue;
+            samples += 3;
+        }
+    }
 }
 
-/* set_ypbpr_block
- * Purpose: sets the values in a UArray_T of size 4 with the proper
- *          values that they will store from the ypbpr array
- * Parameters: an UArray2 of ypbpr structs, 2 ints denotinga a location
- *              in that array, methods, and a UArray
- * Returns: nothing
+#ifdef HAVE_AVX2_KERNELS
+/* ypbpr_to_samples_avx2
+ * Purpose: AVX2 version of ypbpr_to_samples. Evaluates the formulas
+ *          in double on 4 pixels at a time, exactly as C promotes the
+ *          scalar ones, rounds to float as force_values_into_range's
+ *          parameter does, then clamps all 8 lanes to [0, denominator]
+ *          with min/max, truncates them to integers and packs them.
+ * Parameters: Same as ypbpr_to_samples
+ * Returns: Nothing
  *
- * Expected input: A valid ypbpr array, a location in that array,
- *                  methods, and a valid block_array of size 4
- * Success output: none
+ * Expected input: Same as ypbpr_to_samples, on a CPU with AVX2
+ * Success output: Same as ypbpr_to_samples
  * Failure output: none
  */
-void set_ypbpr_block(A2Methods_UArray2 ypbpr_array, int col, int row,
-                          A2Methods_T methods, UArray_T block_array)
+AVX2_KERNEL
+void ypbpr_to_samples_avx2(const float *y, const float *pb,
+                           const float *pr, int count,
+                           unsigned denominator, unsigned char *samples)
 {
-    assert(ypbpr_array != NULL);
-    assert(methods != NULL);
-    assert(block_array != NULL);
-
-    *(YPbPr)methods->at(ypbpr_array, col, row) =
-                                            *(YPbPr)UArray_at(block_array, 0);
-    *(YPbPr)methods->at(ypbpr_array, col + 1, row) =
-                                            *(YPbPr)UArray_at(block_array, 1);
-    *(YPbPr)methods->at(ypbpr_array, col, row + 1) =
-                                            *(YPbPr)UArray_at(block_array, 2);
-    *(YPbPr)methods->at(ypbpr_array, col + 1, row + 1) =
-                                            *(YPbPr)UArray_at(block_array, 3);
+    const __m256d denom = _mm256_set1_pd(denominator);
+    const __m256 ceiling = _mm256_set1_ps(denominator);
+    const __m256 floor = _mm256_setzero_ps();
+    bool deep = denominator > 255;
+    int pixel_bytes = deep ? 6 : 3;
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128 channels[3][2];
+
+        /* Four pixels at a time once widened to double */
+        for (int half = 0; half < 2; half++) {
+            int at = i + 4 * half;
+            __m256d y4 = _mm256_cvtps_pd(_mm_loadu_ps(&y[at]));
+            __m256d pb4 = _mm256_cvtps_pd(_mm_loadu_ps(&pb[at]));
+            __m256d pr4 = _mm256_cvtps_pd(_mm_loadu_ps(&pr[at]));
+
+            __m256d r = _mm256_add_pd(_mm256_add_pd(
+                    _mm256_mul_pd(_mm256_set1_pd(1.0), y4),
+                    _mm256_mul_pd(_mm256_set1_pd(0.0), pb4)),
+                    _mm256_mul_pd(_mm256_set1_pd(1.402), pr4));
+            __m256d g = _mm256_sub_pd(_mm256_sub_pd(
+                    _mm256_mul_pd(_mm256_set1_pd(1.0), y4),
+                    _mm256_mul_pd(_mm256_set1_pd(0.344136), pb4)),
+                    _mm256_mul_pd(_mm256_set1_pd(0.714136), pr4));
+            __m256d b = _mm256_add_pd(_mm256_add_pd(
+                    _mm256_mul_pd(_mm256_set1_pd(1.0), y4),
+                    _mm256_mul_pd(_mm256_set1_pd(1.772), pb4)),
+                    _mm256_mul_pd(_mm256_set1_pd(0.0), pr4));
+
+            channels[0][half] = _mm256_cvtpd_ps(_mm256_mul_pd(r, denom));
+            channels[1][half] = _mm256_cvtpd_ps(_mm256_mul_pd(g, denom));
+            channels[2][half] = _mm256_cvtpd_ps(_mm256_mul_pd(b, denom));
+        }
+
+        unsigned out[3][8];
+        for (int c = 0; c < 3; c++) {
+            __m256 value = _mm256_set_m128(channels[c][1], channels[c][0]);
+            value = _mm256_max_ps(_mm256_min_ps(value, ceiling), floor);
+            _mm256_storeu_si256((__m256i *)out[c],
+                                _mm256_cvttps_epi32(value));
+        }
+
+        unsigned char *pixel = samples + (size_t)i * pixel_bytes;
+        for (int k = 0; k < 8; k++) {
+            for (int c = 0; c < 3; c++) {
+                if (deep) {
+                    *pixel++ = out[c][k] >> 8;
+                }
+                *pixel++ = out[c][k];
+            }
+        }
+    }
+
+    ypbpr_to_samples_scalar(y + i, pb + i, pr + i, count - i, denominator,
+                            samples + (size_t)i * pixel_bytes);
 }
+#endif
 
 /* force_values_into_range
  * Purpose: helper function that forces a float value into a given
@@ -19,187 +19,196 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <assert.h>
 #include <a2methods.h>
 #include <a2plain.h>
+#include <a2blocked.h>
 #include <pnm.h>
-#include <uarray.h>
 
-typedef struct YPbPr *YPbPr;
+#include "imagearena.h"
+
+/* Side of the blocks of a blocked pixel array: a power of two, so its
+ * cells are found with shifts and masks, and even, so no 2-by-2 block
+ * of the codec ever straddles two of them. 64 by 64 deep pixels take
+ * 24KB. */
+#define PIXEL_BLOCKSIZE 64
+
+/* An image in component video, kept as separate planes rather than a
+ * struct per pixel so the block kernels can stream through each
+ * component. Chroma is only ever used averaged over a 2-by-2 block, so
+ * the Pb and Pr planes hold one value per block: the average of the
+ * block's four pixels. Pixel (col, row) of the y plane is at
+ * y[row * stride + col] and block (col, row) of a chroma plane at
+ * pb[row * chroma_stride + col]; every row starts on a 64-byte
+ * boundary. */
+typedef struct Ypbpr_planes {
+    int width, height;
+    size_t stride;          /* floats from one y row to the next */
+    size_t chroma_stride;   /* floats from one chroma row to the next */
+    float *y, *pb, *pr;
+    Image_arena arena;      /* owner of the planes, or NULL if malloc'd */
+} *Ypbpr_planes;
+
+/* ypbpr_planes_new
+ * Purpose: Allocates the planes of a component video image. The
+ *          storage comes from the selected image arena when there is
+ *          one (see imagearena.h).
+ * Parameters: The width and height of the image
+ * Returns: A Ypbpr_planes
+ *
+ * Expected input: A nonnegative, even width and height
+ * Success output: A width by height y plane and two half width by half
+ *                  height chroma planes, all zero
+ * Failure output: Raises a Checked Runtime Error if allocation fails or
+ *                  either dimension is odd
+ */
+Ypbpr_planes ypbpr_planes_new(int width, int height);
 
-typedef struct closure_data *closure_data;
+/* ypbpr_planes_free
+ * Purpose: Frees a set of planes. Storage that came from an arena is
+ *          left for the arena to take back.
+ * Parameters: A pointer to a Ypbpr_planes
+ * Returns: nothing
+ *
+ * Expected input: A pointer to valid planes
+ * Success output: The planes are freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if planes is NULL
+ */
+void ypbpr_planes_free(Ypbpr_planes *planes);
 
 /* convert_rgb_to_ypbpr
- * Purpose: Converts an array of rgb structs into an array of ypbpr
- *          structs
+ * Purpose: Converts an array of packed rgb pixels into component video
+ *          planes, handing each pair of rows straight to
+ *          samples_to_ypbpr_blocks so that no full-resolution chroma
+ *          is ever stored. A blocked array is converted one of its
+ *          blocks at a time, a pair of the block's rows per call.
  * Parameters: A ppm and methods
- * Returns: A UArray2 of ypbpr structs
- *
- * Expected input: A valid ppm and methods
- * Success output: A UArray2 of ypbpr structs
- * Failure output: none
+ * Returns: The Ypbpr_planes of the image
+ *
+ * Expected input: A valid ppm of even width and height whose pixels are
+ *                  packed samples (see ppmstream.h), in a plain array
+ *                  or a blocked one of even blocksize, and the methods
+ *                  that made it
+ * Success output: Planes the size of the ppm holding its luma and the
+ *                  average chroma of each block
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-A2Methods_UArray2 convert_rgb_to_ypbpr(Pnm_ppm ppm, A2Methods_T methods);
+Ypbpr_planes convert_rgb_to_ypbpr(Pnm_ppm ppm, A2Methods_T methods);
 
 /* convert_ypbpr_to_rgb
- * Purpose: Converts an array of ypbpr structs into an array of rgb
- *          structs
- * Parameters: A UArray2 of ypbpr structs and methods
- * Returns: A UArray2 of rgb structs
- *
- * Expected input: A UArray2 of ypbpr structs and methods
- * Success output: A UArray2 of rgb structs
- * Failure output: none
+ * Purpose: Converts component video planes into an array of packed
+ *          rgb pixels with a denominator of 200, a pair of rows at a
+ *          time with ypbpr_blocks_to_samples. With blocked methods the
+ *          array has blocks of PIXEL_BLOCKSIZE and is filled one of
+ *          its blocks at a time.
+ * Parameters: A Ypbpr_planes and methods
+ * Returns: An array of packed rgb pixels made by methods
+ *
+ * Expected input: Valid planes, and uarray2_methods_plain or
+ *                  uarray2_methods_blocked
+ * Success output: An array whose elements are packed samples (see
+ *                  ppmstream.h), 3 bytes each, where every pixel of a
+ *                  block takes the block's chroma
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-A2Methods_UArray2 convert_ypbpr_to_rgb(A2Methods_UArray2 array,
-                                             A2Methods_T methods);
-
-/* apply_rgb_to_ypbpr
- * Purpose: Apply function to the mapping function that iterates over
- *          the array of rgb structs. Converts rgb values to ypbpr
- *          values and sets the correct ypbpr struct values in the
- *           array of ypbpr structs
- * Parameters: Two integers denoting a location, an array of rgb
- *              structs, the element at (i, j), and a closure, which
- *              holds a struct that contains methods, the correct
- *              denominator of the ppm, and the array of ypbpr structs
+A2Methods_UArray2 convert_ypbpr_to_rgb(Ypbpr_planes planes,
+                                       A2Methods_T methods);
+
+/* samples_to_ypbpr
+ * Purpose: Converts a run of packed rgb samples, as a raw ppm stores
+ *          them, to component video, storing the results as three
+ *          separate arrays (structure of arrays). Uses an AVX2 kernel
+ *          that converts 8 pixels at a time when the CPU supports it
+ *          and the scalar formulas otherwise; both give bit-for-bit
+ *          the same results.
+ * Parameters: An array of samples, the number of pixels, the
+ *              denominator of the image, and arrays for y, pb and pr
  * Returns: Nothing
  *
- * Expected input: A valid location in the rgb array, an rgb array,
- *                  the element at that location, and a closure struct
- *                   that contains a ypbpr array, a denominator, and
- *                   methods.
- * Success output: none
- * Failure output: none
+ * Expected input: count pixels of red, green and blue samples, one
+ *                  byte each, or two bytes each (most significant
+ *                  first) if the denominator is larger than 255;
+ *                  arrays holding at least count elements and a
+ *                  nonzero denominator
+ * Success output: y[i], pb[i] and pr[i] hold the conversion of pixel i
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void apply_rgb_to_ypbpr(int i, int j, A2Methods_UArray2 rgb_array,
-                                                         void *elem, void *cl);
-
-/* apply_ypbpr_to_rgb
- * Purpose: Apply function to the mapping function that iterates over
- *          the array of ypbpr structs. Converts ypbpr values to rgb
- *          values and sets the correct rgb struct values in the
- *           array of rgb structs
- * Parameters: Two integers denoting a location, an array of ypbpr
- *              structs, the element at (i, j), and a closure, which
- *              holds a struct that contains methods and the array 
- *              of rgb structs
+void samples_to_ypbpr(const unsigned char *samples, int count,
+                      unsigned denominator, float *y, float *pb, float *pr);
+
+/* samples_to_ypbpr_blocks
+ * Purpose: Converts the two scanlines of a row of 2-by-2 blocks to
+ *          component video, keeping the luma of every pixel but only
+ *          the average chroma of each block. The scanlines go through
+ *          samples_to_ypbpr a chunk at a time, so full-resolution
+ *          chroma only ever exists in a small scratch buffer.
+ * Parameters: The top and bottom scanlines as packed samples, the
+ *              number of blocks, the denominator of the image, arrays
+ *              for the luma of the top and bottom scanlines, and arrays
+ *              for the average pb and pr of each block
  * Returns: Nothing
  *
- * Expected input: A valid location in the ypbpr array, a ypbpr array,
- *                  the element at that location, and a closure struct
- *                   that contains an rgb array, and methods.
- * Success output: none
- * Failure output: none
+ * Expected input: Scanlines of at least 2 * blocks pixels, luma arrays
+ *                  of at least 2 * blocks elements, chroma arrays of at
+ *                  least blocks elements, and a nonzero denominator
+ * Success output: pb[i] and pr[i] hold the sum of the chroma of block
+ *                  i's pixels, added top-left, top-right, bottom-left,
+ *                  bottom-right, divided by 4
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void apply_ypbpr_to_rgb(int i, int j, A2Methods_UArray2 ypbpr_array,
-                                                         void *elem, void *cl);
-
-/* size_of_ypbpr
- * Purpose: returns the size of a ypbpr struct
- * Parameters: none
- * Returns: A size_t denoting the size of a ypbpr struct
- *
- * Expected input: none
- * Success output: The correct size of a ypbpr struct
- * Failure output: none
- */
-size_t size_of_ypbpr();
-
-/* get_pb_value
- * Purpose: returns the value of pb in a given ypbpr struct
- * Parameters: a ypbpr struct
- * Returns: The float value pb in the ypbpr struct
- *
- * Expected input: A ypbpr struct
- * Success output: The correct pb value stored 
- * Failure output: none
- */
-float get_pb_value(YPbPr ypbpr);
-
-/* get_pr_value
- * Purpose: returns the value of pr in a given ypbpr struct
- * Parameters: a ypbpr struct
- * Returns: The float value pr in the ypbpr struct
- *
- * Expected input: A ypbpr struct
- * Success output: The correct pr value stored 
- * Failure output: none
- */
-float get_pr_value(YPbPr ypbpr);
-
-/* get_y_value
- * Purpose: returns the value of y in a given ypbpr struct
- * Parameters: a ypbpr struct
- * Returns: The float value y in the ypbpr struct
- *
- * Expected input: A ypbpr struct
- * Success output: The correct y value stored 
- * Failure output: none
- */
-float get_y_value(YPbPr ypbpr);
-
-/* set_pb_value
- * Purpose: sets the value of pb in a given ypbpr struct
- * Parameters: a ypbpr struct and a float
- * Returns: nothing
- *
- * Expected input: A ypbpr struct and a float value
- * Success output: none
- * Failure output: none
- */
-void set_pb_value(YPbPr ypbpr, float value);
-
-/* set_pr_value
- * Purpose: sets the value of pr in a given ypbpr struct
- * Parameters: a ypbpr struct and a float
- * Returns: nothing
- *
- * Expected input: A ypbpr struct and a float value
- * Success output: none
- * Failure output: none
- */
-void set_pr_value(YPbPr ypbpr, float value);
-
-/* set_y_value
- * Purpose: sets the value of y in a given ypbpr struct
- * Parameters: a ypbpr struct and a float value
- * Returns: nothing
- *
- * Expected input: A ypbpr struct and a value
- * Success output: none
- * Failure output: none
- */
-void set_y_value(YPbPr ypbpr, float value);
-
-/* make_block_array
- * Purpose: makes a UArray_T of size 4 of a block in the ypbpr array
- * Parameters: an UArray2 of ypbpr structs, 2 ints denotinga a location
- *              in that array, and methods
- * Returns: A UArray of size 4
+void samples_to_ypbpr_blocks(const unsigned char *top,
+                             const unsigned char *bottom, int blocks,
+                             unsigned denominator, float *y_top,
+                             float *y_bottom, float *pb, float *pr);
+
+/* ypbpr_blocks_to_samples
+ * Purpose: Converts a row of 2-by-2 blocks in component video back to
+ *          two scanlines of packed samples; the reverse of
+ *          samples_to_ypbpr_blocks. Each pixel takes its block's
+ *          chroma.
+ * Parameters: Arrays for the luma of the top and bottom scanlines,
+ *              arrays of the pb and pr of each block, the number of
+ *              blocks, the denominator of the output image, and the
+ *              top and bottom scanlines to fill in
+ * Returns: Nothing
  *
- * Expected input: A valid ypbpr array, a location in that array,
- *                  methods
- * Success output: A UArray_T of size 4 of a block in the given
- *                  ypbpr array
- * Failure output: none
+ * Expected input: Luma arrays of at least 2 * blocks elements, chroma
+ *                  arrays of at least blocks elements, room for 2 *
+ *                  blocks pixels in each scanline, and a denominator no
+ *                  larger than 65535
+ * Success output: The scanlines hold the pixels of the blocks, as
+ *                  ypbpr_to_samples converts them
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-UArray_T make_block_array(A2Methods_UArray2 ypbpr_array, int col, int row,
-                                                     A2Methods_T methods);
-
-/* set_ypbpr_block
- * Purpose: sets the values in a UArray_T of size 4 with the proper
- *          values that they will store from the ypbpr array
- * Parameters: an UArray2 of ypbpr structs, 2 ints denotinga a location
- *              in that array, methods, and a UArray
- * Returns: nothing
+void ypbpr_blocks_to_samples(const float *y_top, const float *y_bottom,
+                             const float *pb, const float *pr, int blocks,
+                             unsigned denominator, unsigned char *top,
+                             unsigned char *bottom);
+
+/* ypbpr_to_samples
+ * Purpose: Converts a run of component video pixels, stored as three
+ *          separate arrays, back to packed rgb samples as a raw ppm
+ *          stores them, forcing each channel into the range
+ *          [0, denominator]. Uses an AVX2 kernel that converts 8
+ *          pixels at a time and clamps with vector min/max when the
+ *          CPU supports it and the scalar formulas otherwise; both
+ *          give the same results.
+ * Parameters: Arrays of y, pb and pr values, the number of pixels, the
+ *              denominator of the output image, and an array for the
+ *              samples
+ * Returns: Nothing
  *
- * Expected input: A valid ypbpr array, a location in that array,
- *                  methods, and a valid block_array of size 4
- * Success output: none
- * Failure output: none
+ * Expected input: Arrays holding at least count elements, room for
+ *                  count pixels of samples (one byte each, or two if
+ *                  the denominator is larger than 255), and a
+ *                  denominator no larger than 65535
+ * Success output: Pixel i of samples holds the conversion of y[i],
+ *                  pb[i] and pr[i]
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void set_ypbpr_block(A2Methods_UArray2 ypbpr_array, int col, int row,
-                          A2Methods_T methods, UArray_T block_array);
+void ypbpr_to_samples(const float *y, const float *pb, const float *pr,
+                      int count, unsigned denominator,
+                      unsigned char *samples);
 
 #endif
\ No newline at end of file
@@ -17,11 +17,13 @@
  **************************************************************/
 #include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
 
 #include <assert.h>
 #include <compress40.h>
 #include <a2methods.h>
 #include <a2plain.h>
+#include <a2blocked.h>
 #include <uarray.h>
 #include <pnm.h>
 #include <bitpack.h>
@@ -30,45 +32,323 @@
 #include "quantize.h"
 #include "codeword.h"
 #include "dctrans.h"
-
-
+#include "codec40.h"
+#include "ppmstream.h"
+#include "blockcodec.h"
+#include "threadpool.h"
+#include "imagearena.h"
+#include "wordstream.h"
+#include "uarray2.h"
+#include "uarray2b.h"
+#include "plainrows.h"
+
+/* Block rows each worker codes between reads of the input */
+#define BAND_ROWS_PER_WORKER 4
+
+/* band holds the rows of blocks that the workers share between one
+ * read of the input and the next. Block row r of the band covers
+ * scanlines 2r and 2r + 1 of pixels and words r * blocks onwards.
+ * Scanlines are packed samples (see ppmstream.h); when compressing,
+ * pixels points into the Ppm_reader rather than at the band's own
+ * buffer. */
+struct band {
+    unsigned char *pixels;
+    unsigned char *buffer;      /* NULL unless the band owns its pixels */
+    size_t stride;              /* bytes in one stored scanline */
+    uint32_t *words;
+    int blocks;                 /* blocks in one block row */
+    int rows;                   /* block rows currently in the band */
+    unsigned denominator;
+    Blockcodec *codecs;         /* one per worker */
+};
+
+static int codec_threads = 1;
+static Word_output word_output = WORDS_STDIO;
+static Pixel_layout pixel_layout = PIXELS_PLAIN;
+
+/* Building with -DCODEC_FIXED_POINT makes the streaming codec use
+ * fixed-point arithmetic unless told otherwise */
+#ifdef CODEC_FIXED_POINT
+static Codec_arithmetic codec_arithmetic = CODEC_FIXED;
+#else
+static Codec_arithmetic codec_arithmetic = CODEC_FLOAT;
+#endif
+
+/* Storage for the arrays of the staged path. It lives for the whole
+ * process so each image reuses the buffer the last one grew. */
+static Image_arena staged_arena = NULL;
+
+
+Pnm_ppm read_ppm(FILE *input, A2Methods_T methods);
+void write_ppm(FILE *output, Pnm_ppm ppm);
 Pnm_ppm trim(Pnm_ppm ppm);
+A2Methods_T pixel_methods(void);
+void begin_staged_image(void);
+void end_staged_image(void);
+
+struct band *band_new(int capacity, size_t stride, int blocks,
+                      unsigned denominator, int workers, bool owns_pixels);
+void band_free(struct band **band, int workers);
+void encode_band(int worker, int workers, void *cl);
+void decode_band(int worker, int workers, void *cl);
 
-void quantizer(Pnm_ppm ppm, A2Methods_UArray2 ypbpr_array,
-                    A2Methods_UArray2 cw_array, A2Methods_T methods);
-void reverse_quantizer(Pnm_ppm ppm, A2Methods_UArray2 ypbpr_array,
-                     A2Methods_UArray2 cw_array, A2Methods_T methods);
+void quantizer(Ypbpr_planes planes, A2Methods_UArray2 cw_array);
+void reverse_quantizer(Ypbpr_planes planes, A2Methods_UArray2 cw_array);
 
+void write_compressed_header(unsigned width, unsigned height);
 void write_compressed_file(Pnm_ppm ppm, A2Methods_UArray2 word_array);
 Pnm_ppm read_compressed_header(FILE *input);
 A2Methods_UArray2 read_compressed_words(FILE *input, Pnm_ppm image);
 
 /* compress40
- * Purpose: Reads a file and compresses a ppm from within that file
+ * Purpose: Reads a file and compresses a ppm from within that file,
+ *          a band of scanlines at a time, so only a few rows of the
+ *          image are ever held in memory. The rows of blocks in each
+ *          band are split between the worker threads.
  * Parameters: A file pointer
  * Returns: nothing
  *
  * Expected input: A file containing a valid ppm
- * Success output: Prints the compressed output to stdout
- * Failure output: Will raise an exception through Pnm_ppmread if
- *                  the ppm supplied is not in the proper format
+ * Success output: Prints the compressed output to stdout. The output
+ *                  does not depend on the number of threads.
+ * Failure output: Will raise Pnm_Badformat if the ppm supplied is not
+ *                  in the proper format
  */
 void compress40(FILE *input)
 {
     assert(input != NULL);
 
+    Ppm_reader reader = ppm_reader_new(input);
+    unsigned full_width = ppm_reader_width(reader);
+    unsigned denominator = ppm_reader_denominator(reader);
+
+    /* Trim by never coding the last column or reading the last row */
+    unsigned width = full_width - full_width % 2;
+    unsigned height = ppm_reader_height(reader)
+                                      - ppm_reader_height(reader) % 2;
+    int blocks = width / 2;
+    int block_rows = height / 2;
+
+    write_compressed_header(width, height);
+    Word_writer writer = word_writer_new(stdout,
+                                         (size_t)blocks * block_rows,
+                                         word_output);
+
+    int workers = codec_threads;
+    Threadpool pool = threadpool_new(workers);
+    int capacity = BAND_ROWS_PER_WORKER * workers;
+    struct band *band = band_new(capacity, ppm_row_bytes(full_width,
+                                                         denominator),
+                                 blocks, denominator, workers, false);
+
+    for (int done = 0; done < block_rows; done += band->rows) {
+        band->rows = block_rows - done;
+        if (band->rows > capacity) {
+            band->rows = capacity;
+        }
+
+        /* The workers only read the scanlines, so the cast is safe */
+        band->pixels = (unsigned char *)ppm_read_rows(reader,
+                                                      2 * band->rows);
+
+        threadpool_run(pool, encode_band, band);
+        word_write_row(writer, band->words, band->rows * blocks);
+    }
+
+    /* Free functions */
+    word_writer_free(&writer);
+    band_free(&band, workers);
+    threadpool_free(&pool);
+    ppm_reader_free(&reader);
+}
+
+/* set_codec_threads
+ * Purpose: Sets the number of threads compress40 and decompress40 use
+ * Parameters: The number of threads
+ * Returns: nothing
+ *
+ * Expected input: A number of threads of at least 1
+ * Success output: none
+ * Failure output: Will raise an exception if threads is less than 1
+ */
+void set_codec_threads(int threads)
+{
+    assert(threads >= 1);
+    codec_threads = threads;
+}
+
+/* set_word_output
+ * Purpose: Sets how compress40 and compress40_staged write the words
+ *          of the compressed image
+ * Parameters: A Word_output
+ * Returns: nothing
+ *
+ * Expected input: WORDS_STDIO, WORDS_WRITE or WORDS_MMAP
+ * Success output: none
+ * Failure output: none
+ */
+void set_word_output(Word_output how)
+{
+    word_output = how;
+}
+
+/* set_codec_arithmetic
+ * Purpose: Sets the arithmetic compress40 and decompress40 code with
+ * Parameters: A Codec_arithmetic
+ * Returns: nothing
+ *
+ * Expected input: CODEC_FLOAT or CODEC_FIXED
+ * Success output: none
+ * Failure output: Will raise an exception if arithmetic is neither
+ */
+void set_codec_arithmetic(Codec_arithmetic arithmetic)
+{
+    assert(arithmetic == CODEC_FLOAT || arithmetic == CODEC_FIXED);
+    codec_arithmetic = arithmetic;
+}
+
+/* set_pixel_layout
+ * Purpose: Sets how compress40_staged and decompress40_staged store
+ *          the pixels of an image
+ * Parameters: A Pixel_layout
+ * Returns: nothing
+ *
+ * Expected input: PIXELS_PLAIN or PIXELS_BLOCKED
+ * Success output: none
+ * Failure output: Will raise an exception if layout is neither
+ */
+void set_pixel_layout(Pixel_layout layout)
+{
+    assert(layout == PIXELS_PLAIN || layout == PIXELS_BLOCKED);
+    pixel_layout = layout;
+}
+
+/* band_new
+ * Purpose: Allocates a band and one Blockcodec per worker
+ * Parameters: The most block rows the band will hold, the number of
+ *             bytes in a stored scanline, the number of blocks in a
+ *             block row, the denominator of the image, the number of
+ *             workers, and whether the band needs its own scanlines
+ * Returns: A pointer to a band holding no rows
+ *
+ * Expected input: A capacity and number of workers of at least 1
+ * Success output: A band with room for capacity block rows. Without
+ *                  scanlines of its own, pixels is NULL until the
+ *                  caller points it at some.
+ * Failure output: Will raise an exception if allocation fails
+ */
+struct band *band_new(int capacity, size_t stride, int blocks,
+                      unsigned denominator, int workers, bool owns_pixels)
+{
+    struct band *band = malloc(sizeof(struct band));
+    assert(band);
+
+    size_t scanlines = 2 * (size_t)capacity;
+
+    band->buffer = NULL;
+    if (owns_pixels) {
+        band->buffer = malloc(scanlines * stride);
+        assert(stride == 0 || band->buffer != NULL);
+    }
+    band->pixels = band->buffer;
+    band->words = malloc((size_t)capacity * blocks * sizeof(uint32_t));
+    band->codecs = malloc(workers * sizeof(Blockcodec));
+    assert(blocks == 0 || band->words != NULL);
+    assert(band->codecs);
+
+    for (int i = 0; i < workers; i++) {
+        band->codecs[i] = blockcodec_new(blocks, codec_arithmetic);
+    }
+
+    band->stride = stride;
+    band->blocks = blocks;
+    band->rows = 0;
+    band->denominator = denominator;
+
+    return band;
+}
+
+/* band_free
+ * Purpose: Frees a band and its Blockcodecs
+ * Parameters: A pointer to a band and the number of workers it has
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a band made by band_new with the same
+ *                  number of workers
+ * Success output: The band is freed and set to NULL
+ * Failure output: Will raise an exception if band is NULL
+ */
+void band_free(struct band **band, int workers)
+{
+    assert(band != NULL && *band != NULL);
+
+    for (int i = 0; i < workers; i++) {
+        blockcodec_free(&(*band)->codecs[i]);
+    }
+
+    free((*band)->codecs);
+    free((*band)->words);
+    free((*band)->buffer);
+    free(*band);
+    *band = NULL;
+}
+
+/* encode_band
+ * Purpose: Threadpool task that compresses one worker's share of the
+ *          block rows in a band. Each worker writes only its own
+ *          slice of the band's words, so no locking is needed.
+ * Parameters: The worker number, the number of workers, and a band
+ * Returns: nothing
+ *
+ * Expected input: A band filled with 2 * rows scanlines
+ * Success output: The worker's block rows are packed into words
+ * Failure output: none
+ */
+void encode_band(int worker, int workers, void *cl)
+{
+    struct band *band = cl;
+    int first = band->rows * worker / workers;
+    int last = band->rows * (worker + 1) / workers;
+
+    for (int row = first; row < last; row++) {
+        unsigned char *top = band->pixels + 2 * row * band->stride;
+
+        encode_block_row(band->codecs[worker], top, top + band->stride,
+                         band->denominator,
+                         band->words + (size_t)row * band->blocks,
+                         band->blocks);
+    }
+}
+
+/* compress40_staged
+ * Purpose: Reads a file and compresses a ppm from within that file,
+ *          converting the whole image one step at a time
+ * Parameters: A file pointer
+ * Returns: nothing
+ *
+ * Expected input: A file containing a valid ppm
+ * Success output: Prints the compressed output to stdout
+ * Failure output: Will raise Pnm_Badformat if the ppm supplied is not
+ *                  in the proper format
+ */
+void compress40_staged(FILE *input)
+{
+    assert(input != NULL);
+
     A2Methods_T methods = uarray2_methods_plain; 
+    A2Methods_T pixels = pixel_methods();
     assert(methods);
 
+    begin_staged_image();
+
     /* Read PPM */
-    Pnm_ppm image = Pnm_ppmread(input, methods);
+    Pnm_ppm image = read_ppm(input, pixels);
     
     /* Trim PPM */
     image = trim(image);
     
     /* Convert RGB to YPbPr */
-    A2Methods_UArray2 ypbpr_array = 
-                                convert_rgb_to_ypbpr(image, methods);
+    Ypbpr_planes planes = convert_rgb_to_ypbpr(image, pixels);
     
     /* Quantize PbPr values */
     int width = image->width;
@@ -76,7 +356,7 @@ void compress40(FILE *input)
     A2Methods_UArray2 cw_array = methods->new(width / 2, height / 2,
                                                 size_of_codeword());
 
-    quantizer(image, ypbpr_array, cw_array, methods);
+    quantizer(planes, cw_array);
 
     A2Methods_UArray2 word_array = methods->new(width / 2, height / 2,
                                                     sizeof(uint32_t));
@@ -87,55 +367,282 @@ void compress40(FILE *input)
 
     /* Free functions */
     methods->free(&word_array);
-    methods->free(&ypbpr_array);
+    ypbpr_planes_free(&planes);
     methods->free(&cw_array);
     Pnm_ppmfree(&image);
+
+    end_staged_image();
 }
 
-/* compress40
- * Purpose: Reads a file and compresses a ppm from within that file
+/* decompress40
+ * Purpose: Reads a comp40 compressed image from a file and writes the
+ *          decompressed ppm to stdout a band of rows at a time, so
+ *          only a band of words and scanlines is held in memory. The
+ *          rows of blocks in each band are split between the worker
+ *          threads and the band is written in order once all are done.
  * Parameters: A file pointer
  * Returns: nothing
  *
- * Expected input: A file containing a valid ppm
- * Success output: Prints the compressed output to stdout
- * Failure output: Will raise an exception through Pnm_ppmread if
- *                  the ppm supplied is not in the proper format
+ * Expected input: A file containing a comp40 compressed image
+ * Success output: Prints the decompressed ppm to stdout
+ * Failure output: Will raise an exception if the header is malformed
+ *                  or the file ends early
  */
 void decompress40(FILE *input)
 {
     assert(input != NULL);
 
+    Pnm_ppm image = read_compressed_header(input);
+    unsigned width = image->width;
+    unsigned height = image->height;
+    unsigned denominator = image->denominator;
+    int blocks = width / 2;
+    int block_rows = height / 2;
+
+    Word_reader reader = word_reader_new(input, (size_t)blocks * block_rows);
+    Ppm_writer writer = ppm_writer_new(stdout, width, height, denominator);
+
+    int workers = codec_threads;
+    Threadpool pool = threadpool_new(workers);
+    int capacity = BAND_ROWS_PER_WORKER * workers;
+    struct band *band = band_new(capacity, ppm_row_bytes(width, denominator),
+                                 blocks, denominator, workers, true);
+
+    for (int done = 0; done < block_rows; done += band->rows) {
+        band->rows = block_rows - done;
+        if (band->rows > capacity) {
+            band->rows = capacity;
+        }
+
+        word_read_row(reader, band->words, band->rows * blocks);
+        threadpool_run(pool, decode_band, band);
+
+        ppm_write_rows(writer, band->pixels, 2 * band->rows);
+    }
+
+    /* Free functions */
+    band_free(&band, workers);
+    threadpool_free(&pool);
+    ppm_writer_free(&writer);
+    word_reader_free(&reader);
+    free(image);
+}
+
+/* decompress40_staged
+ * Purpose: Reads a comp40 compressed image from a file and writes the
+ *          decompressed ppm to stdout, one whole-image step at a time
+ * Parameters: A file pointer
+ * Returns: nothing
+ *
+ * Expected input: A file containing a comp40 compressed image
+ * Success output: Prints the decompressed ppm to stdout
+ * Failure output: Will raise an exception if the header is malformed
+ */
+void decompress40_staged(FILE *input)
+{
+    assert(input != NULL);
+
     A2Methods_T methods = uarray2_methods_plain; 
+    A2Methods_T pixels = pixel_methods();
     assert(methods);
 
+    begin_staged_image();
+
     Pnm_ppm image = read_compressed_header(input);
-    image->methods = methods;
+    image->methods = pixels;
     A2Methods_UArray2 word_array = read_compressed_words(input, image);
 
     int width = image->width;
     int height = image->height;
 
-    A2Methods_UArray2 cw_array = methods->new(width, height,
+    A2Methods_UArray2 cw_array = methods->new(width / 2, height / 2,
                                              size_of_codeword());
     unpack_codewords(word_array, cw_array);
 
-    A2Methods_UArray2 ypbpr_array = methods->new(width, height,
-                                                 size_of_ypbpr());
+    Ypbpr_planes planes = ypbpr_planes_new(image->width, image->height);
 
-    reverse_quantizer(image, ypbpr_array, cw_array, methods);
+    reverse_quantizer(planes, cw_array);
 
-    A2Methods_UArray2 rgb_array = 
-                        convert_ypbpr_to_rgb(ypbpr_array, methods);
+    A2Methods_UArray2 rgb_array = convert_ypbpr_to_rgb(planes, pixels);
 
     image->pixels = rgb_array;
-    Pnm_ppmwrite(stdout, image);
+    write_ppm(stdout, image);
 
     /* Free functions */
     methods->free(&word_array);
-    methods->free(&ypbpr_array);
+    ypbpr_planes_free(&planes);
     methods->free(&cw_array);
     Pnm_ppmfree(&image);
+
+    end_staged_image();
+}
+
+/* begin_staged_image
+ * Purpose: Points every array made for the next image at the staged
+ *          arena, creating the arena the first time through
+ * Parameters: none
+ * Returns: nothing
+ *
+ * Expected input: No image in progress
+ * Success output: UArray2 and UArray2b storage comes from the arena
+ * Failure output: Raises a Checked Runtime Error if allocation fails
+ */
+void begin_staged_image(void)
+{
+    if (staged_arena == NULL) {
+        staged_arena = image_arena_new();
+    }
+
+    image_arena_select(staged_arena);
+}
+
+/* end_staged_image
+ * Purpose: Takes back the storage of every array made for the image,
+ *          keeping the arena's buffer for the next one
+ * Parameters: none
+ * Returns: nothing
+ *
+ * Expected input: Every array of the image has been freed
+ * Success output: The arena is reset and no longer selected
+ * Failure output: none
+ */
+void end_staged_image(void)
+{
+    image_arena_select(NULL);
+    image_arena_reset(staged_arena);
+}
+
+/* decode_band
+ * Purpose: Threadpool task that decompresses one worker's share of the
+ *          block rows in a band. Each worker writes only its own
+ *          scanlines of the band, so no locking is needed.
+ * Parameters: The worker number, the number of workers, and a band
+ * Returns: nothing
+ *
+ * Expected input: A band filled with rows * blocks words
+ * Success output: The worker's block rows are decoded into scanlines
+ * Failure output: none
+ */
+void decode_band(int worker, int workers, void *cl)
+{
+    struct band *band = cl;
+    int first = band->rows * worker / workers;
+    int last = band->rows * (worker + 1) / workers;
+
+    for (int row = first; row < last; row++) {
+        unsigned char *top = band->pixels + 2 * row * band->stride;
+
+        decode_block_row(band->codecs[worker],
+                         band->words + (size_t)row * band->blocks,
+                         band->blocks, band->denominator,
+                         top, top + band->stride);
+    }
+}
+
+/* read_ppm
+ * Purpose: Reads a ppm into a 2d array of packed pixels, one
+ *          ppm_pixel_bytes element per pixel
+ * Parameters: A file pointer and methods
+ * Returns: A ppm
+ *
+ * Expected input: A file containing a valid P3 or P6 ppm, and
+ *                  uarray2_methods_plain or uarray2_methods_blocked;
+ *                  a blocked array gets blocks of PIXEL_BLOCKSIZE
+ * Success output: A ppm whose pixels are packed samples (see
+ *                  ppmstream.h), 3 bytes each or 6 for deep images
+ * Failure output: Will raise Pnm_Badformat if the ppm supplied is not
+ *                  in the proper format
+ */
+Pnm_ppm read_ppm(FILE *input, A2Methods_T methods)
+{
+    assert(input != NULL);
+    assert(methods == uarray2_methods_plain
+           || methods == uarray2_methods_blocked);
+
+    Ppm_reader reader = ppm_reader_new(input);
+
+    Pnm_ppm ppm = malloc(sizeof(struct Pnm_ppm));
+    assert(ppm);
+
+    ppm->width = ppm_reader_width(reader);
+    ppm->height = ppm_reader_height(reader);
+    ppm->denominator = ppm_reader_denominator(reader);
+    ppm->methods = methods;
+
+    size_t pixel_bytes = ppm_pixel_bytes(ppm->denominator);
+    ppm->pixels = methods->new_with_blocksize(ppm->width, ppm->height,
+                                              pixel_bytes,
+                                              PIXEL_BLOCKSIZE);
+
+    /* The cells of a row of a plain array, and of a row of one block
+     * of a blocked array, are packed just as the scanline is, so each
+     * is a single copy */
+    for (unsigned j = 0; j < ppm->height; j++) {
+        const unsigned char *scanline = ppm_read_rows(reader, 1);
+
+        if (methods == uarray2_methods_plain) {
+            memcpy(plain_row(ppm->pixels, j), scanline,
+                   ppm->width * pixel_bytes);
+            continue;
+        }
+        int length;
+        for (unsigned i = 0; i < ppm->width; i += length) {
+            void *cells = UArray2b_span(ppm->pixels, i, j, &length);
+            memcpy(cells, scanline + i * pixel_bytes, length * pixel_bytes);
+        }
+    }
+
+    ppm_reader_free(&reader);
+    return ppm;
+}
+
+/* write_ppm
+ * Purpose: Writes a ppm of packed pixels as a raw ppm
+ * Parameters: A file pointer and a ppm
+ * Returns: nothing
+ *
+ * Expected input: A writable file and a ppm whose pixels are a plain or
+ *                  blocked array of packed samples, as made by read_ppm
+ *                  or convert_ypbpr_to_rgb
+ * Success output: The ppm is written in P6 format
+ * Failure output: Will raise an exception if a pointer is NULL
+ */
+void write_ppm(FILE *output, Pnm_ppm ppm)
+{
+    assert(output != NULL);
+    assert(ppm != NULL);
+
+    Ppm_writer writer = ppm_writer_new(output, ppm->width, ppm->height,
+                                                       ppm->denominator);
+
+    if (ppm->methods == uarray2_methods_plain) {
+        /* Each row of the plain array is already a packed scanline */
+        for (unsigned j = 0; j < ppm->height; j++) {
+            ppm_write_rows(writer, plain_row(ppm->pixels, j), 1);
+        }
+        ppm_writer_free(&writer);
+        return;
+    }
+
+    /* A scanline of a blocked array is gathered from one row of each
+     * block it crosses */
+    assert(ppm->methods == uarray2_methods_blocked);
+    size_t pixel_bytes = ppm_pixel_bytes(ppm->denominator);
+    unsigned char *scanline = malloc(ppm_row_bytes(ppm->width,
+                                                   ppm->denominator));
+    assert(scanline);
+
+    for (unsigned j = 0; j < ppm->height; j++) {
+        int length;
+        for (unsigned i = 0; i < ppm->width; i += length) {
+            void *cells = UArray2b_span(ppm->pixels, i, j, &length);
+            memcpy(scanline + i * pixel_bytes, cells, length * pixel_bytes);
+        }
+        ppm_write_rows(writer, scanline, 1);
+    }
+
+    free(scanline);
+    ppm_writer_free(&writer);
 }
 
 /* trim
@@ -143,137 +650,148 @@ void decompress40(FILE *input)
  * Parameters: A ppm
  * Returns: A ppm
  *
- * Expected input: A valid ppm
- * Success output: A ppm with even width and height values
+ * Expected input: A valid ppm whose pixels are a plain or blocked array
+ * Success output: A ppm with even width and height values. The pixels
+ *                  are narrowed in place, so no pixel is copied and an
+ *                  image that is already even is left untouched.
  * Failure output: Will raise an exception if the ppm supplied is NULL
  */
 Pnm_ppm trim(Pnm_ppm ppm)
 {
     assert(ppm != NULL);
 
-    int width = ppm->width;
-    int height = ppm->height;
+    unsigned width = ppm->width - ppm->width % 2;
+    unsigned height = ppm->height - ppm->height % 2;
 
-    if (width % 2 != 0) {
-        width--;
+    if (width != ppm->width || height != ppm->height) {
+        if (ppm->methods == uarray2_methods_blocked) {
+            UArray2b_shrink(ppm->pixels, width, height);
+        } else {
+            UArray2_shrink(ppm->pixels, width, height);
+        }
         ppm->width = width;
-    }
-
-    if (height % 2 != 0) {
-        height--;
         ppm->height = height;
-    } 
-        
-    A2Methods_T methods = uarray2_methods_plain; 
-
-    A2Methods_UArray2 trimmed_pixels = methods->new(width, height,
-                                          sizeof(struct Pnm_rgb));
-    A2Methods_UArray2 old_pixels = ppm->pixels;
-
-    for (int i = 0; i < width; i++) {
-        for (int j = 0; j < height; j++) {
-            *(Pnm_rgb)methods->at(trimmed_pixels, i, j) =
-                                   *(Pnm_rgb)methods->at(old_pixels, i, j);
-        }
     }
 
-    ppm->pixels = trimmed_pixels;
-    methods->free(&old_pixels);
-        
     return ppm;
 }
 
+/* pixel_methods
+ * Purpose: Returns the methods the staged path stores pixels with
+ * Parameters: none
+ * Returns: An A2Methods_T
+ *
+ * Expected input: none
+ * Success output: uarray2_methods_blocked when the pixel layout is
+ *                  PIXELS_BLOCKED, uarray2_methods_plain otherwise
+ * Failure output: none
+ */
+A2Methods_T pixel_methods(void)
+{
+    if (pixel_layout == PIXELS_BLOCKED) {
+        return uarray2_methods_blocked;
+    }
+    return uarray2_methods_plain;
+}
+
 /* quantizer
- * Purpose: Quantizes the Pb and Pr values and DCTs the y values in an array
- *          of YPbPr structs
- * Parameters: A ppm, a UArray2 of ypbpr structs, a UArray2 of codeword
- *             structs, and methods
+ * Purpose: Quantizes the Pb and Pr values and DCTs the y values in the
+ *          planes of an image, a row of blocks at a time
+ * Parameters: The Ypbpr_planes of an image and a UArray2 of codeword
+ *             structs
  * Returns: nothing
  *
- * Expected input: A valid ppm, a valid 2d array of ypbpr structs, a valid
- *                 2d array of codeword structs, and methods
+ * Expected input: Valid planes of even width and height and a plain 2d
+ *                 array of codeword structs with a codeword per block
  * Success output: Will correctly set the a, b, c, d, pb_index, and pr_index
  *                  values in each codeword struct in the 2d array of
  *                  codeword structs.
  * Failure output: Will raise an exception if any of the supplied pointer
  *                  parameters are null.
  */
-void quantizer(Pnm_ppm ppm, A2Methods_UArray2 ypbpr_array,
-                 A2Methods_UArray2 cw_array, A2Methods_T methods)
+void quantizer(Ypbpr_planes planes, A2Methods_UArray2 cw_array)
 {
-    assert(ppm != NULL);
-    assert(ypbpr_array != NULL);
+    assert(planes != NULL);
     assert(cw_array != NULL);
-    assert(methods != NULL);
 
-    int width = ppm->width;
-    int height = ppm->height;
+    int blocks = planes->width / 2;
+    size_t stride = planes->stride;
 
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            /* Top-left corner */
-            if (i % 2 == 0 && j % 2 == 0) {
-                UArray_T block_array = make_block_array(ypbpr_array, j, i,
-                                                                 methods);
+    /* Each row of blocks goes through one lane per coefficient and per
+     * chroma index */
+    uint32_t *lanes = malloc(6 * (size_t)blocks * sizeof(uint32_t));
+    assert(blocks == 0 || lanes != NULL);
 
-                Codeword cw = malloc(size_of_codeword());
-                assert(cw);
+    uint32_t *a = lanes;
+    int32_t *b = (int32_t *)(lanes + blocks);
+    int32_t *c = (int32_t *)(lanes + 2 * (size_t)blocks);
+    int32_t *d = (int32_t *)(lanes + 3 * (size_t)blocks);
+    uint32_t *pb_index = lanes + 4 * (size_t)blocks;
+    uint32_t *pr_index = lanes + 5 * (size_t)blocks;
 
-                pb_pr_quantize(block_array, cw);
-                dct(block_array, cw);
+    for (int row = 0; row < planes->height / 2; row++) {
+        size_t top = 2 * row * stride;
+        size_t bottom = top + stride;
+        size_t chroma = row * planes->chroma_stride;
 
-                set_cw_array(cw_array, j / 2, i / 2, cw, methods);
+        dct_block_row(planes->y + top, planes->y + bottom, blocks,
+                                                        a, b, c, d);
+        quantize_chroma(planes->pb + chroma, blocks, pb_index);
+        quantize_chroma(planes->pr + chroma, blocks, pr_index);
 
-                free(cw);
-                UArray_free(&block_array);
-            }
-        }
+        store_codeword_row(cw_array, row, a, b, c, d, pb_index, pr_index);
     }
+
+    free(lanes);
 }
 
 /* reverse_quantizer
  * Purpose: Reverse quantizes the pb and pr indicies and reverse DCTs the
- *          a, b, c, and d values in an array of codeword structs
- * Parameters: A ppm, a UArray2 of ypbpr structs, a UArray2 of codeword
- *             structs, and methods
+ *          a, b, c, and d values in an array of codeword structs, a row
+ *          of blocks at a time
+ * Parameters: The Ypbpr_planes to fill in and a UArray2 of codeword
+ *             structs
  * Returns: nothing
  *
- * Expected input: A valid ppm, a valid 2d array of ypbpr structs, a valid
- *                 2d array of codeword structs, and methods
- * Success output: Will correctly set the y, pb, and pr values in each ypbpr
- *                   struct in the 2d array of ypbpr structs
+ * Expected input: Valid planes of even width and height and a plain 2d
+ *                 array of codeword structs with a codeword per block
+ * Success output: Will correctly set the y, pb, and pr values of every
+ *                   pixel in the planes
  * Failure output: Will raise an exception if any of the supplied pointer
  *                  parameters are null.
  */
-void reverse_quantizer(Pnm_ppm ppm, A2Methods_UArray2 ypbpr_array,
-                         A2Methods_UArray2 cw_array, A2Methods_T methods)
+void reverse_quantizer(Ypbpr_planes planes, A2Methods_UArray2 cw_array)
 {
-    assert(ppm != NULL);
-    assert(ypbpr_array != NULL);
+    assert(planes != NULL);
     assert(cw_array != NULL);
-    assert(methods != NULL);
 
-    int width = ppm->width;
-    int height = ppm->height;
+    int blocks = planes->width / 2;
+    size_t stride = planes->stride;
 
-    for (int i = 0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            /* Top-left corner */
-            if (i % 2 == 0 && j % 2 == 0) {
-                UArray_T block_array = make_block_array(ypbpr_array, j, i,
-                                                                 methods);
+    uint32_t *lanes = malloc(6 * (size_t)blocks * sizeof(uint32_t));
+    assert(blocks == 0 || lanes != NULL);
 
-                Codeword cw = (Codeword)methods->at(cw_array, j / 2, i / 2);
+    uint32_t *a = lanes;
+    int32_t *b = (int32_t *)(lanes + blocks);
+    int32_t *c = (int32_t *)(lanes + 2 * (size_t)blocks);
+    int32_t *d = (int32_t *)(lanes + 3 * (size_t)blocks);
+    uint32_t *pb_index = lanes + 4 * (size_t)blocks;
+    uint32_t *pr_index = lanes + 5 * (size_t)blocks;
 
-                pb_pr_reverse_quantize(cw, block_array);
-                reverse_dct(cw, block_array);
+    for (int row = 0; row < planes->height / 2; row++) {
+        size_t top = 2 * row * stride;
+        size_t bottom = top + stride;
+        size_t chroma = row * planes->chroma_stride;
 
-                set_ypbpr_block(ypbpr_array, j, i, methods, block_array);
+        load_codeword_row(cw_array, row, a, b, c, d, pb_index, pr_index);
 
-                UArray_free(&block_array);
-            }
-        }
+        reverse_dct_block_row(a, b, c, d, blocks, planes->y + top,
+                                                  planes->y + bottom);
+        reverse_quantize_chroma(pb_index, blocks, planes->pb + chroma);
+        reverse_quantize_chroma(pr_index, blocks, planes->pr + chroma);
     }
+
+    free(lanes);
 }
 
 /* write_compressed_file
@@ -292,11 +810,27 @@ void write_compressed_file(Pnm_ppm ppm, A2Methods_UArray2 word_array)
     assert(ppm != NULL);
     assert(word_array != NULL);
 
-    unsigned width = ppm->width;
-    unsigned height = ppm->height;
+    write_compressed_header(ppm->width, ppm->height);
+
+    Word_writer writer = word_writer_new(stdout, (size_t)(ppm->width / 2)
+                                         * (ppm->height / 2), word_output);
+    print_codewords(word_array, writer);
+    word_writer_free(&writer);
+}
+
+/* write_compressed_header
+ * Purpose: Writes the header of a comp40 compressed image to stdout
+ * Parameters: The width and height of the trimmed image
+ * Returns: nothing
+ *
+ * Expected input: An even width and height
+ * Success output: Will print the header in comp40 compressed image
+ *                  format
+ * Failure output: none
+ */
+void write_compressed_header(unsigned width, unsigned height)
+{
     printf("COMP40 Compressed image format 2\n%u %u\n", width, height);
-    
-    print_codewords(word_array);
 }
 
 /* read_compressed_header
@@ -346,7 +880,8 @@ Pnm_ppm read_compressed_header(FILE *input)
  * Success output: A UArray2 of words identical to the ones read from the
  *                  file
  * Failure output: Will raise an exception if any of the supplied pointer
- *                  parameters are null.
+ *                  parameters are null, or if the file ends before the
+ *                  last word
  */
 A2Methods_UArray2 read_compressed_words(FILE *input, Pnm_ppm image)
 {
@@ -361,18 +896,10 @@ A2Methods_UArray2 read_compressed_words(FILE *input, Pnm_ppm image)
     A2Methods_UArray2 word_array = methods->new(width / 2, height / 2,
                                                     sizeof(uint32_t));
 
-    for (int i = 0; i < height / 2; i ++) {
-        for (int j = 0; j < width / 2; j++) {
-            uint32_t curr_word = 0;
-            
-            for (int k = 24; k >= 0; k -= 8) {
-                uint32_t c = fgetc(input);
-                curr_word = Bitpack_newu(curr_word, 8, k, c);
-            }
-
-            *(int32_t *)methods->at(word_array, j, i) = curr_word;
-        }
-    }
+    Word_reader reader = word_reader_new(input, (size_t)(width / 2)
+                                                * (height / 2));
+    read_codewords(word_array, reader);
+    word_reader_free(&reader);
 
     return word_array;
 }
@@ -11,81 +11,399 @@
  *     
  **************************************************************/
 #include "dctrans.h"
+#include "simd.h"
+
+/* Blocks split into lanes at a time by the row functions */
+#define LANE_CHUNK 64
 
 int32_t map_bcd(float value);
 float unmap_bcd(int32_t value);
+void dct_blocks_scalar(const float *y1, const float *y2, const float *y3,
+                       const float *y4, int count, uint32_t *a,
+                       int32_t *b, int32_t *c, int32_t *d);
+void reverse_dct_blocks_scalar(const uint32_t *a, const int32_t *b,
+                               const int32_t *c, const int32_t *d,
+                               int count, float *y1, float *y2, float *y3,
+                               float *y4);
+#ifdef HAVE_AVX2_KERNELS
+void dct_blocks_avx2(const float *y1, const float *y2, const float *y3,
+                     const float *y4, int count, uint32_t *a, int32_t *b,
+                     int32_t *c, int32_t *d);
+void reverse_dct_blocks_avx2(const uint32_t *a, const int32_t *b,
+                             const int32_t *c, const int32_t *d, int count,
+                             float *y1, float *y2, float *y3, float *y4);
+#endif
 
-/* dct
- * Purpose: Does the math to DCT the y values in a block of 4
- *          YPbPr structs and set them in as a, b, c, and d in a
- *          codeword struct.
- * Parameters: A UArray of YPbPr structs and a codeword struct
+/* dct_block_row
+ * Purpose: DCTs a row of 2-by-2 blocks straight out of a pair of rows
+ *          of a luma plane (see colorspace.h). Block i is made of
+ *          pixels 2i and 2i + 1 of top and bottom; they are split into
+ *          lanes a chunk of blocks at a time and handed to dct_blocks.
+ * Parameters: The top and bottom rows of a luma plane, the number of
+ *             blocks, and four arrays for the a, b, c and d coefficients
  * Returns: nothing
  *
- * Expected input: An array of 4 full ypbpr structs and an empty codeword
- *                  struct.
- * Success output: Will correctly initialize a, b, c, and d in the codeword
- *                  struct.
- * Failure output: Will raise an exception if any of the supplied pointer
- *                  parameters are null.
+ * Expected input: Rows of at least 2 * blocks luma values in [0, 1] and
+ *                  arrays holding at least blocks elements
+ * Success output: a, b, c and d hold the coefficients of each block,
+ *                  as dct_blocks leaves them
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void dct(UArray_T block_array, Codeword cw)
+void dct_block_row(const float *top, const float *bottom, int blocks,
+                   uint32_t *a, int32_t *b, int32_t *c, int32_t *d)
 {
-    assert(block_array != NULL);
-    assert(cw != NULL);
-    assert(UArray_length(block_array) == 4);
-    
-    float y1 = get_y_value(UArray_at(block_array, 0));
-    float y2 = get_y_value(UArray_at(block_array, 1));
-    float y3 = get_y_value(UArray_at(block_array, 2));
-    float y4 = get_y_value(UArray_at(block_array, 3));
-    
-    uint32_t a = 63 * (y4 + y3 + y2 + y1) / 4.0;
-    int32_t b = map_bcd((y4 + y3 - y2 - y1) / 4.0);
-    int32_t c = map_bcd((y4 - y3 + y2 - y1) / 4.0);
-    int32_t d = map_bcd((y4 - y3 - y2 + y1) / 4.0);
-
-    set_a_value(cw, a);
-    set_b_value(cw, b);
-    set_c_value(cw, c);
-    set_d_value(cw, d);
+    assert(blocks == 0 || (top != NULL && bottom != NULL && a != NULL
+                           && b != NULL && c != NULL && d != NULL));
+
+    float lanes[4][LANE_CHUNK];
+
+    for (int done = 0; done < blocks; done += LANE_CHUNK) {
+        int count = blocks - done;
+        if (count > LANE_CHUNK) {
+            count = LANE_CHUNK;
+        }
+
+        for (int i = 0; i < count; i++) {
+            int at = 2 * (done + i);
+            lanes[0][i] = top[at];
+            lanes[1][i] = top[at + 1];
+            lanes[2][i] = bottom[at];
+            lanes[3][i] = bottom[at + 1];
+        }
+
+        dct_blocks(lanes[0], lanes[1], lanes[2], lanes[3], count,
+                   a + done, b + done, c + done, d + done);
+    }
 }
 
-/* reverse_dct
- * Purpose: Does the math to reverse DCT the a, b, c, and d values in a
- *          codeword struct and sets the corrosponding y values in
- *          4 ypbpr structs in a UArray
- * Parameters: A UArray of YPbPr structs and a codeword struct
+/* reverse_dct_block_row
+ * Purpose: Reverse DCTs a row of 2-by-2 blocks straight into a pair of
+ *          rows of a luma plane; the inverse of dct_block_row
+ * Parameters: Four arrays of a, b, c and d coefficients, the number of
+ *             blocks, and the top and bottom rows of a luma plane
  * Returns: nothing
  *
- * Expected input: An array of 4 empty ypbpr structs and a full codeword
- *                  struct.
- * Success output: Will correctly initialize the y values in the ypbpr
- *                  struct.
- * Failure output: Will raise an exception if any of the supplied pointer
- *                  parameters are null.
+ * Expected input: Arrays holding at least blocks elements and rows of
+ *                  at least 2 * blocks values
+ * Success output: Pixels 2i and 2i + 1 of top and bottom hold the luma
+ *                  values of block i
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void reverse_dct(Codeword cw, UArray_T block_array)
+void reverse_dct_block_row(const uint32_t *a, const int32_t *b,
+                           const int32_t *c, const int32_t *d, int blocks,
+                           float *top, float *bottom)
 {
-    assert(block_array != NULL);
-    assert(cw != NULL);
-    assert(UArray_length(block_array) == 4);
-
-    float a = get_a_value(cw) / 63.0;
-    float b = unmap_bcd(get_b_value(cw));
-    float c = unmap_bcd(get_c_value(cw));
-    float d = unmap_bcd(get_d_value(cw));
-
-    float y1 = a - b - c + d;
-    float y2 = a - b + c - d;
-    float y3 = a + b - c - d;
-    float y4 = a + b + c + d;
-
-    set_y_value(UArray_at(block_array, 0), y1);
-    set_y_value(UArray_at(block_array, 1), y2);
-    set_y_value(UArray_at(block_array, 2), y3);
-    set_y_value(UArray_at(block_array, 3), y4);
+    assert(blocks == 0 || (top != NULL && bottom != NULL && a != NULL
+                           && b != NULL && c != NULL && d != NULL));
+
+    float lanes[4][LANE_CHUNK];
+
+    for (int done = 0; done < blocks; done += LANE_CHUNK) {
+        int count = blocks - done;
+        if (count > LANE_CHUNK) {
+            count = LANE_CHUNK;
+        }
+
+        reverse_dct_blocks(a + done, b + done, c + done, d + done, count,
+                           lanes[0], lanes[1], lanes[2], lanes[3]);
+
+        for (int i = 0; i < count; i++) {
+            int at = 2 * (done + i);
+            top[at] = lanes[0][i];
+            top[at + 1] = lanes[1][i];
+            bottom[at] = lanes[2][i];
+            bottom[at + 1] = lanes[3][i];
+        }
+    }
+}
+
+/* dct_blocks
+ * Purpose: DCTs many blocks at once. The luma values of block i are
+ *          y1[i] through y4[i] (top-left, top-right, bottom-left,
+ *          bottom-right) and its coefficients go to a[i] through d[i].
+ *          Uses an AVX2 kernel that transforms 8 blocks at a time when
+ *          the CPU supports it and the scalar formulas otherwise; both
+ *          give the same results.
+ * Parameters: Four arrays of luma values, the number of blocks, and
+ *             four arrays for the a, b, c and d coefficients
+ * Returns: nothing
+ *
+ * Expected input: Arrays holding at least count elements, with luma
+ *                  values in [0, 1]
+ * Success output: a, b, c and d hold the coefficients, with b, c and d
+ *                  already mapped by map_bcd
+ * Failure output: Will raise an exception if a pointer is NULL
+ */
+void dct_blocks(const float *y1, const float *y2, const float *y3,
+                const float *y4, int count, uint32_t *a, int32_t *b,
+                int32_t *c, int32_t *d)
+{
+    assert(count == 0 || (y1 != NULL && y2 != NULL && y3 != NULL
+                          && y4 != NULL && a != NULL && b != NULL
+                          && c != NULL && d != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        dct_blocks_avx2(y1, y2, y3, y4, count, a, b, c, d);
+        return;
+    }
+#endif
+
+    dct_blocks_scalar(y1, y2, y3, y4, count, a, b, c, d);
+}
+
+/* reverse_dct_blocks
+ * Purpose: Reverse DCTs many blocks at once; the inverse of dct_blocks
+ * Parameters: Four arrays of a, b, c and d coefficients, the number of
+ *             blocks, and four arrays for the luma values
+ * Returns: nothing
+ *
+ * Expected input: Arrays holding at least count elements
+ * Success output: y1 through y4 hold the luma values of each block
+ * Failure output: Will raise an exception if a pointer is NULL
+ */
+void reverse_dct_blocks(const uint32_t *a, const int32_t *b,
+                        const int32_t *c, const int32_t *d, int count,
+                        float *y1, float *y2, float *y3, float *y4)
+{
+    assert(count == 0 || (y1 != NULL && y2 != NULL && y3 != NULL
+                          && y4 != NULL && a != NULL && b != NULL
+                          && c != NULL && d != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        reverse_dct_blocks_avx2(a, b, c, d, count, y1, y2, y3, y4);
+        return;
+    }
+#endif
+
+    reverse_dct_blocks_scalar(a, b, c, d, count, y1, y2, y3, y4);
+}
+
+/* dct_blocks_scalar
+ * Purpose: Reference version of dct_blocks that transforms one block
+ *          at a time. These are the formulas every DCT kernel must
+ *          match.
+ * Parameters: Same as dct_blocks
+ * Returns: nothing
+ *
+ * Expected input: Same as dct_blocks
+ * Success output: Same as dct_blocks
+ * Failure output: none
+ */
+void dct_blocks_scalar(const float *y1, const float *y2, const float *y3,
+                       const float *y4, int count, uint32_t *a,
+                       int32_t *b, int32_t *c, int32_t *d)
+{
+    for (int i = 0; i < count; i++) {
+        a[i] = 63 * (y4[i] + y3[i] + y2[i] + y1[i]) / 4.0;
+        b[i] = map_bcd((y4[i] + y3[i] - y2[i] - y1[i]) / 4.0);
+        c[i] = map_bcd((y4[i] - y3[i] + y2[i] - y1[i]) / 4.0);
+        d[i] = map_bcd((y4[i] - y3[i] - y2[i] + y1[i]) / 4.0);
+    }
+}
+
+/* reverse_dct_blocks_scalar
+ * Purpose: Reference version of reverse_dct_blocks that transforms one
+ *          block at a time
+ * Parameters: Same as reverse_dct_blocks
+ * Returns: nothing
+ *
+ * Expected input: Same as reverse_dct_blocks
+ * Success output: Same as reverse_dct_blocks
+ * Failure output: none
+ */
+void reverse_dct_blocks_scalar(const uint32_t *a, const int32_t *b,
+                               const int32_t *c, const int32_t *d,
+                               int count, float *y1, float *y2, float *y3,
+                               float *y4)
+{
+    for (int i = 0; i < count; i++) {
+        float a_value = a[i] / 63.0;
+        float b_value = unmap_bcd(b[i]);
+        float c_value = unmap_bcd(c[i]);
+        float d_value = unmap_bcd(d[i]);
+
+        y1[i] = a_value - b_value - c_value + d_value;
+        y2[i] = a_value - b_value + c_value - d_value;
+        y3[i] = a_value + b_value - c_value - d_value;
+        y4[i] = a_value + b_value + c_value + d_value;
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* map_bcd_avx2
+ * Purpose: map_bcd on 4 lanes. value holds the float argument already
+ *          widened to double, as the scalar comparisons see it.
+ * Parameters: Four values as doubles
+ * Returns: The four mapped integers
+ *
+ * Expected input: Values that are exactly representable as floats
+ * Success output: The same integers map_bcd returns
+ * Failure output: none
+ */
+AVX2_KERNEL
+static inline __m128i map_bcd_avx2(__m256d value)
+{
+    const double slope = (30.0 + 30.0) / (0.3 + 0.3);
+    __m256d mapped = _mm256_add_pd(_mm256_set1_pd(-30),
+                        _mm256_mul_pd(_mm256_set1_pd(slope),
+                            _mm256_add_pd(value, _mm256_set1_pd(0.3))));
+
+    __m256d high = _mm256_cmp_pd(value, _mm256_set1_pd(0.3), _CMP_GT_OQ);
+    __m256d low = _mm256_cmp_pd(value, _mm256_set1_pd(-0.3), _CMP_LT_OQ);
+    mapped = _mm256_blendv_pd(mapped, _mm256_set1_pd(30), high);
+    mapped = _mm256_blendv_pd(mapped, _mm256_set1_pd(-30), low);
+
+    return _mm256_cvttpd_epi32(mapped);
+}
+
+/* quarter_as_float_avx2
+ * Purpose: Divides 4 float lanes by 4.0 in double and rounds back to
+ *          float, as passing (x / 4.0) to a float parameter does, then
+ *          widens the result again for map_bcd_avx2
+ * Parameters: Four float values
+ * Returns: The four quotients as doubles
+ *
+ * Expected input: Any floats
+ * Success output: The rounded quotients
+ * Failure output: none
+ */
+AVX2_KERNEL
+static inline __m256d quarter_as_float_avx2(__m128 value)
+{
+    __m256d quarter = _mm256_div_pd(_mm256_cvtps_pd(value),
+                                    _mm256_set1_pd(4.0));
+    return _mm256_cvtps_pd(_mm256_cvtpd_ps(quarter));
+}
+
+/* dct_blocks_avx2
+ * Purpose: AVX2 version of dct_blocks. The butterflies run in single
+ *          precision on 8 blocks, in the same order as the scalar
+ *          sums, and the scaling and map_bcd run in double on 4 blocks
+ *          at a time, so every coefficient matches the scalar kernel.
+ * Parameters: Same as dct_blocks
+ * Returns: nothing
+ *
+ * Expected input: Same as dct_blocks, on a CPU with AVX2
+ * Success output: Same as dct_blocks
+ * Failure output: none
+ */
+AVX2_KERNEL
+void dct_blocks_avx2(const float *y1, const float *y2, const float *y3,
+                     const float *y4, int count, uint32_t *a, int32_t *b,
+                     int32_t *c, int32_t *d)
+{
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 v1 = _mm256_loadu_ps(&y1[i]);
+        __m256 v2 = _mm256_loadu_ps(&y2[i]);
+        __m256 v3 = _mm256_loadu_ps(&y3[i]);
+        __m256 v4 = _mm256_loadu_ps(&y4[i]);
+
+        __m256 sum_a = _mm256_mul_ps(_mm256_set1_ps(63),
+            _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(v4, v3), v2), v1));
+        __m256 sum_b = _mm256_sub_ps(_mm256_sub_ps(_mm256_add_ps(v4, v3),
+                                                             v2), v1);
+        __m256 sum_c = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(v4, v3),
+                                                             v2), v1);
+        __m256 sum_d = _mm256_add_ps(_mm256_sub_ps(_mm256_sub_ps(v4, v3),
+                                                             v2), v1);
+
+        for (int half = 0; half < 2; half++) {
+            int at = i + 4 * half;
+            __m128 part_a = half ? _mm256_extractf128_ps(sum_a, 1)
+                                 : _mm256_castps256_ps128(sum_a);
+            __m128 part_b = half ? _mm256_extractf128_ps(sum_b, 1)
+                                 : _mm256_castps256_ps128(sum_b);
+            __m128 part_c = half ? _mm256_extractf128_ps(sum_c, 1)
+                                 : _mm256_castps256_ps128(sum_c);
+            __m128 part_d = half ? _mm256_extractf128_ps(sum_d, 1)
+                                 : _mm256_castps256_ps128(sum_d);
+
+            __m256d scaled_a = _mm256_div_pd(_mm256_cvtps_pd(part_a),
+                                             _mm256_set1_pd(4.0));
+            _mm_storeu_si128((__m128i *)&a[at],
+                             _mm256_cvttpd_epi32(scaled_a));
+            _mm_storeu_si128((__m128i *)&b[at],
+                             map_bcd_avx2(quarter_as_float_avx2(part_b)));
+            _mm_storeu_si128((__m128i *)&c[at],
+                             map_bcd_avx2(quarter_as_float_avx2(part_c)));
+            _mm_storeu_si128((__m128i *)&d[at],
+                             map_bcd_avx2(quarter_as_float_avx2(part_d)));
+        }
+    }
+
+    dct_blocks_scalar(y1 + i, y2 + i, y3 + i, y4 + i, count - i, a + i,
+                                                   b + i, c + i, d + i);
+}
+
+/* reverse_dct_blocks_avx2
+ * Purpose: AVX2 version of reverse_dct_blocks. Unscales a, b, c and d
+ *          in double on 4 blocks at a time, rounding to float as the
+ *          scalar kernel does, then runs the butterflies in single
+ *          precision on 8 blocks.
+ * Parameters: Same as reverse_dct_blocks
+ * Returns: nothing
+ *
+ * Expected input: Same as reverse_dct_blocks, on a CPU with AVX2
+ * Success output: Same as reverse_dct_blocks
+ * Failure output: none
+ */
+AVX2_KERNEL
+void reverse_dct_blocks_avx2(const uint32_t *a, const int32_t *b,
+                             const int32_t *c, const int32_t *d, int count,
+                             float *y1, float *y2, float *y3, float *y4)
+{
+    const double slope = (0.3 + 0.3) / (30.0 + 30.0);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128 parts[4][2];
+
+        for (int half = 0; half < 2; half++) {
+            int at = i + 4 * half;
+            const int32_t *lanes[3] = { &b[at], &c[at], &d[at] };
+
+            /* a is at most 63, so it converts exactly as signed */
+            __m256d a4 = _mm256_cvtepi32_pd(
+                            _mm_loadu_si128((const __m128i *)&a[at]));
+            parts[0][half] = _mm256_cvtpd_ps(
+                            _mm256_div_pd(a4, _mm256_set1_pd(63.0)));
+
+            for (int k = 0; k < 3; k++) {
+                __m256d v = _mm256_cvtepi32_pd(
+                            _mm_loadu_si128((const __m128i *)lanes[k]));
+                __m256d unmapped = _mm256_add_pd(_mm256_set1_pd(-0.3),
+                        _mm256_mul_pd(_mm256_set1_pd(slope),
+                            _mm256_add_pd(v, _mm256_set1_pd(30.0))));
+                parts[k + 1][half] = _mm256_cvtpd_ps(unmapped);
+            }
+        }
+
+        __m256 va = _mm256_set_m128(parts[0][1], parts[0][0]);
+        __m256 vb = _mm256_set_m128(parts[1][1], parts[1][0]);
+        __m256 vc = _mm256_set_m128(parts[2][1], parts[2][0]);
+        __m256 vd = _mm256_set_m128(parts[3][1], parts[3][0]);
+
+        __m256 a_minus_b = _mm256_sub_ps(va, vb);
+        __m256 a_plus_b = _mm256_add_ps(va, vb);
+
+        _mm256_storeu_ps(&y1[i], _mm256_add_ps(
+                        _mm256_sub_ps(a_minus_b, vc), vd));
+        _mm256_storeu_ps(&y2[i], _mm256_sub_ps(
+                        _mm256_add_ps(a_minus_b, vc), vd));
+        _mm256_storeu_ps(&y3[i], _mm256_sub_ps(
+                        _mm256_sub_ps(a_plus_b, vc), vd));
+        _mm256_storeu_ps(&y4[i], _mm256_add_ps(
+                        _mm256_add_ps(a_plus_b, vc), vd));
+    }
+
+    reverse_dct_blocks_scalar(a + i, b + i, c + i, d + i, count - i,
+                              y1 + i, y2 + i, y3 + i, y4 + i);
 }
+#endif
 
 /* map_bcd
  * Purpose: Helper function that maps a float value onto the
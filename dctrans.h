@@ -7,12 +7,15 @@
  *     Date:     Oct 28, 2021
  *
  *     Summary
- *     This class contains two functions – dct and reverse_dct. The dct
- *     function performs a Discrete Cosine Transform to convert the luma
- *     values of a given 2-by-2 block of pixels into a, b, c, and d
- *     components, while the reverse_dct function performs the reverse
+ *     This class contains two functions – dct_block_row and
+ *     reverse_dct_block_row. The dct_block_row function performs a
+ *     Discrete Cosine Transform to convert the luma values of each
+ *     2-by-2 block of pixels in a pair of luma rows into a, b, c, and
+ *     d components, while reverse_dct_block_row performs the reverse
  *     operation, converting a, b, c, and d components into four luma
- *     values corresponding to the luma values of pixels in a 2-by-2 block
+ *     values corresponding to the luma values of pixels in a 2-by-2
+ *     block. Both are built on the lane kernels dct_blocks and
+ *     reverse_dct_blocks.
  *     
  **************************************************************/
 #ifndef DCTRANS_INCLUDED
@@ -21,43 +24,75 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <assert.h>
-#include <a2methods.h>
-#include <a2plain.h>
-#include <uarray.h>
 
-#include "codeword.h"
-#include "colorspace.h"
+/* dct_block_row
+ * Purpose: DCTs a row of 2-by-2 blocks straight out of a pair of rows
+ *          of a luma plane (see colorspace.h). Block i is made of
+ *          pixels 2i and 2i + 1 of top and bottom; they are split into
+ *          lanes a chunk of blocks at a time and handed to dct_blocks.
+ * Parameters: The top and bottom rows of a luma plane, the number of
+ *             blocks, and four arrays for the a, b, c and d coefficients
+ * Returns: nothing
+ *
+ * Expected input: Rows of at least 2 * blocks luma values in [0, 1] and
+ *                  arrays holding at least blocks elements
+ * Success output: a, b, c and d hold the coefficients of each block,
+ *                  as dct_blocks leaves them
+ * Failure output: Will raise an exception if a pointer is NULL
+ */
+void dct_block_row(const float *top, const float *bottom, int blocks,
+                   uint32_t *a, int32_t *b, int32_t *c, int32_t *d);
+
+/* reverse_dct_block_row
+ * Purpose: Reverse DCTs a row of 2-by-2 blocks straight into a pair of
+ *          rows of a luma plane; the inverse of dct_block_row
+ * Parameters: Four arrays of a, b, c and d coefficients, the number of
+ *             blocks, and the top and bottom rows of a luma plane
+ * Returns: nothing
+ *
+ * Expected input: Arrays holding at least blocks elements and rows of
+ *                  at least 2 * blocks values
+ * Success output: Pixels 2i and 2i + 1 of top and bottom hold the luma
+ *                  values of block i
+ * Failure output: Will raise an exception if a pointer is NULL
+ */
+void reverse_dct_block_row(const uint32_t *a, const int32_t *b,
+                           const int32_t *c, const int32_t *d, int blocks,
+                           float *top, float *bottom);
 
-/* dct
- * Purpose: Does the math to DCT the y values in a block of 4
- *          YPbPr structs and set them in as a, b, c, and d in a
- *          codeword struct.
- * Parameters: A UArray of YPbPr structs and a codeword struct
+/* dct_blocks
+ * Purpose: DCTs many blocks at once. The luma values of block i are
+ *          y1[i] through y4[i] (top-left, top-right, bottom-left,
+ *          bottom-right) and its coefficients go to a[i] through d[i].
+ *          Uses an AVX2 kernel that transforms 8 blocks at a time when
+ *          the CPU supports it and the scalar formulas otherwise; both
+ *          give the same results.
+ * Parameters: Four arrays of luma values, the number of blocks, and
+ *             four arrays for the a, b, c and d coefficients
  * Returns: nothing
  *
- * Expected input: An array of 4 full ypbpr structs and an empty codeword
- *                  struct.
- * Success output: Will correctly initialize a, b, c, and d in the codeword
- *                  struct.
- * Failure output: Will raise an exception if any of the supplied pointer
- *                  parameters are null.
+ * Expected input: Arrays holding at least count elements, with luma
+ *                  values in [0, 1]
+ * Success output: a, b, c and d hold the coefficients, with b, c and d
+ *                  already mapped by map_bcd
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void dct(UArray_T block_array, Codeword cw);
+void dct_blocks(const float *y1, const float *y2, const float *y3,
+                const float *y4, int count, uint32_t *a, int32_t *b,
+                int32_t *c, int32_t *d);
 
-/* reverse_dct
- * Purpose: Does the math to reverse DCT the a, b, c, and d values in a
- *          codeword struct and sets the corrosponding y values in
- *          4 ypbpr structs in a UArray
- * Parameters: A UArray of YPbPr structs and a codeword struct
+/* reverse_dct_blocks
+ * Purpose: Reverse DCTs many blocks at once; the inverse of dct_blocks
+ * Parameters: Four arrays of a, b, c and d coefficients, the number of
+ *             blocks, and four arrays for the luma values
  * Returns: nothing
  *
- * Expected input: An array of 4 empty ypbpr structs and a full codeword
- *                  struct.
- * Success output: Will correctly initialize the y values in the ypbpr
- *                  struct.
- * Failure output: Will raise an exception if any of the supplied pointer
- *                  parameters are null.
+ * Expected input: Arrays holding at least count elements
+ * Success output: y1 through y4 hold the luma values of each block
+ * Failure output: Will raise an exception if a pointer is NULL
  */
-void reverse_dct(Codeword cw, UArray_T block_array);
+void reverse_dct_blocks(const uint32_t *a, const int32_t *b,
+                        const int32_t *c, const int32_t *d, int count,
+                        float *y1, float *y2, float *y3, float *y4);
 
-#endif
\ No newline at end of file
+#endif
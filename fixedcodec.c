@@ -0,0 +1,791 @@
+/**************************************************************
+ *
+ *                     fixedcodec.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Implementation of the fixedcodec class. The row functions
+ *     split a chunk of blocks into 16-bit lanes, one per pixel
+ *     position and channel, and hand them to a lane kernel. The
+ *     scalar kernels spell out each rounding step with the helpers
+ *     below; the AVX2 kernels use the instructions those helpers
+ *     describe, so the two agree bit for bit.
+ *
+ **************************************************************/
+#include <stdbool.h>
+
+#include "fixedcodec.h"
+#include "fixedlanes.h"
+#include "ppmstream.h"
+
+/* 1.0 in Q14, the format of rgb and luma */
+#define Q14_ONE 16384
+
+/* Color conversion constants in Q15. The luma ones sum to 1.0 and the
+ * chroma ones to 0; the chroma ones are halved so Pb and Pr come out
+ * in Q13. */
+#define Y_RED      9798         /*  0.299    */
+#define Y_GREEN   19235         /*  0.587    */
+#define Y_BLUE     3735         /*  0.114    */
+#define PB_RED    -2765         /* -0.168736 */
+#define PB_GREEN  -5427         /* -0.331264 */
+#define PB_BLUE    8192         /*  0.5      */
+#define PR_RED     8192         /*  0.5      */
+#define PR_GREEN  -6860         /* -0.418688 */
+#define PR_BLUE   -1332         /* -0.081312 */
+
+/* Inverse conversion constants in Q15, applied to Q13 chroma that has
+ * been shifted left by 2, giving Q14 terms */
+#define RED_PR    22970         /*  1.402    */
+#define GREEN_PB   5638         /* -0.344136 */
+#define GREEN_PR  11700         /* -0.714136 */
+#define BLUE_PB   29032         /*  1.772    */
+
+/* a is the mean luma times 63, found as the high half of mean * 252.
+ * Going back, a << 9 times A_UNSCALE in Q15 is a / 63 in Q14. */
+#define A_SCALE    252
+#define A_UNSCALE  16644
+
+/* b, c and d are a difference of luma pair averages times 100 (that
+ * is, the float codec's value * 100, truncated), at most 30 either
+ * way. Going back, (b << 8) times BCD_UNSCALE in Q15 is b / 100 in
+ * Q14. */
+#define BCD_STEPS    100
+#define BCD_LIMIT    30
+#define BCD_UNSCALE  20972
+
+/* The chroma table of quantize.c in Q13 */
+static const int16_t chroma_of_index[16] = {
+    -2867, -1638, -1229, -819, -631, -451, -270, -90,
+       90,   270,   451,  631,  819, 1229, 1638, 2867
+};
+
+/* chroma_sum_threshold[n] is the largest sum of a block's four Q13
+ * chroma values that still quantizes to index n or lower: the midpoint
+ * of chroma_of_index[n] and chroma_of_index[n + 1] in quantize.c's
+ * float table, times 32768, rounded down, so ties go to the lower
+ * index as they do there */
+static const int16_t chroma_sum_threshold[15] = {
+    -9012, -5735, -4096, -2900, -2163, -1442, -721, 0,
+      720,  1441,  2162,  2899,  4096,  5734, 9011
+};
+
+void load_sample_lanes(const unsigned char *top,
+                       const unsigned char *bottom, int first, int count,
+                       bool deep, Sample_lanes lanes);
+void store_sample_lanes(Sample_lanes lanes, int first, int count,
+                        bool deep, unsigned char *top,
+                        unsigned char *bottom);
+void fixed_encode_lanes(Sample_lanes lanes, int count,
+                        struct sample_scale scale, uint32_t *a,
+                        int32_t *b, int32_t *c, int32_t *d, uint32_t *pb,
+                        uint32_t *pr);
+void fixed_decode_lanes(const uint32_t *a, const int32_t *b,
+                        const int32_t *c, const int32_t *d,
+                        const uint32_t *pb, const uint32_t *pr, int count,
+                        unsigned denominator, Sample_lanes lanes);
+
+/* mul_q15
+ * Purpose: Multiplies a 16-bit value by a Q15 constant, rounding the
+ *          product to nearest with halves going up, as pmulhrsw does
+ * Parameters: A value and a Q15 constant
+ * Returns: The rounded product, in the format of the value
+ *
+ * Expected input: Not both -32768
+ * Success output: (value * constant + 2^14) >> 15
+ * Failure output: none
+ */
+static inline int16_t mul_q15(int16_t value, int16_t constant)
+{
+    return ((int32_t)value * constant + (1 << 14)) >> 15;
+}
+
+/* mulhi_u16
+ * Purpose: Returns the high half of the product of two unsigned 16-bit
+ *          values, as pmulhuw does
+ * Parameters: Two unsigned values
+ * Returns: The product shifted right by 16
+ *
+ * Expected input: Any two values
+ * Success output: The high 16 bits of the product
+ * Failure output: none
+ */
+static inline uint16_t mulhi_u16(uint16_t value, uint16_t factor)
+{
+    return ((uint32_t)value * factor) >> 16;
+}
+
+/* average_u16
+ * Purpose: Averages two unsigned 16-bit values, rounding halves up, as
+ *          pavgw does
+ * Parameters: Two unsigned values
+ * Returns: Their rounded average
+ *
+ * Expected input: Any two values
+ * Success output: (first + second + 1) >> 1
+ * Failure output: none
+ */
+static inline uint16_t average_u16(uint16_t first, uint16_t second)
+{
+    return ((uint32_t)first + second + 1) >> 1;
+}
+
+/* map_difference
+ * Purpose: Turns a difference of two luma pair averages into a b, c or
+ *          d coefficient, truncating toward zero as map_bcd does
+ * Parameters: The difference in Q14
+ * Returns: The coefficient
+ *
+ * Expected input: A difference in [-16384, 16384]
+ * Success output: The difference times 100 / 32768, truncated and held
+ *                  to [-30, 30]
+ * Failure output: none
+ */
+static inline int32_t map_difference(int16_t difference)
+{
+    uint16_t magnitude = difference < 0 ? -difference : difference;
+    uint16_t steps = mulhi_u16(magnitude << 1, BCD_STEPS);
+
+    if (steps > BCD_LIMIT) {
+        steps = BCD_LIMIT;
+    }
+
+    return difference < 0 ? -(int32_t)steps : steps;
+}
+
+/* index_of_chroma_sum
+ * Purpose: Quantizes the sum of a block's four Q13 chroma values
+ * Parameters: The sum
+ * Returns: An index into chroma_of_index
+ *
+ * Expected input: A sum in [-16384, 16384]
+ * Success output: The number of thresholds the sum is above
+ * Failure output: none
+ */
+static inline uint32_t index_of_chroma_sum(int16_t sum)
+{
+    uint32_t index = 0;
+
+    for (int n = 0; n < 15; n++) {
+        index += sum > chroma_sum_threshold[n];
+    }
+
+    return index;
+}
+
+/* fixed_encode_block_row
+ * Purpose: Compresses a pair of scanlines into the coefficients and
+ *          chroma indices of a row of blocks, using only integer math
+ * Parameters: The top and bottom scanlines of a row of blocks as
+ *             packed samples (see ppmstream.h), the number of blocks,
+ *             the denominator of the image, and six arrays for the a,
+ *             b, c and d coefficients and the pb and pr indices
+ * Returns: nothing
+ *
+ * Expected input: Two scanlines of at least 2 * blocks pixels, arrays
+ *                  of at least blocks elements, and a denominator in
+ *                  [1, 65535]
+ * Success output: Element i of each array holds the field of block i's
+ *                  codeword, ready for pack_codeword_row
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ *                  or the denominator is out of range
+ */
+void fixed_encode_block_row(const unsigned char *top,
+                            const unsigned char *bottom, int blocks,
+                            unsigned denominator, uint32_t *a, int32_t *b,
+                            int32_t *c, int32_t *d, uint32_t *pb,
+                            uint32_t *pr)
+{
+    assert(blocks == 0 || (top != NULL && bottom != NULL && a != NULL
+                           && b != NULL && c != NULL && d != NULL
+                           && pb != NULL && pr != NULL));
+    assert(denominator >= 1 && denominator <= 65535);
+
+    struct sample_scale scale = scale_of_denominator(denominator);
+    bool deep = denominator > 255;
+    Sample_lanes lanes;
+
+    for (int done = 0; done < blocks; done += LANE_CHUNK) {
+        int count = blocks - done;
+        if (count > LANE_CHUNK) {
+            count = LANE_CHUNK;
+        }
+
+        load_sample_lanes(top, bottom, done, count, deep, lanes);
+        fixed_encode_lanes(lanes, count, scale, a + done, b + done,
+                           c + done, d + done, pb + done, pr + done);
+    }
+}
+
+/* fixed_decode_block_row
+ * Purpose: Decompresses the coefficients and chroma indices of a row
+ *          of blocks into a pair of scanlines, using only integer math;
+ *          the reverse of fixed_encode_block_row
+ * Parameters: Six arrays of a, b, c and d coefficients and pb and pr
+ *             indices, the number of blocks, the denominator of the
+ *             output image, and the top and bottom scanlines to fill
+ * Returns: nothing
+ *
+ * Expected input: Arrays of at least blocks elements as
+ *                  unpack_codeword_row leaves them, room for 2 * blocks
+ *                  pixels in each scanline, and a denominator in
+ *                  [1, 65535]
+ * Success output: top and bottom hold the pixels of the row of blocks,
+ *                  each sample in [0, denominator]
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ *                  or the denominator is out of range
+ */
+void fixed_decode_block_row(const uint32_t *a, const int32_t *b,
+                            const int32_t *c, const int32_t *d,
+                            const uint32_t *pb, const uint32_t *pr,
+                            int blocks, unsigned denominator,
+                            unsigned char *top, unsigned char *bottom)
+{
+    assert(blocks == 0 || (top != NULL && bottom != NULL && a != NULL
+                           && b != NULL && c != NULL && d != NULL
+                           && pb != NULL && pr != NULL));
+    assert(denominator >= 1 && denominator <= 65535);
+
+    bool deep = denominator > 255;
+    Sample_lanes lanes;
+
+    for (int done = 0; done < blocks; done += LANE_CHUNK) {
+        int count = blocks - done;
+        if (count > LANE_CHUNK) {
+            count = LANE_CHUNK;
+        }
+
+        fixed_decode_lanes(a + done, b + done, c + done, d + done,
+                           pb + done, pr + done, count, denominator,
+                           lanes);
+        store_sample_lanes(lanes, done, count, deep, top, bottom);
+    }
+}
+
+/* scale_of_denominator
+ * Purpose: Works out how to bring samples of a denominator to Q14
+ *          with one 16-bit multiply
+ * Parameters: The denominator
+ * Returns: A sample_scale
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: A shift that moves the top bit of the denominator to
+ *                  bit 15, and the multiplier 2^(30 - shift) /
+ *                  denominator, rounded up, which is at most 32768
+ * Failure output: none
+ */
+struct sample_scale scale_of_denominator(unsigned denominator)
+{
+    struct sample_scale scale;
+    unsigned bits = 32 - __builtin_clz(denominator);
+
+    scale.shift = 16 - bits;
+    scale.multiplier = ((1u << (30 - scale.shift)) + denominator - 1)
+                                                             / denominator;
+    return scale;
+}
+
+/* load_sample_lanes
+ * Purpose: Splits the samples of a chunk of blocks into lanes
+ * Parameters: The top and bottom scanlines, the first block of the
+ *             chunk, the number of blocks in it, whether samples take
+ *             two bytes, and the lanes to fill
+ * Returns: nothing
+ *
+ * Expected input: Scanlines holding the blocks of the chunk
+ * Success output: lanes[p][channel][k] holds that channel of pixel
+ *                  position p of block first + k
+ * Failure output: none
+ */
+void load_sample_lanes(const unsigned char *top,
+                       const unsigned char *bottom, int first, int count,
+                       bool deep, Sample_lanes lanes)
+{
+    const unsigned char *rows[2] = { top, bottom };
+    size_t pixel_bytes = deep ? 6 : 3;
+
+    for (int row = 0; row < 2; row++) {
+        for (int k = 0; k < count; k++) {
+            const unsigned char *pixel = rows[row]
+                                + 2 * (size_t)(first + k) * pixel_bytes;
+
+            for (int side = 0; side < 2; side++) {
+                for (int channel = 0; channel < 3; channel++) {
+                    lanes[2 * row + side][channel][k] = deep
+                            ? pixel[2 * channel] << 8 | pixel[2 * channel + 1]
+                            : pixel[channel];
+                }
+                pixel += pixel_bytes;
+            }
+        }
+    }
+}
+
+/* store_sample_lanes
+ * Purpose: Packs lanes of samples back into scanlines; the reverse of
+ *          load_sample_lanes
+ * Parameters: The lanes, the first block of the chunk, the number of
+ *             blocks in it, whether samples take two bytes, and the
+ *             top and bottom scanlines
+ * Returns: nothing
+ *
+ * Expected input: Scanlines with room for the blocks of the chunk
+ * Success output: The pixels of the chunk's blocks are stored
+ * Failure output: none
+ */
+void store_sample_lanes(Sample_lanes lanes, int first, int count,
+                        bool deep, unsigned char *top,
+                        unsigned char *bottom)
+{
+    unsigned char *rows[2] = { top, bottom };
+    size_t pixel_bytes = deep ? 6 : 3;
+
+    for (int row = 0; row < 2; row++) {
+        for (int k = 0; k < count; k++) {
+            unsigned char *pixel = rows[row]
+                                + 2 * (size_t)(first + k) * pixel_bytes;
+
+            for (int side = 0; side < 2; side++) {
+                for (int channel = 0; channel < 3; channel++) {
+                    uint16_t sample = lanes[2 * row + side][channel][k];
+                    if (deep) {
+                        *pixel++ = sample >> 8;
+                    }
+                    *pixel++ = sample;
+                }
+            }
+        }
+    }
+}
+
+/* fixed_encode_lanes
+ * Purpose: Codes a chunk of blocks from lanes of samples. Uses an AVX2
+ *          kernel that codes 16 blocks at a time when the CPU supports
+ *          it and the scalar kernel otherwise; both give the same
+ *          results.
+ * Parameters: Lanes of samples, the number of blocks, the sample_scale
+ *             of the denominator, and arrays for the a, b, c and d
+ *             coefficients and the pb and pr indices
+ * Returns: nothing
+ *
+ * Expected input: count no larger than LANE_CHUNK
+ * Success output: Element k of each array holds the field of block k
+ * Failure output: none
+ */
+void fixed_encode_lanes(Sample_lanes lanes, int count,
+                        struct sample_scale scale, uint32_t *a,
+                        int32_t *b, int32_t *c, int32_t *d, uint32_t *pb,
+                        uint32_t *pr)
+{
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        fixed_encode_lanes_avx2(lanes, count, scale, a, b, c, d, pb, pr);
+        return;
+    }
+#endif
+
+    fixed_encode_lanes_scalar(lanes, 0, count, scale, a, b, c, d, pb, pr);
+}
+
+/* fixed_decode_lanes
+ * Purpose: Decodes a chunk of blocks into lanes of samples. Uses an
+ *          AVX2 kernel that decodes 16 blocks at a time when the CPU
+ *          supports it and the scalar kernel otherwise; both give the
+ *          same results.
+ * Parameters: Arrays of a, b, c and d coefficients and pb and pr
+ *             indices, the number of blocks, the denominator of the
+ *             output image, and the lanes to fill
+ * Returns: nothing
+ *
+ * Expected input: count no larger than LANE_CHUNK
+ * Success output: The lanes hold the samples of each block
+ * Failure output: none
+ */
+void fixed_decode_lanes(const uint32_t *a, const int32_t *b,
+                        const int32_t *c, const int32_t *d,
+                        const uint32_t *pb, const uint32_t *pr, int count,
+                        unsigned denominator, Sample_lanes lanes)
+{
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        fixed_decode_lanes_avx2(a, b, c, d, pb, pr, count, denominator,
+                                lanes);
+        return;
+    }
+#endif
+
+    fixed_decode_lanes_scalar(a, b, c, d, pb, pr, 0, count, denominator,
+                              lanes);
+}
+
+/* fixed_encode_lanes_scalar
+ * Purpose: Reference version of fixed_encode_lanes that codes one
+ *          block at a time. These are the formulas every fixed-point
+ *          encode kernel must match.
+ * Parameters: Same as fixed_encode_lanes, plus the first block to code
+ * Returns: nothing
+ *
+ * Expected input: Same as fixed_encode_lanes
+ * Success output: Same as fixed_encode_lanes, for blocks first through
+ *                  count - 1
+ * Failure output: none
+ */
+void fixed_encode_lanes_scalar(Sample_lanes lanes, int first, int count,
+                               struct sample_scale scale, uint32_t *a,
+                               int32_t *b, int32_t *c, int32_t *d,
+                               uint32_t *pb, uint32_t *pr)
+{
+    for (int k = first; k < count; k++) {
+        uint16_t y[4];
+        int16_t pb_sum = 0;
+        int16_t pr_sum = 0;
+
+        for (int p = 0; p < 4; p++) {
+            int16_t rgb[3];
+            for (int channel = 0; channel < 3; channel++) {
+                rgb[channel] = mulhi_u16(lanes[p][channel][k] << scale.shift,
+                                         scale.multiplier);
+            }
+
+            y[p] = mul_q15(rgb[0], Y_RED) + mul_q15(rgb[1], Y_GREEN)
+                                          + mul_q15(rgb[2], Y_BLUE);
+            pb_sum += mul_q15(rgb[0], PB_RED) + mul_q15(rgb[1], PB_GREEN)
+                                              + mul_q15(rgb[2], PB_BLUE);
+            pr_sum += mul_q15(rgb[0], PR_RED) + mul_q15(rgb[1], PR_GREEN)
+                                              + mul_q15(rgb[2], PR_BLUE);
+        }
+
+        uint16_t top = average_u16(y[0], y[1]);
+        uint16_t bottom = average_u16(y[2], y[3]);
+        uint16_t left = average_u16(y[0], y[2]);
+        uint16_t right = average_u16(y[1], y[3]);
+        uint16_t falling = average_u16(y[0], y[3]);
+        uint16_t rising = average_u16(y[1], y[2]);
+
+        a[k] = mulhi_u16(average_u16(top, bottom), A_SCALE);
+        b[k] = map_difference(bottom - top);
+        c[k] = map_difference(right - left);
+        d[k] = map_difference(falling - rising);
+        pb[k] = index_of_chroma_sum(pb_sum);
+        pr[k] = index_of_chroma_sum(pr_sum);
+    }
+}
+
+/* fixed_decode_lanes_scalar
+ * Purpose: Reference version of fixed_decode_lanes that decodes one
+ *          block at a time. These are the formulas every fixed-point
+ *          decode kernel must match. Each channel is worked out
+ *          exactly and then held to [0, Q14_ONE], which is what the
+ *          saturating adds of the vector kernel come to.
+ * Parameters: Same as fixed_decode_lanes, plus the first block to
+ *             decode
+ * Returns: nothing
+ *
+ * Expected input: Same as fixed_decode_lanes
+ * Success output: Same as fixed_decode_lanes, for blocks first through
+ *                  count - 1
+ * Failure output: Raises a Checked Runtime Error if a chroma index is
+ *                  not in [0, 15]
+ */
+void fixed_decode_lanes_scalar(const uint32_t *a, const int32_t *b,
+                               const int32_t *c, const int32_t *d,
+                               const uint32_t *pb, const uint32_t *pr,
+                               int first, int count, unsigned denominator,
+                               Sample_lanes lanes)
+{
+    for (int k = first; k < count; k++) {
+        assert(pb[k] < 16 && pr[k] < 16);
+
+        int16_t mean = mul_q15(a[k] << 9, A_UNSCALE);
+        int16_t b_value = mul_q15(b[k] * 256, BCD_UNSCALE);
+        int16_t c_value = mul_q15(c[k] * 256, BCD_UNSCALE);
+        int16_t d_value = mul_q15(d[k] * 256, BCD_UNSCALE);
+        int16_t pb4 = chroma_of_index[pb[k]] * 4;
+        int16_t pr4 = chroma_of_index[pr[k]] * 4;
+
+        int16_t y[4];
+        y[0] = mean - b_value - c_value + d_value;
+        y[1] = mean - b_value + c_value - d_value;
+        y[2] = mean + b_value - c_value - d_value;
+        y[3] = mean + b_value + c_value + d_value;
+
+        for (int p = 0; p < 4; p++) {
+            int32_t rgb[3];
+            rgb[0] = y[p] + mul_q15(pr4, RED_PR);
+            rgb[1] = y[p] - mul_q15(pb4, GREEN_PB) - mul_q15(pr4, GREEN_PR);
+            rgb[2] = y[p] + mul_q15(pb4, BLUE_PB);
+
+            for (int channel = 0; channel < 3; channel++) {
+                int32_t value = rgb[channel];
+                if (value > Q14_ONE) {
+                    value = Q14_ONE;
+                } else if (value < 0) {
+                    value = 0;
+                }
+                lanes[p][channel][k] = ((uint32_t)value * denominator) >> 14;
+            }
+        }
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* widen_store_avx2
+ * Purpose: Stores 16 signed 16-bit lanes as 16 32-bit integers
+ * Parameters: An array of at least 16 integers and the lanes
+ * Returns: nothing
+ *
+ * Expected input: A valid array
+ * Success output: out[k] holds lane k, sign extended
+ * Failure output: none
+ */
+AVX2_KERNEL
+static inline void widen_store_avx2(int32_t *out, __m256i lanes)
+{
+    _mm256_storeu_si256((__m256i *)out,
+            _mm256_cvtepi16_epi32(_mm256_castsi256_si128(lanes)));
+    _mm256_storeu_si256((__m256i *)(out + 8),
+            _mm256_cvtepi16_epi32(_mm256_extracti128_si256(lanes, 1)));
+}
+
+/* narrow_load_avx2
+ * Purpose: Loads 16 32-bit integers into 16-bit lanes, in order
+ * Parameters: An array of at least 16 integers
+ * Returns: The lanes
+ *
+ * Expected input: Integers that fit in 16 bits
+ * Success output: Lane k holds in[k]
+ * Failure output: none
+ */
+AVX2_KERNEL
+static inline __m256i narrow_load_avx2(const int32_t *in)
+{
+    __m256i low = _mm256_loadu_si256((const __m256i *)in);
+    __m256i high = _mm256_loadu_si256((const __m256i *)(in + 8));
+
+    /* packs works within 128-bit halves, so put the quarters back in
+     * order */
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(low, high), 0xD8);
+}
+
+/* chroma_load_avx2
+ * Purpose: Looks up 16 chroma indices in chroma_of_index
+ * Parameters: An array of at least 16 indices
+ * Returns: The Q13 chroma values in 16-bit lanes
+ *
+ * Expected input: Indices in [0, 15]
+ * Success output: Lane k holds chroma_of_index[index[k]]
+ * Failure output: none
+ */
+AVX2_KERNEL
+static inline __m256i chroma_load_avx2(const uint32_t *index)
+{
+    const __m256i low_table = _mm256_cvtepi16_epi32(
+                    _mm_loadu_si128((const __m128i *)chroma_of_index));
+    const __m256i high_table = _mm256_cvtepi16_epi32(
+                    _mm_loadu_si128((const __m128i *)(chroma_of_index + 8)));
+    __m256i halves[2];
+
+    for (int half = 0; half < 2; half++) {
+        __m256i at = _mm256_loadu_si256((const __m256i *)(index + 8 * half));
+        __m256i high = _mm256_cmpgt_epi32(at, _mm256_set1_epi32(7));
+        halves[half] = _mm256_blendv_epi8(
+                            _mm256_permutevar8x32_epi32(low_table, at),
+                            _mm256_permutevar8x32_epi32(high_table, at),
+                            high);
+    }
+
+    return _mm256_permute4x64_epi64(
+                    _mm256_packs_epi32(halves[0], halves[1]), 0xD8);
+}
+
+/* map_difference_avx2
+ * Purpose: map_difference on 16 lanes
+ * Parameters: Differences in Q14
+ * Returns: The coefficients in 16-bit lanes
+ *
+ * Expected input: Differences in [-16384, 16384]
+ * Success output: The values map_difference returns
+ * Failure output: none
+ */
+AVX2_KERNEL
+static inline __m256i map_difference_avx2(__m256i difference)
+{
+    __m256i magnitude = _mm256_abs_epi16(difference);
+    __m256i steps = _mm256_mulhi_epu16(_mm256_slli_epi16(magnitude, 1),
+                                       _mm256_set1_epi16(BCD_STEPS));
+
+    steps = _mm256_min_epi16(steps, _mm256_set1_epi16(BCD_LIMIT));
+    return _mm256_sign_epi16(steps, difference);
+}
+
+/* fixed_encode_lanes_avx2
+ * Purpose: AVX2 version of fixed_encode_lanes. Runs the scalar
+ *          kernel's steps on 16 blocks at a time with the instructions
+ *          its helpers describe, and finds each chroma index by
+ *          counting the thresholds below it.
+ * Parameters: Same as fixed_encode_lanes
+ * Returns: nothing
+ *
+ * Expected input: Same as fixed_encode_lanes, on a CPU with AVX2
+ * Success output: Same as fixed_encode_lanes
+ * Failure output: none
+ */
+AVX2_KERNEL
+void fixed_encode_lanes_avx2(Sample_lanes lanes, int count,
+                             struct sample_scale scale, uint32_t *a,
+                             int32_t *b, int32_t *c, int32_t *d,
+                             uint32_t *pb, uint32_t *pr)
+{
+    const __m128i shift = _mm_cvtsi32_si128(scale.shift);
+    const __m256i multiplier = _mm256_set1_epi16(scale.multiplier);
+    int k = 0;
+
+    for (; k + 16 <= count; k += 16) {
+        __m256i y[4];
+        __m256i pb_sum = _mm256_setzero_si256();
+        __m256i pr_sum = _mm256_setzero_si256();
+
+        for (int p = 0; p < 4; p++) {
+            __m256i rgb[3];
+            for (int channel = 0; channel < 3; channel++) {
+                __m256i sample = _mm256_loadu_si256(
+                                (const __m256i *)&lanes[p][channel][k]);
+                rgb[channel] = _mm256_mulhi_epu16(
+                                _mm256_sll_epi16(sample, shift), multiplier);
+            }
+
+            y[p] = _mm256_add_epi16(_mm256_add_epi16(
+                    _mm256_mulhrs_epi16(rgb[0], _mm256_set1_epi16(Y_RED)),
+                    _mm256_mulhrs_epi16(rgb[1], _mm256_set1_epi16(Y_GREEN))),
+                    _mm256_mulhrs_epi16(rgb[2], _mm256_set1_epi16(Y_BLUE)));
+            pb_sum = _mm256_add_epi16(pb_sum, _mm256_add_epi16(
+                    _mm256_add_epi16(
+                    _mm256_mulhrs_epi16(rgb[0], _mm256_set1_epi16(PB_RED)),
+                    _mm256_mulhrs_epi16(rgb[1], _mm256_set1_epi16(PB_GREEN))),
+                    _mm256_mulhrs_epi16(rgb[2], _mm256_set1_epi16(PB_BLUE))));
+            pr_sum = _mm256_add_epi16(pr_sum, _mm256_add_epi16(
+                    _mm256_add_epi16(
+                    _mm256_mulhrs_epi16(rgb[0], _mm256_set1_epi16(PR_RED)),
+                    _mm256_mulhrs_epi16(rgb[1], _mm256_set1_epi16(PR_GREEN))),
+                    _mm256_mulhrs_epi16(rgb[2], _mm256_set1_epi16(PR_BLUE))));
+        }
+
+        __m256i top = _mm256_avg_epu16(y[0], y[1]);
+        __m256i bottom = _mm256_avg_epu16(y[2], y[3]);
+        __m256i left = _mm256_avg_epu16(y[0], y[2]);
+        __m256i right = _mm256_avg_epu16(y[1], y[3]);
+        __m256i falling = _mm256_avg_epu16(y[0], y[3]);
+        __m256i rising = _mm256_avg_epu16(y[1], y[2]);
+
+        /* Each compare that holds subtracts -1 from the index */
+        __m256i pb_index = _mm256_setzero_si256();
+        __m256i pr_index = _mm256_setzero_si256();
+        for (int n = 0; n < 15; n++) {
+            __m256i threshold = _mm256_set1_epi16(chroma_sum_threshold[n]);
+            pb_index = _mm256_sub_epi16(pb_index,
+                                    _mm256_cmpgt_epi16(pb_sum, threshold));
+            pr_index = _mm256_sub_epi16(pr_index,
+                                    _mm256_cmpgt_epi16(pr_sum, threshold));
+        }
+
+        widen_store_avx2((int32_t *)&a[k], _mm256_mulhi_epu16(
+                            _mm256_avg_epu16(top, bottom),
+                            _mm256_set1_epi16(A_SCALE)));
+        widen_store_avx2(&b[k], map_difference_avx2(
+                                        _mm256_sub_epi16(bottom, top)));
+        widen_store_avx2(&c[k], map_difference_avx2(
+                                        _mm256_sub_epi16(right, left)));
+        widen_store_avx2(&d[k], map_difference_avx2(
+                                        _mm256_sub_epi16(falling, rising)));
+        widen_store_avx2((int32_t *)&pb[k], pb_index);
+        widen_store_avx2((int32_t *)&pr[k], pr_index);
+    }
+
+    fixed_encode_lanes_scalar(lanes, k, count, scale, a, b, c, d, pb, pr);
+}
+
+/* fixed_decode_lanes_avx2
+ * Purpose: AVX2 version of fixed_decode_lanes. Runs the scalar
+ *          kernel's steps on 16 blocks at a time, with saturating adds
+ *          and min/max standing in for its exact sums and clamp, and
+ *          scales to the denominator with a high and a low multiply.
+ * Parameters: Same as fixed_decode_lanes
+ * Returns: nothing
+ *
+ * Expected input: Same as fixed_decode_lanes, on a CPU with AVX2
+ * Success output: Same as fixed_decode_lanes
+ * Failure output: none
+ */
+AVX2_KERNEL
+void fixed_decode_lanes_avx2(const uint32_t *a, const int32_t *b,
+                             const int32_t *c, const int32_t *d,
+                             const uint32_t *pb, const uint32_t *pr,
+                             int count, unsigned denominator,
+                             Sample_lanes lanes)
+{
+    const __m256i unscale = _mm256_set1_epi16(BCD_UNSCALE);
+    const __m256i denom = _mm256_set1_epi16((int16_t)denominator);
+    const __m256i ceiling = _mm256_set1_epi16(Q14_ONE);
+    const __m256i floor = _mm256_setzero_si256();
+    int k = 0;
+
+    for (; k + 16 <= count; k += 16) {
+        __m256i mean = _mm256_mulhrs_epi16(_mm256_slli_epi16(
+                            narrow_load_avx2((const int32_t *)&a[k]), 9),
+                            _mm256_set1_epi16(A_UNSCALE));
+        __m256i b_value = _mm256_mulhrs_epi16(_mm256_slli_epi16(
+                            narrow_load_avx2(&b[k]), 8), unscale);
+        __m256i c_value = _mm256_mulhrs_epi16(_mm256_slli_epi16(
+                            narrow_load_avx2(&c[k]), 8), unscale);
+        __m256i d_value = _mm256_mulhrs_epi16(_mm256_slli_epi16(
+                            narrow_load_avx2(&d[k]), 8), unscale);
+        __m256i pb4 = _mm256_slli_epi16(chroma_load_avx2(&pb[k]), 2);
+        __m256i pr4 = _mm256_slli_epi16(chroma_load_avx2(&pr[k]), 2);
+
+        __m256i mean_minus_b = _mm256_sub_epi16(mean, b_value);
+        __m256i mean_plus_b = _mm256_add_epi16(mean, b_value);
+        __m256i y[4];
+        y[0] = _mm256_add_epi16(_mm256_sub_epi16(mean_minus_b, c_value),
+                                                                d_value);
+        y[1] = _mm256_sub_epi16(_mm256_add_epi16(mean_minus_b, c_value),
+                                                                d_value);
+        y[2] = _mm256_sub_epi16(_mm256_sub_epi16(mean_plus_b, c_value),
+                                                                d_value);
+        y[3] = _mm256_add_epi16(_mm256_add_epi16(mean_plus_b, c_value),
+                                                                d_value);
+
+        __m256i red_term = _mm256_mulhrs_epi16(pr4,
+                                            _mm256_set1_epi16(RED_PR));
+        __m256i green_pb = _mm256_mulhrs_epi16(pb4,
+                                            _mm256_set1_epi16(GREEN_PB));
+        __m256i green_pr = _mm256_mulhrs_epi16(pr4,
+                                            _mm256_set1_epi16(GREEN_PR));
+        __m256i blue_term = _mm256_mulhrs_epi16(pb4,
+                                            _mm256_set1_epi16(BLUE_PB));
+
+        for (int p = 0; p < 4; p++) {
+            __m256i rgb[3];
+            rgb[0] = _mm256_adds_epi16(y[p], red_term);
+            rgb[1] = _mm256_subs_epi16(_mm256_subs_epi16(y[p], green_pb),
+                                                               green_pr);
+            rgb[2] = _mm256_adds_epi16(y[p], blue_term);
+
+            for (int channel = 0; channel < 3; channel++) {
+                __m256i value = _mm256_max_epi16(
+                            _mm256_min_epi16(rgb[channel], ceiling), floor);
+                __m256i sample = _mm256_or_si256(
+                    _mm256_slli_epi16(_mm256_mulhi_epu16(value, denom), 2),
+                    _mm256_srli_epi16(_mm256_mullo_epi16(value, denom), 14));
+                _mm256_storeu_si256((__m256i *)&lanes[p][channel][k],
+                                    sample);
+            }
+        }
+    }
+
+    fixed_decode_lanes_scalar(a, b, c, d, pb, pr, k, count, denominator,
+                              lanes);
+}
+#endif
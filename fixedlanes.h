@@ -0,0 +1,105 @@
+/**************************************************************
+ *
+ *                     fixedlanes.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     The lane kernels behind the fixedcodec class, shared by
+ *     fixedcodec.c and its test, which checks the AVX2 kernels
+ *     against the scalar ones. Nothing else should need them:
+ *     fixedcodec.h is the interface for coding rows of blocks.
+ *
+ **************************************************************/
+#ifndef FIXEDLANES_INCLUDED
+#define FIXEDLANES_INCLUDED
+#include <stdint.h>
+
+#include "simd.h"
+
+/* Blocks split into lanes at a time by the row functions */
+#define LANE_CHUNK 64
+
+/* How samples of one denominator become Q14: a sample shifted left by
+ * shift, times multiplier, keeping the high 16 bits. The multiplier is
+ * rounded up so a sample equal to the denominator becomes exactly
+ * Q14_ONE. */
+struct sample_scale {
+    unsigned shift;
+    uint16_t multiplier;
+};
+
+/* Samples of a chunk of blocks, by pixel position in the block
+ * (top-left, top-right, bottom-left, bottom-right), then channel */
+typedef uint16_t Sample_lanes[4][3][LANE_CHUNK];
+
+/* scale_of_denominator
+ * Purpose: Works out how to bring samples of a denominator to Q14
+ *          with one 16-bit multiply
+ * Parameters: The denominator
+ * Returns: A sample_scale
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: The shift and multiplier for the denominator
+ * Failure output: none
+ */
+struct sample_scale scale_of_denominator(unsigned denominator);
+
+/* fixed_encode_lanes_scalar, fixed_encode_lanes_avx2
+ * Purpose: Code blocks first through count - 1 of a chunk from lanes
+ *          of samples, one block at a time or, in the AVX2 kernel, 16
+ *          at a time from block 0. The scalar kernel is the reference.
+ * Parameters: Lanes of samples, the first block to code (scalar only),
+ *             the number of blocks, the sample_scale of the
+ *             denominator, and arrays for the a, b, c and d
+ *             coefficients and the pb and pr indices
+ * Returns: nothing
+ *
+ * Expected input: count no larger than LANE_CHUNK; for the AVX2
+ *                  kernel, a CPU with AVX2
+ * Success output: Element k of each array holds the field of block k
+ * Failure output: none
+ */
+void fixed_encode_lanes_scalar(Sample_lanes lanes, int first, int count,
+                               struct sample_scale scale, uint32_t *a,
+                               int32_t *b, int32_t *c, int32_t *d,
+                               uint32_t *pb, uint32_t *pr);
+#ifdef HAVE_AVX2_KERNELS
+void fixed_encode_lanes_avx2(Sample_lanes lanes, int count,
+                             struct sample_scale scale, uint32_t *a,
+                             int32_t *b, int32_t *c, int32_t *d,
+                             uint32_t *pb, uint32_t *pr);
+#endif
+
+/* fixed_decode_lanes_scalar, fixed_decode_lanes_avx2
+ * Purpose: Decode blocks first through count - 1 of a chunk into lanes
+ *          of samples, one block at a time or, in the AVX2 kernel, 16
+ *          at a time from block 0. The scalar kernel is the reference.
+ * Parameters: Arrays of a, b, c and d coefficients and pb and pr
+ *             indices, the first block to decode (scalar only), the
+ *             number of blocks, the denominator of the output image,
+ *             and the lanes to fill
+ * Returns: nothing
+ *
+ * Expected input: count no larger than LANE_CHUNK; for the AVX2
+ *                  kernel, a CPU with AVX2
+ * Success output: The lanes hold the samples of each block
+ * Failure output: The scalar kernel raises a Checked Runtime Error if
+ *                  a chroma index is not in [0, 15]
+ */
+void fixed_decode_lanes_scalar(const uint32_t *a, const int32_t *b,
+                               const int32_t *c, const int32_t *d,
+                               const uint32_t *pb, const uint32_t *pr,
+                               int first, int count, unsigned denominator,
+                               Sample_lanes lanes);
+#ifdef HAVE_AVX2_KERNELS
+void fixed_decode_lanes_avx2(const uint32_t *a, const int32_t *b,
+                             const int32_t *c, const int32_t *d,
+                             const uint32_t *pb, const uint32_t *pr,
+                             int count, unsigned denominator,
+                             Sample_lanes lanes);
+#endif
+
+#endif
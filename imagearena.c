@@ -0,0 +1,212 @@
+/**************************************************************
+ *
+ *                     imagearena.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Implementation of the imagearena class.
+ *
+ **************************************************************/
+#include <string.h>
+
+#include "imagearena.h"
+
+#define ARENA_ALIGN 64
+
+/* overflow is storage handed out after the buffer filled up. It is
+ * kept on a list so reset can free it. */
+struct overflow {
+    struct overflow *next;
+    void *storage;
+};
+
+struct Image_arena {
+    char *buffer;
+    size_t capacity;            /* bytes in buffer */
+    size_t used;                /* bytes of buffer handed out */
+    size_t wanted;              /* bytes handed out since the reset */
+    struct overflow *overflow;
+};
+
+static Image_arena selected = NULL;
+
+void *aligned_block(size_t bytes);
+void free_overflow(Image_arena arena);
+
+/* image_arena_new
+ * Purpose: Makes an empty arena
+ * Parameters: none
+ * Returns: An Image_arena
+ *
+ * Expected input: none
+ * Success output: An arena with no buffer yet; the first image sizes it
+ * Failure output: Raises a Checked Runtime Error if allocation fails
+ */
+Image_arena image_arena_new(void)
+{
+    Image_arena arena = malloc(sizeof(struct Image_arena));
+    assert(arena);
+
+    arena->buffer = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+    arena->wanted = 0;
+    arena->overflow = NULL;
+
+    return arena;
+}
+
+/* image_arena_free
+ * Purpose: Frees an arena and all of the storage it has handed out
+ * Parameters: A pointer to an Image_arena
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid arena that is not selected
+ * Success output: The arena is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if arena is NULL or
+ *                  is still selected
+ */
+void image_arena_free(Image_arena *arena)
+{
+    assert(arena != NULL && *arena != NULL);
+    assert(*arena != selected);
+
+    free_overflow(*arena);
+    free((*arena)->buffer);
+    free(*arena);
+    *arena = NULL;
+}
+
+/* image_arena_alloc
+ * Purpose: Hands out zeroed storage that lives until the next reset
+ * Parameters: An Image_arena and a number of bytes
+ * Returns: A pointer to the storage, aligned to 64 bytes
+ *
+ * Expected input: A valid arena
+ * Success output: bytes zeroed bytes. They come out of the arena's
+ *                  buffer when it has room and from a separate
+ *                  allocation otherwise.
+ * Failure output: Raises a Checked Runtime Error if arena is NULL or
+ *                  allocation fails
+ */
+void *image_arena_alloc(Image_arena arena, size_t bytes)
+{
+    assert(arena != NULL);
+
+    /* Round up so the next piece stays aligned */
+    size_t rounded = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if (rounded == 0) {
+        rounded = ARENA_ALIGN;
+    }
+    arena->wanted += rounded;
+
+    void *storage;
+    if (rounded <= arena->capacity - arena->used) {
+        storage = arena->buffer + arena->used;
+        arena->used += rounded;
+    } else {
+        struct overflow *piece = malloc(sizeof(struct overflow));
+        assert(piece);
+        piece->storage = aligned_block(rounded);
+        piece->next = arena->overflow;
+        arena->overflow = piece;
+        storage = piece->storage;
+    }
+
+    memset(storage, 0, bytes);
+    return storage;
+}
+
+/* image_arena_reset
+ * Purpose: Takes back everything the arena has handed out, keeping
+ *          its buffer for the next image
+ * Parameters: An Image_arena
+ * Returns: nothing
+ *
+ * Expected input: A valid arena whose storage is no longer in use
+ * Success output: The arena is empty and its buffer holds at least as
+ *                  many bytes as were handed out since the last reset
+ * Failure output: Raises a Checked Runtime Error if arena is NULL
+ */
+void image_arena_reset(Image_arena arena)
+{
+    assert(arena != NULL);
+
+    /* Anything that spilled over means the buffer was too small, so
+     * replace it with one that would have held the whole image */
+    if (arena->overflow != NULL) {
+        free_overflow(arena);
+        free(arena->buffer);
+        arena->buffer = aligned_block(arena->wanted);
+        arena->capacity = arena->wanted;
+    }
+
+    arena->used = 0;
+    arena->wanted = 0;
+}
+
+/* image_arena_select, image_arena_selected
+ * Purpose: Choose the arena that UArray2_new and UArray2b_new take
+ *          their storage from, and return it. Selecting NULL puts the
+ *          arrays back on malloc. The selection is shared by the whole
+ *          process, so only select an arena around code that makes
+ *          arrays from a single thread.
+ * Parameters: An Image_arena or NULL
+ * Returns: nothing, and the selected arena or NULL
+ *
+ * Expected input: A valid arena or NULL
+ * Success output: New arrays use the selected arena until another is
+ *                  selected
+ * Failure output: none
+ */
+void image_arena_select(Image_arena arena)
+{
+    selected = arena;
+}
+
+Image_arena image_arena_selected(void)
+{
+    return selected;
+}
+
+/* aligned_block
+ * Purpose: Helper function that allocates a block of memory aligned to
+ *          ARENA_ALIGN bytes
+ * Parameters: A number of bytes
+ * Returns: A pointer to the block
+ *
+ * Expected input: A number of bytes that is a multiple of ARENA_ALIGN
+ * Success output: The block, which is released with free
+ * Failure output: Raises a Checked Runtime Error if allocation fails
+ */
+void *aligned_block(size_t bytes)
+{
+    void *block = NULL;
+    int failed = posix_memalign(&block, ARENA_ALIGN, bytes);
+    assert(!failed);
+
+    return block;
+}
+
+/* free_overflow
+ * Purpose: Helper function that frees the storage handed out after the
+ *          arena's buffer filled up
+ * Parameters: An Image_arena
+ * Returns: nothing
+ *
+ * Expected input: A valid arena
+ * Success output: The overflow list is freed and empty
+ * Failure output: none
+ */
+void free_overflow(Image_arena arena)
+{
+    while (arena->overflow != NULL) {
+        struct overflow *piece = arena->overflow;
+        arena->overflow = piece->next;
+        free(piece->storage);
+        free(piece);
+    }
+}
@@ -0,0 +1,93 @@
+/**************************************************************
+ *
+ *                     imagearena.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     This file is the interface of our imagearena class. An
+ *     Image_arena hands out the storage of every UArray2 and
+ *     UArray2b made while one image is being coded and takes it all
+ *     back at once when the image is done. The arena keeps its
+ *     buffer between images, growing it to the most any image has
+ *     needed, so a process that codes many images of similar size
+ *     stops asking the system for memory after the first one.
+ *
+ **************************************************************/
+#ifndef IMAGEARENA_INCLUDED
+#define IMAGEARENA_INCLUDED
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct Image_arena *Image_arena;
+
+/* image_arena_new
+ * Purpose: Makes an empty arena
+ * Parameters: none
+ * Returns: An Image_arena
+ *
+ * Expected input: none
+ * Success output: An arena with no buffer yet; the first image sizes it
+ * Failure output: Raises a Checked Runtime Error if allocation fails
+ */
+Image_arena image_arena_new(void);
+
+/* image_arena_free
+ * Purpose: Frees an arena and all of the storage it has handed out
+ * Parameters: A pointer to an Image_arena
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid arena that is not selected
+ * Success output: The arena is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if arena is NULL or
+ *                  is still selected
+ */
+void image_arena_free(Image_arena *arena);
+
+/* image_arena_alloc
+ * Purpose: Hands out zeroed storage that lives until the next reset
+ * Parameters: An Image_arena and a number of bytes
+ * Returns: A pointer to the storage, aligned to 64 bytes
+ *
+ * Expected input: A valid arena
+ * Success output: bytes zeroed bytes. They come out of the arena's
+ *                  buffer when it has room and from a separate
+ *                  allocation otherwise.
+ * Failure output: Raises a Checked Runtime Error if arena is NULL or
+ *                  allocation fails
+ */
+void *image_arena_alloc(Image_arena arena, size_t bytes);
+
+/* image_arena_reset
+ * Purpose: Takes back everything the arena has handed out, keeping
+ *          its buffer for the next image
+ * Parameters: An Image_arena
+ * Returns: nothing
+ *
+ * Expected input: A valid arena whose storage is no longer in use
+ * Success output: The arena is empty and its buffer holds at least as
+ *                  many bytes as were handed out since the last reset
+ * Failure output: Raises a Checked Runtime Error if arena is NULL
+ */
+void image_arena_reset(Image_arena arena);
+
+/* image_arena_select, image_arena_selected
+ * Purpose: Choose the arena that UArray2_new and UArray2b_new take
+ *          their storage from, and return it. Selecting NULL puts the
+ *          arrays back on malloc. The selection is shared by the whole
+ *          process, so only select an arena around code that makes
+ *          arrays from a single thread.
+ * Parameters: An Image_arena or NULL
+ * Returns: nothing, and the selected arena or NULL
+ *
+ * Expected input: A valid arena or NULL
+ * Success output: New arrays use the selected arena until another is
+ *                  selected
+ * Failure output: none
+ */
+void image_arena_select(Image_arena arena);
+Image_arena image_arena_selected(void);
+
+#endif
@@ -0,0 +1,108 @@
+/**************************************************************
+ *
+ *                     plainrows.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Direct access to the cells of plain arrays (those made by
+ *     uarray2_methods_plain) for the codec's inner loops. Every
+ *     function here is static inline and reads the UArray2
+ *     representation itself, so a loop over a row costs one
+ *     pointer load instead of a call through the A2Methods table,
+ *     into UArray2_at and its bounds checks, per cell, and the
+ *     compiler can see and vectorize the whole loop. They are the
+ *     inline versions of UArray2_row and UArray2_at. The cells of a
+ *     row are contiguous, size bytes apart, and each row starts
+ *     stride bytes after the one above it (see uarray2rep.h). Once
+ *     UArray2_shrink has narrowed an array, stride is more than a
+ *     row's width, so the rows are not one run of cells and must be
+ *     copied a row at a time. The A2Methods interface is unchanged
+ *     for everything else.
+ *
+ **************************************************************/
+#ifndef PLAINROWS_INCLUDED
+#define PLAINROWS_INCLUDED
+#include <stdlib.h>
+#include <assert.h>
+#include <a2methods.h>
+
+#include "uarray2.h"
+#include "uarray2rep.h"
+
+/* plain_width, plain_height, plain_size
+ * Purpose: Return the dimensions and cell size of a plain array
+ * Parameters: A plain array
+ * Returns: An int
+ *
+ * Expected input: An array made by uarray2_methods_plain
+ * Success output: What the methods' width, height and size return
+ * Failure output: Raises a Checked Runtime Error if array is NULL
+ */
+static inline int plain_width(A2Methods_UArray2 array)
+{
+    assert(array != NULL);
+    return ((UArray2_T)array)->width;
+}
+
+static inline int plain_height(A2Methods_UArray2 array)
+{
+    assert(array != NULL);
+    return ((UArray2_T)array)->height;
+}
+
+static inline int plain_size(A2Methods_UArray2 array)
+{
+    assert(array != NULL);
+    return ((UArray2_T)array)->size;
+}
+
+/* plain_row
+ * Purpose: Returns the cells of one row of a plain array
+ * Parameters: A plain array and a row
+ * Returns: A pointer to cell (0, j); cell (i, j) is i * plain_size
+ *          bytes further on. Row j + 1 starts stride bytes after row
+ *          j, which may leave a gap after the row's last cell.
+ *
+ * Expected input: An array made by uarray2_methods_plain and a row in
+ *                  [0, height)
+ * Success output: The row's cells, valid until the array is freed.
+ *                  They may be read or written.
+ * Failure output: Raises a Checked Runtime Error if array is NULL or
+ *                  j is out of range
+ */
+static inline void *plain_row(A2Methods_UArray2 array, int j)
+{
+    UArray2_T uarray2 = array;
+
+    assert(uarray2 != NULL);
+    assert(j >= 0 && j < uarray2->height);
+    return uarray2->cells + (size_t)j * uarray2->stride;
+}
+
+/* plain_at
+ * Purpose: Returns one cell of a plain array; the inline version of
+ *          the methods' at
+ * Parameters: A plain array, a column and a row
+ * Returns: A pointer to cell (i, j)
+ *
+ * Expected input: An array made by uarray2_methods_plain and a cell
+ *                  inside it
+ * Success output: The cell
+ * Failure output: Raises a Checked Runtime Error if array is NULL or
+ *                  the cell is out of range
+ */
+static inline void *plain_at(A2Methods_UArray2 array, int i, int j)
+{
+    UArray2_T uarray2 = array;
+
+    assert(uarray2 != NULL);
+    assert(i >= 0 && i < uarray2->width);
+    assert(j >= 0 && j < uarray2->height);
+    return uarray2->cells + (size_t)j * uarray2->stride
+                          + (size_t)i * uarray2->size;
+}
+
+#endif
@@ -0,0 +1,417 @@
+/**************************************************************
+ *
+ *                     ppmstream.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Implementation of the ppmstream class. A raw ppm in a regular
+ *     file is mapped and its scanlines are handed out from the
+ *     mapping; pipes and plain ppms are read into a buffer a band
+ *     at a time.
+ *
+ **************************************************************/
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "ppmstream.h"
+
+struct Ppm_reader {
+    FILE *input;
+    unsigned width, height, denominator;
+    bool plain;                 /* P3 rasters are stored as text */
+    size_t row_bytes;           /* bytes in one packed scanline */
+    unsigned rows_read;
+
+    /* Rows that are not mapped are read into buffer */
+    unsigned char *buffer;
+    int buffer_rows;            /* scanlines buffer has room for */
+
+    /* A mapped P6 raster is handed out straight from map */
+    unsigned char *map;
+    size_t map_length, map_skip;    /* map_skip: bytes before the raster */
+    off_t raster_start;
+};
+
+struct Ppm_writer {
+    FILE *output;
+    size_t row_bytes;
+};
+
+unsigned read_header_number(FILE *input);
+void read_plain_rows(Ppm_reader reader, unsigned char *samples, int rows);
+bool map_raster(Ppm_reader reader);
+
+/* ppm_pixel_bytes
+ * Purpose: Returns the number of bytes in one pixel of packed samples
+ * Parameters: The denominator of the image
+ * Returns: The size of a pixel in bytes
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: 3, or 6 if the denominator is larger than 255
+ * Failure output: none
+ */
+size_t ppm_pixel_bytes(unsigned denominator)
+{
+    /* Samples take two bytes each once the denominator passes 255 */
+    return denominator > 255 ? 6 : 3;
+}
+
+/* ppm_row_bytes
+ * Purpose: Returns the number of bytes in one packed scanline
+ * Parameters: The width of the image and its denominator
+ * Returns: The size of a scanline in bytes
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: 3 bytes per pixel, or 6 if the denominator is
+ *                  larger than 255
+ * Failure output: none
+ */
+size_t ppm_row_bytes(unsigned width, unsigned denominator)
+{
+    return (size_t)width * ppm_pixel_bytes(denominator);
+}
+
+/* ppm_reader_new
+ * Purpose: Reads the header of a ppm and returns a reader positioned
+ *          at the first scanline of the raster. If the input is a
+ *          raw ppm in a regular file holding the whole raster, the
+ *          raster is mapped read-only.
+ * Parameters: A file pointer
+ * Returns: A Ppm_reader
+ *
+ * Expected input: A file containing a valid P3 or P6 ppm
+ * Success output: A reader whose width, height and denominator match
+ *                  the header of the ppm
+ * Failure output: Raises Pnm_Badformat if the header is malformed and
+ *                  a Checked Runtime Error if input is NULL
+ */
+Ppm_reader ppm_reader_new(FILE *input)
+{
+    assert(input != NULL);
+
+    int p = getc(input);
+    int kind = getc(input);
+    if (p != 'P' || (kind != '3' && kind != '6')) {
+        RAISE(Pnm_Badformat);
+    }
+
+    Ppm_reader reader = malloc(sizeof(struct Ppm_reader));
+    assert(reader);
+
+    reader->input = input;
+    reader->plain = (kind == '3');
+    reader->width = read_header_number(input);
+    reader->height = read_header_number(input);
+    reader->denominator = read_header_number(input);
+
+    if (reader->denominator == 0 || reader->denominator > 65535) {
+        free(reader);
+        RAISE(Pnm_Badformat);
+    }
+
+    reader->row_bytes = ppm_row_bytes(reader->width, reader->denominator);
+    reader->rows_read = 0;
+    reader->buffer = NULL;
+    reader->buffer_rows = 0;
+    reader->map = NULL;
+
+    if (!reader->plain) {
+        map_raster(reader);
+    }
+
+    return reader;
+}
+
+/* ppm_reader_free
+ * Purpose: Frees a reader, its buffer and its mapping. Does not
+ *          close the file.
+ * Parameters: A pointer to a Ppm_reader
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Ppm_reader
+ * Success output: The reader is freed and set to NULL. A mapped
+ *                  reader leaves the file just past the rows it read.
+ * Failure output: Raises a Checked Runtime Error if reader is NULL
+ */
+void ppm_reader_free(Ppm_reader *reader)
+{
+    assert(reader != NULL && *reader != NULL);
+    Ppm_reader r = *reader;
+
+    if (r->map != NULL) {
+        munmap(r->map, r->map_length);
+
+        /* Leave the stream just past the rows read, as fread would */
+        int moved = fseeko(r->input, r->raster_start
+                           + (off_t)r->rows_read * r->row_bytes, SEEK_SET);
+        assert(moved == 0);
+    }
+
+    free(r->buffer);
+    free(r);
+    *reader = NULL;
+}
+
+/* ppm_reader_width, ppm_reader_height, ppm_reader_denominator
+ * Purpose: Return the dimensions and denominator read from the header
+ * Parameters: A Ppm_reader
+ * Returns: An unsigned value
+ *
+ * Expected input: A valid Ppm_reader
+ * Success output: The value stored in the header of the ppm
+ * Failure output: Raises a Checked Runtime Error if reader is NULL
+ */
+unsigned ppm_reader_width(Ppm_reader reader)
+{
+    assert(reader != NULL);
+    return reader->width;
+}
+
+unsigned ppm_reader_height(Ppm_reader reader)
+{
+    assert(reader != NULL);
+    return reader->height;
+}
+
+unsigned ppm_reader_denominator(Ppm_reader reader)
+{
+    assert(reader != NULL);
+    return reader->denominator;
+}
+
+/* ppm_read_rows
+ * Purpose: Reads the next scanlines of the raster as packed samples.
+ *          A mapped raster is not copied at all; otherwise the rows
+ *          are read with a single fread.
+ * Parameters: A Ppm_reader and the number of scanlines to read
+ * Returns: A pointer to the scanlines, one after the other, each
+ *          ppm_row_bytes(width, denominator) bytes long. It stays
+ *          valid until the next call or until the reader is freed.
+ *
+ * Expected input: A valid reader with at least rows scanlines left
+ * Success output: The next rows scanlines of the image
+ * Failure output: Raises Pnm_Badformat if the raster is truncated or
+ *                  malformed, and a Checked Runtime Error if more rows
+ *                  are asked for than the image has left
+ */
+const unsigned char *ppm_read_rows(Ppm_reader reader, int rows)
+{
+    assert(reader != NULL);
+    assert(rows >= 0 && reader->rows_read + rows <= reader->height);
+
+    if (reader->map != NULL) {
+        const unsigned char *samples = reader->map + reader->map_skip
+                                + (size_t)reader->rows_read * reader->row_bytes;
+        reader->rows_read += rows;
+        return samples;
+    }
+
+    /* The buffer grows to the largest request and is then reused */
+    if (rows > reader->buffer_rows) {
+        free(reader->buffer);
+        reader->buffer = malloc((size_t)rows * reader->row_bytes);
+        assert(reader->buffer != NULL || reader->row_bytes == 0);
+        reader->buffer_rows = rows;
+    }
+
+    if (reader->plain) {
+        read_plain_rows(reader, reader->buffer, rows);
+    } else if (fread(reader->buffer, reader->row_bytes, rows, reader->input)
+                                              != (size_t)rows
+               && reader->row_bytes > 0) {
+        RAISE(Pnm_Badformat);
+    }
+
+    reader->rows_read += rows;
+    return reader->buffer;
+}
+
+/* ppm_writer_new
+ * Purpose: Writes the header of a raw ppm and returns a writer that
+ *          accepts the raster a few scanlines at a time
+ * Parameters: A file pointer, the width and height of the image, and
+ *             its denominator
+ * Returns: A Ppm_writer
+ *
+ * Expected input: A writable file and a denominator in [1, 65535]
+ * Success output: The P6 header is written to output
+ * Failure output: Raises a Checked Runtime Error if output is NULL or
+ *                  the denominator is out of range
+ */
+Ppm_writer ppm_writer_new(FILE *output, unsigned width, unsigned height,
+                          unsigned denominator)
+{
+    assert(output != NULL);
+    assert(denominator > 0 && denominator <= 65535);
+
+    Ppm_writer writer = malloc(sizeof(struct Ppm_writer));
+    assert(writer);
+
+    writer->output = output;
+    writer->row_bytes = ppm_row_bytes(width, denominator);
+
+    fprintf(output, "P6\n%u %u\n%u\n", width, height, denominator);
+
+    return writer;
+}
+
+/* ppm_writer_free
+ * Purpose: Frees a writer. Does not close the file.
+ * Parameters: A pointer to a Ppm_writer
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Ppm_writer
+ * Success output: The writer is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if writer is NULL
+ */
+void ppm_writer_free(Ppm_writer *writer)
+{
+    assert(writer != NULL && *writer != NULL);
+
+    free(*writer);
+    *writer = NULL;
+}
+
+/* ppm_write_rows
+ * Purpose: Writes the next scanlines of the raster with one fwrite
+ * Parameters: A Ppm_writer, packed samples for the scanlines, one
+ *             after the other, and the number of scanlines
+ * Returns: nothing
+ *
+ * Expected input: A valid writer and rows * ppm_row_bytes(width,
+ *                  denominator) bytes of samples no larger than the
+ *                  denominator
+ * Success output: The rows are written to the output in P6 format
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ *                  or the output cannot be written
+ */
+void ppm_write_rows(Ppm_writer writer, const unsigned char *samples,
+                    int rows)
+{
+    assert(writer != NULL);
+    assert(samples != NULL || rows == 0 || writer->row_bytes == 0);
+
+    if (rows == 0 || writer->row_bytes == 0) {
+        return;
+    }
+
+    size_t wrote = fwrite(samples, writer->row_bytes, rows, writer->output);
+    assert(wrote == (size_t)rows);
+}
+
+/* read_header_number
+ * Purpose: Helper function that reads one whitespace-separated decimal
+ *          number, skipping any '#' comments before it
+ * Parameters: A file pointer
+ * Returns: The number as an unsigned
+ *
+ * Expected input: A file positioned before a decimal number
+ * Success output: The number, with the single character that ended it
+ *                  consumed from the file
+ * Failure output: Raises Pnm_Badformat if no number is found
+ */
+unsigned read_header_number(FILE *input)
+{
+    int c = getc(input);
+
+    while (isspace(c) || c == '#') {
+        if (c == '#') {
+            while (c != '\n' && c != EOF) {
+                c = getc(input);
+            }
+        }
+        c = getc(input);
+    }
+
+    if (!isdigit(c)) {
+        RAISE(Pnm_Badformat);
+    }
+
+    unsigned value = 0;
+    while (isdigit(c)) {
+        value = value * 10 + (c - '0');
+        c = getc(input);
+    }
+
+    return value;
+}
+
+/* read_plain_rows
+ * Purpose: Helper function that reads scanlines of a P3 raster and
+ *          stores them as packed samples
+ * Parameters: A Ppm_reader, an array for the samples, and the number
+ *             of scanlines
+ * Returns: nothing
+ *
+ * Expected input: A reader of a P3 ppm and room for rows scanlines
+ * Success output: samples holds the rows in the same layout as P6
+ * Failure output: Raises Pnm_Badformat if a sample is missing
+ */
+void read_plain_rows(Ppm_reader reader, unsigned char *samples, int rows)
+{
+    size_t count = (size_t)rows * reader->width * 3;
+
+    if (reader->denominator > 255) {
+        for (size_t i = 0; i < count; i++, samples += 2) {
+            unsigned value = read_header_number(reader->input);
+            samples[0] = value >> 8;
+            samples[1] = value;
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            samples[i] = read_header_number(reader->input);
+        }
+    }
+}
+
+/* map_raster
+ * Purpose: Helper function that maps the raster of a reader's P6
+ *          input read-only, with a hint that it will be read front
+ *          to back
+ * Parameters: A Ppm_reader
+ * Returns: true if the raster was mapped, false if the input cannot
+ *          be mapped and the reader should use fread instead
+ *
+ * Expected input: A reader whose input has just had its header read
+ * Success output: map, map_length, map_skip and raster_start are set
+ * Failure output: none
+ */
+bool map_raster(Ppm_reader reader)
+{
+    struct stat info;
+    int fd = fileno(reader->input);
+
+    /* ftello counts the bytes stdio has buffered but not handed out */
+    off_t start = ftello(reader->input);
+    if (start < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+
+    /* A short raster is left to fread, which raises Pnm_Badformat */
+    off_t raster_end = start + (off_t)reader->height * reader->row_bytes;
+    if (raster_end == start || info.st_size < raster_end) {
+        return false;
+    }
+
+    /* mmap offsets must fall on a page boundary */
+    off_t page = sysconf(_SC_PAGESIZE);
+    off_t base = start - start % page;
+    size_t length = raster_end - base;
+
+    void *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, base);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    madvise(map, length, MADV_SEQUENTIAL);
+
+    reader->map = map;
+    reader->map_length = length;
+    reader->map_skip = start - base;
+    reader->raster_start = start;
+    return true;
+}
@@ -0,0 +1,163 @@
+/**************************************************************
+ *
+ *                     ppmstream.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     This file is the interface of our ppmstream class. A
+ *     Ppm_reader parses the header of a plain (P3) or raw (P6)
+ *     ppm and then hands the raster back a few scanlines at a
+ *     time, and a Ppm_writer does the reverse for raw (P6)
+ *     output, so callers never need to hold the whole image in
+ *     memory.
+ *
+ *     Scanlines are passed around as packed samples, laid out
+ *     just as a P6 raster stores them: red, green and blue for
+ *     each pixel in turn, one byte per sample, or two bytes
+ *     (most significant first) once the denominator passes 255.
+ *     This is the only pixel layout the codec uses, so a pixel
+ *     takes 3 bytes (6 for deep images) everywhere.
+ *     A raw ppm in a regular file is mapped, so its scanlines are
+ *     handed out straight from the mapping without being copied.
+ *
+ **************************************************************/
+#ifndef PPMSTREAM_INCLUDED
+#define PPMSTREAM_INCLUDED
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <except.h>
+#include <pnm.h>
+
+typedef struct Ppm_reader *Ppm_reader;
+typedef struct Ppm_writer *Ppm_writer;
+
+/* ppm_pixel_bytes
+ * Purpose: Returns the number of bytes in one pixel of packed samples
+ * Parameters: The denominator of the image
+ * Returns: The size of a pixel in bytes
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: 3, or 6 if the denominator is larger than 255
+ * Failure output: none
+ */
+size_t ppm_pixel_bytes(unsigned denominator);
+
+/* ppm_row_bytes
+ * Purpose: Returns the number of bytes in one packed scanline
+ * Parameters: The width of the image and its denominator
+ * Returns: The size of a scanline in bytes
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: 3 bytes per pixel, or 6 if the denominator is
+ *                  larger than 255
+ * Failure output: none
+ */
+size_t ppm_row_bytes(unsigned width, unsigned denominator);
+
+/* ppm_reader_new
+ * Purpose: Reads the header of a ppm and returns a reader positioned
+ *          at the first scanline of the raster. If the input is a
+ *          raw ppm in a regular file holding the whole raster, the
+ *          raster is mapped read-only.
+ * Parameters: A file pointer
+ * Returns: A Ppm_reader
+ *
+ * Expected input: A file containing a valid P3 or P6 ppm
+ * Success output: A reader whose width, height and denominator match
+ *                  the header of the ppm
+ * Failure output: Raises Pnm_Badformat if the header is malformed and
+ *                  a Checked Runtime Error if input is NULL
+ */
+Ppm_reader ppm_reader_new(FILE *input);
+
+/* ppm_reader_free
+ * Purpose: Frees a reader, its buffer and its mapping. Does not
+ *          close the file.
+ * Parameters: A pointer to a Ppm_reader
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Ppm_reader
+ * Success output: The reader is freed and set to NULL. A mapped
+ *                  reader leaves the file just past the rows it read.
+ * Failure output: Raises a Checked Runtime Error if reader is NULL
+ */
+void ppm_reader_free(Ppm_reader *reader);
+
+/* ppm_reader_width, ppm_reader_height, ppm_reader_denominator
+ * Purpose: Return the dimensions and denominator read from the header
+ * Parameters: A Ppm_reader
+ * Returns: An unsigned value
+ *
+ * Expected input: A valid Ppm_reader
+ * Success output: The value stored in the header of the ppm
+ * Failure output: Raises a Checked Runtime Error if reader is NULL
+ */
+unsigned ppm_reader_width(Ppm_reader reader);
+unsigned ppm_reader_height(Ppm_reader reader);
+unsigned ppm_reader_denominator(Ppm_reader reader);
+
+/* ppm_read_rows
+ * Purpose: Reads the next scanlines of the raster as packed samples.
+ *          A mapped raster is not copied at all; otherwise the rows
+ *          are read with a single fread.
+ * Parameters: A Ppm_reader and the number of scanlines to read
+ * Returns: A pointer to the scanlines, one after the other, each
+ *          ppm_row_bytes(width, denominator) bytes long. It stays
+ *          valid until the next call or until the reader is freed.
+ *
+ * Expected input: A valid reader with at least rows scanlines left
+ * Success output: The next rows scanlines of the image
+ * Failure output: Raises Pnm_Badformat if the raster is truncated or
+ *                  malformed, and a Checked Runtime Error if more rows
+ *                  are asked for than the image has left
+ */
+const unsigned char *ppm_read_rows(Ppm_reader reader, int rows);
+
+/* ppm_writer_new
+ * Purpose: Writes the header of a raw ppm and returns a writer that
+ *          accepts the raster a few scanlines at a time
+ * Parameters: A file pointer, the width and height of the image, and
+ *             its denominator
+ * Returns: A Ppm_writer
+ *
+ * Expected input: A writable file and a denominator in [1, 65535]
+ * Success output: The P6 header is written to output
+ * Failure output: Raises a Checked Runtime Error if output is NULL or
+ *                  the denominator is out of range
+ */
+Ppm_writer ppm_writer_new(FILE *output, unsigned width, unsigned height,
+                          unsigned denominator);
+
+/* ppm_writer_free
+ * Purpose: Frees a writer. Does not close the file.
+ * Parameters: A pointer to a Ppm_writer
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Ppm_writer
+ * Success output: The writer is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if writer is NULL
+ */
+void ppm_writer_free(Ppm_writer *writer);
+
+/* ppm_write_rows
+ * Purpose: Writes the next scanlines of the raster with one fwrite
+ * Parameters: A Ppm_writer, packed samples for the scanlines, one
+ *             after the other, and the number of scanlines
+ * Returns: nothing
+ *
+ * Expected input: A valid writer and rows * ppm_row_bytes(width,
+ *                  denominator) bytes of samples no larger than the
+ *                  denominator
+ * Success output: The rows are written to the output in P6 format
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ *                  or the output cannot be written
+ */
+void ppm_write_rows(Ppm_writer writer, const unsigned char *samples,
+                    int rows);
+
+#endif
@@ -7,93 +7,114 @@
  *     Date:     Oct 28, 2021
  *
  *     Summary
- *     Implementation of the quantize class.
+ *     Implementation of the quantize class. The table of chroma
+ *     values is the one libarith40 uses, and indices are found with
+ *     a binary search over precomputed thresholds rather than a call
+ *     into the library for every block.
  *     
  **************************************************************/
 #include "quantize.h"
 
-/* pb_pr_quantize
- * Purpose: Quantize the Pb and Pr component video colorspace components
- *          in a 2-by-2 block of pixels in an image, storing the
- *          quantized values (which are indices in an internal table)
- *          in a Codeword provided by the user
- * Parameters: a 1D array that holds the block of pixels and a Codeword
- *             where the quantized Pb and Pr components will be stored
+/* The 16 chroma values an index can stand for, in increasing order */
+static const float chroma_of_index[16] = {
+    -0.35, -0.20, -0.15, -0.10, -0.077, -0.055, -0.033, -0.011,
+     0.011,  0.033,  0.055,  0.077,  0.10,  0.15,  0.20,  0.35
+};
+
+/* chroma_threshold[n] is the smallest chroma that is strictly nearer
+ * chroma_of_index[n + 1] than chroma_of_index[n], with the distances
+ * taken in single precision and ties going to the lower index. Most
+ * sit a rounding step off the midpoint of the two values; the one
+ * between -0.011 and 0.011 is the first float whose distance to 0.011
+ * no longer rounds to the same value as its distance to -0.011. */
+static const float chroma_threshold[15] = {
+    -0.274999976f, -0.174999997f, -0.125f,        -0.0884999931f,
+    -0.0659999922f, -0.043999996f, -0.021999998f,  4.65661343e-10f,
+     0.0220000017f,  0.0440000035f,  0.0660000071f,  0.088500008f,
+     0.125000015f,   0.175000012f,   0.275000006f
+};
+
+static inline unsigned index_of_chroma(float chroma);
+
+/* quantize_chroma
+ * Purpose: Quantize one chroma component (Pb or Pr) of a row of 2-by-2
+ *          blocks of pixels, storing the quantized values (which are
+ *          indices in an internal table) in an array provided by the user
+ * Parameters: a row of a chroma plane holding the average value of each
+ *             block (see colorspace.h), the number of blocks in the row,
+ *             and an array for the indices
  * Returns: void
- *    Note: the 1D block_array stores a block of pixels in the following
- *          order: (top-left, top-right, bottom-left, bottom-right)
  *
- * Expected input: a valid 1D block array (with initialized Pb and Pr
- *                 values) and a valid Codeword to store quantized values
- * Success output: the quantized values will be stored in the Codeword
- * Failure output: if any of the parameters are invalid, a Checked Runtime
+ * Expected input: a row of at least blocks averages and an array of at
+ *                 least blocks indices
+ * Success output: index[i] holds the quantized average of block i
+ * Failure output: if any of the pointers are NULL, a Checked Runtime
  *                 Error is thrown
  */
-void pb_pr_quantize(UArray_T block_array, Codeword cw)
+void quantize_chroma(const float *avg, int blocks, uint32_t *index)
 {
-    assert(block_array != NULL);
-    assert(cw != NULL);
-    assert(UArray_length(block_array) == 4);
-    float pb_add = 0;
-    float pr_add = 0;
+    assert(blocks == 0 || (avg != NULL && index != NULL));
 
-    /* Calculate Pb and Pr averages */
-    for (int i = 0; i < UArray_length(block_array); i++) {
-        pb_add += get_pb_value(UArray_at(block_array, i));
-        pr_add += get_pr_value(UArray_at(block_array, i));
-    }
-    
-    float pb_avg = pb_add / 4.0; 
-    float pr_avg = pr_add / 4.0;
+    for (int i = 0; i < blocks; i++) {
+        float value = avg[i];
 
-    /* Force the Pb and Pr averages into the range [-0.5, 0.5] */
-    if (pb_avg > 0.5) {
-        pb_avg = 0.5;
-    } else if (pb_avg < -0.5) {
-        pb_avg = -0.5;
-    }
+        /* Force the average into the range [-0.5, 0.5] */
+        if (value > 0.5) {
+            value = 0.5;
+        } else if (value < -0.5) {
+            value = -0.5;
+        }
 
-    if (pr_avg > 0.5) {
-        pr_avg = 0.5;
-    } else if (pr_avg < -0.5) {
-        pr_avg = -0.5;
+        index[i] = index_of_chroma(value);
     }
-
-    uint32_t pb_index = Arith40_index_of_chroma(pb_avg);
-    uint32_t pr_index = Arith40_index_of_chroma(pr_avg);
-
-    set_pb_index(cw, pb_index);
-    set_pr_index(cw, pr_index);
 }
 
-/* pb_pr_reverse_quantize
- * Purpose: Convert the quantized Pb and Pr values held in a
- *          user-provided Codeword from indices in an internal table
- *          to actual Pb and Pr color components, storing their values
- *          in a 2-by-2 block of pixels
- * Parameters: a Codeword where the quantized Pb and Pr components are
- *             held and a 1D array to store the converted block of pixels
+/* reverse_quantize_chroma
+ * Purpose: Convert the quantized values of one chroma component of a
+ *          row of 2-by-2 blocks from indices in an internal table to
+ *          actual values, one per block
+ * Parameters: an array of indices, the number of blocks, and a row of a
+ *             chroma plane to fill in
  * Returns: void
- *    Note: the 1D block_array stores a block of pixels in the following
- *          order: (top-left, top-right, bottom-left, bottom-right)
  *
- * Expected input: a valid Codeword holding quantized Pb and Pr values
- *                 and a valid 1D block array to store converted values
- * Success output: the converted values will be stored in the block array
- * Failure output: if any of the parameters are invalid, a Checked Runtime
+ * Expected input: an array of at least blocks indices and a row of at
+ *                 least blocks values
+ * Success output: value[i] holds the chroma of index[i]
+ * Failure output: if any of the pointers are NULL, a Checked Runtime
  *                 Error is thrown
  */
-void pb_pr_reverse_quantize(Codeword cw, UArray_T block_array)
+void reverse_quantize_chroma(const uint32_t *index, int blocks,
+                             float *value)
 {
-    assert(block_array != NULL);
-    assert(cw != NULL);
-    assert(UArray_length(block_array) == 4);
+    assert(blocks == 0 || (index != NULL && value != NULL));
 
-    float pb = Arith40_chroma_of_index(get_pb_index(cw));
-    float pr = Arith40_chroma_of_index(get_pr_index(cw));
+    for (int i = 0; i < blocks; i++) {
+        assert(index[i] < 16);
+        value[i] = chroma_of_index[index[i]];
+    }
+}
 
-    for (int i = 0; i < UArray_length(block_array); i++) {
-        set_pb_value(UArray_at(block_array, i), pb);
-        set_pr_value(UArray_at(block_array, i), pr);
+/* index_of_chroma
+ * Purpose: Finds the index of the table entry nearest a chroma value,
+ *          as Arith40_index_of_chroma does, with a four-step binary
+ *          search over the thresholds between neighbouring entries
+ * Parameters: a chroma value
+ * Returns: an index in [0, 15]
+ *
+ * Expected input: a chroma value in [-0.5, 0.5]
+ * Success output: the number of thresholds at or below chroma, which is
+ *                 the index of the nearest entry
+ * Failure output: none
+ */
+static inline unsigned index_of_chroma(float chroma)
+{
+    unsigned index = 0;
+
+    for (unsigned step = 8; step > 0; step /= 2) {
+        if (chroma >= chroma_threshold[index + step - 1]) {
+            index += step;
+        }
     }
-}
\ No newline at end of file
+
+    return index;
+}
@@ -7,12 +7,15 @@
  *     Date:     Oct 28, 2021
  *
  *     Summary
- *     This class contains two quantization functions – pb_pr_quantize and
- *     pb_pr_reverse_quantize. The pb_pr_quantize function allows the user
- *     to quantize the chroma components of a block of pixels in the
- *     component video colorspace into indices in an internal table, while
- *     the pb_pr_reverse_quantize function effectively performs the reverse
- *     operation, converting quantized Pb and Pr values into actual values.
+ *     This class contains two quantization functions – quantize_chroma
+ *     and reverse_quantize_chroma. The quantize_chroma function allows
+ *     the user to quantize one chroma component of a row of 2-by-2
+ *     blocks of pixels in the component video colorspace into indices
+ *     in a table of 16 values, while reverse_quantize_chroma effectively
+ *     performs the reverse operation, converting quantized values into
+ *     actual values. Both work on a row of a chroma plane, which holds
+ *     one average per block (see colorspace.h), so Pb and Pr are each
+ *     one call.
  *     
  **************************************************************/
 #ifndef QUANTIZE_INCLUDED
@@ -23,51 +26,39 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <assert.h>
-#include <a2methods.h>
-#include <a2plain.h>
-#include <uarray.h>
-#include <pnm.h>
-#include <arith40.h>
 
-#include "codeword.h"
-#include "colorspace.h"
-
-/* pb_pr_quantize
- * Purpose: Quantize the Pb and Pr component video colorspace components
- *          in a 2-by-2 block of pixels in an image, storing the
- *          quantized values (which are indices in an internal table)
- *          in a Codeword provided by the user
- * Parameters: a 1D array that holds the block of pixels and a Codeword
- *             where the quantized Pb and Pr components will be stored
+/* quantize_chroma
+ * Purpose: Quantize one chroma component (Pb or Pr) of a row of 2-by-2
+ *          blocks of pixels, storing the quantized values (which are
+ *          indices in an internal table) in an array provided by the user
+ * Parameters: a row of a chroma plane holding the average value of each
+ *             block (see colorspace.h), the number of blocks in the row,
+ *             and an array for the indices
  * Returns: void
- *    Note: the 1D block_array stores a block of pixels in the following
- *          order: (top-left, top-right, bottom-left, bottom-right)
  *
- * Expected input: a valid 1D block array (with initialized Pb and Pr
- *                 values) and a valid Codeword to store quantized values
- * Success output: the quantized values will be stored in the Codeword
- * Failure output: if any of the parameters are invalid, a Checked Runtime
+ * Expected input: a row of at least blocks averages and an array of at
+ *                 least blocks indices
+ * Success output: index[i] holds the quantized average of block i
+ * Failure output: if any of the pointers are NULL, a Checked Runtime
  *                 Error is thrown
  */
-void pb_pr_quantize(UArray_T block_array, Codeword cw);
+void quantize_chroma(const float *avg, int blocks, uint32_t *index);
 
-/* pb_pr_reverse_quantize
- * Purpose: Convert the quantized Pb and Pr values held in a
- *          user-provided Codeword from indices in an internal table
- *          to actual Pb and Pr color components, storing their values
- *          in a 2-by-2 block of pixels
- * Parameters: a Codeword where the quantized Pb and Pr components are
- *             held and a 1D array to store the converted block of pixels
+/* reverse_quantize_chroma
+ * Purpose: Convert the quantized values of one chroma component of a
+ *          row of 2-by-2 blocks from indices in an internal table to
+ *          actual values, one per block
+ * Parameters: an array of indices, the number of blocks, and a row of a
+ *             chroma plane to fill in
  * Returns: void
- *    Note: the 1D block_array stores a block of pixels in the following
- *          order: (top-left, top-right, bottom-left, bottom-right)
  *
- * Expected input: a valid Codeword holding quantized Pb and Pr values
- *                 and a valid 1D block array to store converted values
- * Success output: the converted values will be stored in the block array
- * Failure output: if any of the parameters are invalid, a Checked Runtime
+ * Expected input: an array of at least blocks indices and a row of at
+ *                 least blocks values
+ * Success output: value[i] holds the chroma of index[i]
+ * Failure output: if any of the pointers are NULL, a Checked Runtime
  *                 Error is thrown
  */
-void pb_pr_reverse_quantize(Codeword cw, UArray_T block_array);
+void reverse_quantize_chroma(const uint32_t *index, int blocks,
+                             float *value);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+/**************************************************************
+ *
+ *                     simd.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Shared switches for the vector kernels. On x86 the AVX2
+ *     kernels are always compiled (each is marked with the avx2
+ *     target attribute) and cpu_has_avx2 picks them at run time;
+ *     everywhere else only the scalar kernels exist.
+ *
+ **************************************************************/
+#ifndef SIMD_INCLUDED
+#define SIMD_INCLUDED
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#define AVX2_KERNEL __attribute__((target("avx2")))
+#define cpu_has_avx2() __builtin_cpu_supports("avx2")
+#endif
+
+#endif
@@ -0,0 +1,263 @@
+/**************************************************************
+ *
+ *                     alloc_test.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Checks that compression and decompression make no heap
+ *     allocations once they are set up. malloc, calloc, realloc and
+ *     posix_memalign are replaced here with versions that count
+ *     their calls and hand on to the C library. Each codec is run on
+ *     a short and a tall image of the same width: setup and teardown
+ *     (readers, writers, bands, threads, arrays) are the same for
+ *     both, so any difference in the counts comes from the rows in
+ *     between. Each run is made once with the input in a temporary
+ *     file, which the readers map, and once with it coming down a
+ *     pipe, which they fread into their buffers. The test fails if
+ *     the counts differ.
+ *
+ **************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <compress40.h>
+
+#include "codec40.h"
+
+/* The width of both images and the heights of the short and tall one */
+#define WIDTH 90
+#define SHORT_HEIGHT 16
+#define TALL_HEIGHT 250
+
+void *__libc_malloc(size_t bytes);
+void *__libc_calloc(size_t count, size_t bytes);
+void *__libc_realloc(void *block, size_t bytes);
+void *__libc_memalign(size_t alignment, size_t bytes);
+
+static volatile bool counting = false;
+static long allocations = 0;
+
+FILE *make_image(int height);
+FILE *pipe_from(FILE *file, pid_t *writer);
+long count_allocations(void codec(FILE *input), FILE *input, bool piped,
+                       FILE *output);
+bool same_count(const char *name, void codec(FILE *input), FILE *short_in,
+                FILE *tall_in, bool piped);
+
+void *malloc(size_t bytes)
+{
+    if (counting) {
+        __sync_fetch_and_add(&allocations, 1);
+    }
+    return __libc_malloc(bytes);
+}
+
+void *calloc(size_t count, size_t bytes)
+{
+    if (counting) {
+        __sync_fetch_and_add(&allocations, 1);
+    }
+    return __libc_calloc(count, bytes);
+}
+
+void *realloc(void *block, size_t bytes)
+{
+    if (counting) {
+        __sync_fetch_and_add(&allocations, 1);
+    }
+    return __libc_realloc(block, bytes);
+}
+
+int posix_memalign(void **block, size_t alignment, size_t bytes)
+{
+    if (counting) {
+        __sync_fetch_and_add(&allocations, 1);
+    }
+    *block = __libc_memalign(alignment, bytes);
+    return *block == NULL ? 12 : 0;     /* ENOMEM */
+}
+
+int main(void)
+{
+    FILE *short_ppm = make_image(SHORT_HEIGHT);
+    FILE *tall_ppm = make_image(TALL_HEIGHT);
+    FILE *short_c40 = tmpfile();
+    FILE *tall_c40 = tmpfile();
+    bool passed = true;
+
+    /* The compressed images the decompressors read */
+    count_allocations(compress40, short_ppm, false, short_c40);
+    count_allocations(compress40, tall_ppm, false, tall_c40);
+
+    for (int piped = 0; piped <= 1; piped++) {
+        printf("input %s\n", piped ? "through a pipe" : "in a file");
+        for (int threads = 1; threads <= 3; threads += 2) {
+            set_codec_threads(threads);
+            printf(" %d thread(s)\n", threads);
+            passed &= same_count("compress40", compress40, short_ppm,
+                                 tall_ppm, piped);
+            passed &= same_count("decompress40", decompress40, short_c40,
+                                 tall_c40, piped);
+        }
+        passed &= same_count("compress40_staged", compress40_staged,
+                             short_ppm, tall_ppm, piped);
+        passed &= same_count("decompress40_staged", decompress40_staged,
+                             short_c40, tall_c40, piped);
+    }
+
+    printf("alloc_test: %s\n", passed ? "passed" : "failed");
+    return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* make_image
+ * Purpose: Writes a raw ppm of pseudo-random pixels to a temporary file
+ * Parameters: The height of the image
+ * Returns: The file, open for reading and writing
+ *
+ * Expected input: A positive height
+ * Success output: A WIDTH by height ppm with a denominator of 255
+ * Failure output: Exits if the file cannot be made
+ */
+FILE *make_image(int height)
+{
+    FILE *ppm = tmpfile();
+    if (ppm == NULL) {
+        perror("tmpfile");
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(ppm, "P6\n%d %d\n255\n", WIDTH, height);
+    unsigned seed = 40;
+    for (int sample = 0; sample < 3 * WIDTH * height; sample++) {
+        seed = seed * 1103515245 + 12345;
+        putc(seed >> 16 & 255, ppm);
+    }
+    fflush(ppm);
+    return ppm;
+}
+
+/* pipe_from
+ * Purpose: Starts a child process that writes the whole of a file down
+ *          a pipe, so a reader sees a stream it cannot map or seek
+ * Parameters: The file and where to put the child's process id
+ * Returns: The read end of the pipe
+ *
+ * Expected input: A file open for reading
+ * Success output: *writer is the child, which exits once it has
+ *                  written the file or the read end is closed
+ * Failure output: Exits if the pipe or the child cannot be made
+ */
+FILE *pipe_from(FILE *file, pid_t *writer)
+{
+    int ends[2];
+    if (pipe(ends) != 0) {
+        perror("pipe");
+        exit(EXIT_FAILURE);
+    }
+    fflush(stdout);
+    *writer = fork();
+    if (*writer < 0) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+    if (*writer == 0) {
+        close(ends[0]);
+        char chunk[4096];
+        off_t offset = 0;
+        ssize_t got;
+        while ((got = pread(fileno(file), chunk, sizeof(chunk), offset))
+                                                                     > 0) {
+            if (write(ends[1], chunk, got) != got) {
+                _exit(EXIT_FAILURE);
+            }
+            offset += got;
+        }
+        _exit(EXIT_SUCCESS);
+    }
+
+    close(ends[1]);
+    FILE *input = fdopen(ends[0], "rb");
+    if (input == NULL) {
+        perror("fdopen");
+        exit(EXIT_FAILURE);
+    }
+    return input;
+}
+
+/* count_allocations
+ * Purpose: Runs a codec with its output going to a file and counts
+ *          the heap allocations it makes
+ * Parameters: A codec (compress40 or one of its kin), its input,
+ *             whether to hand the input to the codec through a pipe,
+ *             and a file for its output
+ * Returns: The number of allocations
+ *
+ * Expected input: Files open for reading and writing
+ * Success output: output holds exactly what the codec wrote
+ * Failure output: Exits if output cannot be emptied or the pipe made
+ */
+long count_allocations(void codec(FILE *input), FILE *input, bool piped,
+                       FILE *output)
+{
+    rewind(input);
+    pid_t writer = 0;
+    FILE *source = piped ? pipe_from(input, &writer) : input;
+
+    fflush(stdout);
+    if (ftruncate(fileno(output), 0) != 0) {
+        perror("ftruncate");
+        exit(EXIT_FAILURE);
+    }
+    int saved = dup(STDOUT_FILENO);
+    dup2(fileno(output), STDOUT_FILENO);
+    lseek(STDOUT_FILENO, 0, SEEK_SET);
+
+    allocations = 0;
+    counting = true;
+    codec(source);
+    fflush(stdout);
+    counting = false;
+
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    if (piped) {
+        fclose(source);
+        waitpid(writer, NULL, 0);
+    }
+    return allocations;
+}
+
+/* same_count
+ * Purpose: Checks that a codec makes as many allocations for the tall
+ *          image as for the short one, so none in its steady state
+ * Parameters: The codec's name, the codec, its short and tall input,
+ *             and whether to feed the input through a pipe
+ * Returns: true if the counts match
+ *
+ * Expected input: Inputs of the same width
+ * Success output: Prints both counts
+ * Failure output: Prints both counts and says they differ
+ */
+bool same_count(const char *name, void codec(FILE *input), FILE *short_in,
+                FILE *tall_in, bool piped)
+{
+    FILE *output = tmpfile();
+
+    /* A first run warms up stdio and grows the staged path's arena to
+     * fit the taller image */
+    count_allocations(codec, tall_in, piped, output);
+
+    long short_count = count_allocations(codec, short_in, piped, output);
+    long tall_count = count_allocations(codec, tall_in, piped, output);
+    fclose(output);
+
+    printf("   %-20s %ld allocations for %d rows, %ld for %d rows%s\n",
+           name, short_count, SHORT_HEIGHT, tall_count, TALL_HEIGHT,
+           short_count == tall_count ? "" : " -- DIFFERENT");
+    return short_count == tall_count;
+}
@@ -0,0 +1,207 @@
+/**************************************************************
+ *
+ *                     bitpack_test.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Checks the row versions of the Bitpack functions
+ *     (bitpackrows.h) against the scalar ones in bitpack.h. Random
+ *     words, fields and values are run through both, over every
+ *     width and lsb, with rows long enough that the AVX2 kernels
+ *     and their scalar tails both run. It also checks that
+ *     Bitpack_news leaves the fields next to the one it sets alone
+ *     when the value is negative. Prints each mismatch and exits
+ *     with failure if there are any.
+ *
+ **************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <bitpack.h>
+
+#include "bitpackrows.h"
+
+/* Words per row: not a multiple of the vector width, so tails run */
+#define COUNT 37
+/* Random rows tried */
+#define TRIALS 20000
+
+static int failures = 0;
+
+uint64_t random_word(void);
+void check(bool same, const char *function, unsigned width, unsigned lsb);
+void check_rows(unsigned width, unsigned lsb);
+void check_news_neighbours(unsigned width, unsigned lsb);
+
+int main(void)
+{
+    srand(40);
+
+    for (unsigned width = 1; width < 64; width++) {
+        for (unsigned lsb = 0; lsb + width <= 64; lsb++) {
+            check_news_neighbours(width, lsb);
+        }
+    }
+
+    for (int trial = 0; trial < TRIALS; trial++) {
+        unsigned width = rand() % 65;
+        unsigned lsb = width == 64 ? 0 : rand() % (65 - width);
+        check_rows(width, lsb);
+    }
+
+    if (failures > 0) {
+        printf("bitpack_test: %d mismatches\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("bitpack_test: passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* random_word
+ * Purpose: Makes a pseudo-random 64-bit word
+ * Parameters: none
+ * Returns: A uint64_t
+ *
+ * Expected input: none
+ * Success output: A word with every bit random
+ * Failure output: none
+ */
+uint64_t random_word(void)
+{
+    return (uint64_t)rand() << 62 ^ (uint64_t)rand() << 42
+           ^ (uint64_t)rand() << 21 ^ (uint64_t)rand();
+}
+
+/* check
+ * Purpose: Counts and prints a mismatch between a row function and
+ *          its scalar namesake
+ * Parameters: Whether they agreed, the row function's name, and the
+ *             width and lsb it was given
+ * Returns: nothing
+ *
+ * Expected input: none
+ * Success output: none
+ * Failure output: Prints the function, width and lsb when same is false
+ */
+void check(bool same, const char *function, unsigned width, unsigned lsb)
+{
+    if (!same) {
+        printf("%s differs at width %u, lsb %u\n", function, width, lsb);
+        failures++;
+    }
+}
+
+/* check_rows
+ * Purpose: Runs one random row through every row function and the
+ *          matching scalar function
+ * Parameters: The width and lsb of the field
+ * Returns: nothing
+ *
+ * Expected input: A width and lsb whose sum is at most 64
+ * Success output: none
+ * Failure output: Reports each function whose row and scalar results
+ *                  differ
+ */
+void check_rows(unsigned width, unsigned lsb)
+{
+    uint64_t words[COUNT], values_u[COUNT], scratch[COUNT];
+    int64_t values_s[COUNT];
+    bool same;
+
+    for (int i = 0; i < COUNT; i++) {
+        words[i] = random_word();
+    }
+
+    /* getu and gets: the values they find also fit the field below */
+    Bitpack_getu_row(words, COUNT, width, lsb, values_u);
+    Bitpack_gets_row(words, COUNT, width, lsb, values_s);
+    same = true;
+    for (int i = 0; i < COUNT; i++) {
+        same &= values_u[i] == Bitpack_getu(words[i], width, lsb);
+    }
+    check(same, "Bitpack_getu_row", width, lsb);
+    same = true;
+    for (int i = 0; i < COUNT; i++) {
+        same &= values_s[i] == Bitpack_gets(words[i], width, lsb);
+    }
+    check(same, "Bitpack_gets_row", width, lsb);
+
+    if (width == 0) {
+        return;
+    }
+    check(Bitpack_fitsu_row(values_u, COUNT, width), "Bitpack_fitsu_row",
+          width, lsb);
+    check(Bitpack_fitss_row(values_s, COUNT, width), "Bitpack_fitss_row",
+          width, lsb);
+
+    /* newu and news put the values into a fresh row of words */
+    for (int i = 0; i < COUNT; i++) {
+        words[i] = random_word();
+        scratch[i] = words[i];
+    }
+    Bitpack_newu_row(scratch, COUNT, width, lsb, values_u);
+    same = true;
+    for (int i = 0; i < COUNT; i++) {
+        same &= scratch[i] == Bitpack_newu(words[i], width, lsb,
+                                           values_u[i]);
+    }
+    check(same, "Bitpack_newu_row", width, lsb);
+
+    for (int i = 0; i < COUNT; i++) {
+        scratch[i] = words[i];
+    }
+    Bitpack_news_row(scratch, COUNT, width, lsb, values_s);
+    same = true;
+    for (int i = 0; i < COUNT; i++) {
+        same &= scratch[i] == Bitpack_news(words[i], width, lsb,
+                                           values_s[i]);
+    }
+    check(same, "Bitpack_news_row", width, lsb);
+
+    /* fitsu and fitss of values that may or may not fit */
+    bool fit_u = true, fit_s = true;
+    for (int i = 0; i < COUNT; i++) {
+        values_u[i] = random_word() >> rand() % 64;
+        values_s[i] = (int64_t)random_word() >> rand() % 64;
+        fit_u &= Bitpack_fitsu(values_u[i], width);
+        fit_s &= Bitpack_fitss(values_s[i], width);
+    }
+    check(fit_u == Bitpack_fitsu_row(values_u, COUNT, width),
+          "Bitpack_fitsu_row", width, lsb);
+    check(fit_s == Bitpack_fitss_row(values_s, COUNT, width),
+          "Bitpack_fitss_row", width, lsb);
+}
+
+/* check_news_neighbours
+ * Purpose: Packs negative values with Bitpack_news into a word whose
+ *          other bits are all set, then all clear, and checks that
+ *          only the field changed
+ * Parameters: The width and lsb of the field
+ * Returns: nothing
+ *
+ * Expected input: A width in [1, 63] and an lsb with width + lsb <= 64
+ * Success output: none
+ * Failure output: Reports a mismatch if a bit outside the field changed
+ *                  or the field does not read back as the value
+ */
+void check_news_neighbours(unsigned width, unsigned lsb)
+{
+    uint64_t field = ((uint64_t)1 << width) - 1;
+    int64_t lowest = -((int64_t)1 << (width - 1));
+    int64_t values[] = { -1, lowest };
+    uint64_t neighbours[] = { ~(field << lsb), 0 };
+
+    for (int v = 0; v < 2; v++) {
+        for (int n = 0; n < 2; n++) {
+            uint64_t word = Bitpack_news(neighbours[n], width, lsb,
+                                         values[v]);
+            check((word & ~(field << lsb)) == neighbours[n]
+                  && Bitpack_gets(word, width, lsb) == values[v],
+                  "Bitpack_news", width, lsb);
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/**************************************************************
+ *
+ *                     chroma_test.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Checks the quantize class's chroma table against libarith40.
+ *     reverse_quantize_chroma must give Arith40_chroma_of_index for
+ *     all 16 indices, and quantize_chroma must give
+ *     Arith40_index_of_chroma for the float just below, at and just
+ *     above every boundary between two indices, as the library
+ *     draws them, and for an even sweep of [-0.5, 0.5]. Prints each
+ *     mismatch and exits with failure if there are any.
+ *
+ **************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <arith40.h>
+
+#include "quantize.h"
+
+/* Floats in [-0.5, 0.5] tried by the sweep */
+#define SWEEP_STEPS 1000000
+
+static int failures = 0;
+
+int32_t order_of_float(float x);
+float float_of_order(int32_t order);
+float library_boundary(unsigned upper);
+void check_index(float chroma);
+
+int main(void)
+{
+    for (uint32_t n = 0; n < 16; n++) {
+        float value;
+        reverse_quantize_chroma(&n, 1, &value);
+        if (value != Arith40_chroma_of_index(n)) {
+            printf("chroma of index %u: %.9g, library %.9g\n", n,
+                   value, Arith40_chroma_of_index(n));
+            failures++;
+        }
+    }
+
+    for (unsigned upper = 1; upper < 16; upper++) {
+        float boundary = library_boundary(upper);
+        check_index(nextafterf(boundary, -1.0f));
+        check_index(boundary);
+        check_index(nextafterf(boundary, 1.0f));
+    }
+
+    for (int step = 0; step <= SWEEP_STEPS; step++) {
+        check_index(-0.5f + (float)step / SWEEP_STEPS);
+    }
+
+    if (failures > 0) {
+        printf("chroma_test: %d mismatches\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("chroma_test: passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* order_of_float
+ * Purpose: Maps a float to an integer that orders floats as < does,
+ *          with neighbouring floats one apart
+ * Parameters: A finite float
+ * Returns: An int32_t
+ *
+ * Expected input: A finite float other than -0
+ * Success output: The float's place in order
+ * Failure output: none
+ */
+int32_t order_of_float(float x)
+{
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits < 0 ? INT32_MIN - bits : bits;
+}
+
+/* float_of_order
+ * Purpose: The inverse of order_of_float
+ * Parameters: An int32_t
+ * Returns: A float
+ *
+ * Expected input: A value order_of_float returns
+ * Success output: The float in that place
+ * Failure output: none
+ */
+float float_of_order(int32_t order)
+{
+    int32_t bits = order < 0 ? INT32_MIN - order : order;
+    float x;
+    memcpy(&x, &bits, sizeof(x));
+    return x;
+}
+
+/* library_boundary
+ * Purpose: Finds where libarith40 starts giving an index of at least
+ *          upper, by bisecting the floats between two table entries
+ * Parameters: An index in [1, 15]
+ * Returns: A float
+ *
+ * Expected input: An index in [1, 15]
+ * Success output: The smallest float that Arith40_index_of_chroma
+ *                  maps to upper or above
+ * Failure output: none
+ */
+float library_boundary(unsigned upper)
+{
+    int32_t low = order_of_float(Arith40_chroma_of_index(upper - 1));
+    int32_t high = order_of_float(Arith40_chroma_of_index(upper));
+
+    while (high - low > 1) {
+        int32_t middle = low + (high - low) / 2;
+        if (Arith40_index_of_chroma(float_of_order(middle)) >= upper) {
+            high = middle;
+        } else {
+            low = middle;
+        }
+    }
+
+    return float_of_order(high);
+}
+
+/* check_index
+ * Purpose: Compares quantize_chroma with Arith40_index_of_chroma for
+ *          one chroma value, printing any mismatch
+ * Parameters: A chroma value
+ * Returns: nothing
+ *
+ * Expected input: A chroma value in [-0.5, 0.5]
+ * Success output: none
+ * Failure output: Prints the value and both indices, and counts a
+ *                  failure, if they differ
+ */
+void check_index(float chroma)
+{
+    uint32_t index;
+    quantize_chroma(&chroma, 1, &index);
+
+    if (index != Arith40_index_of_chroma(chroma)) {
+        printf("index of chroma %.9g: %u, library %u\n", chroma, index,
+               Arith40_index_of_chroma(chroma));
+        failures++;
+    }
+}
@@ -0,0 +1,363 @@
+/**************************************************************
+ *
+ *                     codeword_test.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Checks the codeword row kernels in codeword.c. Rows of random
+ *     fields are packed by the scalar kernel, the AVX2 kernel and
+ *     pack_codeword_row, and rows of random words unpacked the same
+ *     three ways, and every result must match what Bitpack_newu,
+ *     Bitpack_news, Bitpack_getu and Bitpack_gets give one codeword
+ *     at a time. Rows with one field that does not fit its width,
+ *     anywhere in the row including the scalar tail, must make both
+ *     kernels report overflow and pack_codeword_row raise
+ *     Bitpack_Overflow. Rows run to every length up to MAX_COUNT.
+ *     Prints each mismatch and exits with failure if there are any.
+ *
+ **************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <except.h>
+#include <bitpack.h>
+
+#include "codeword.h"
+#include "simd.h"
+
+/* Longest row packed; every length from 0 up is tried */
+#define MAX_COUNT 40
+/* Random rows tried for each length */
+#define TRIALS 200
+
+/* The codeword layout, as codeword.c packs it */
+#define A_WIDTH 6
+#define A_LSB 26
+#define BCD_WIDTH 6
+#define B_LSB 20
+#define C_LSB 14
+#define D_LSB 8
+#define INDEX_WIDTH 4
+#define PB_LSB 4
+#define PR_LSB 0
+
+/* The kernels under test, from codeword.c */
+uint32_t pack_codeword_row_scalar(const uint32_t *a, const int32_t *b,
+                                  const int32_t *c, const int32_t *d,
+                                  const uint32_t *pb_index,
+                                  const uint32_t *pr_index, int count,
+                                  uint32_t *words);
+void unpack_codeword_row_scalar(const uint32_t *words, int count,
+                                uint32_t *a, int32_t *b, int32_t *c,
+                                int32_t *d, uint32_t *pb_index,
+                                uint32_t *pr_index);
+#ifdef HAVE_AVX2_KERNELS
+uint32_t pack_codeword_row_avx2(const uint32_t *a, const int32_t *b,
+                                const int32_t *c, const int32_t *d,
+                                const uint32_t *pb_index,
+                                const uint32_t *pr_index, int count,
+                                uint32_t *words);
+void unpack_codeword_row_avx2(const uint32_t *words, int count,
+                              uint32_t *a, int32_t *b, int32_t *c,
+                              int32_t *d, uint32_t *pb_index,
+                              uint32_t *pr_index);
+#endif
+
+/* The fields of a row of codewords */
+struct fields {
+    uint32_t a[MAX_COUNT];
+    int32_t b[MAX_COUNT], c[MAX_COUNT], d[MAX_COUNT];
+    uint32_t pb[MAX_COUNT], pr[MAX_COUNT];
+};
+
+static int failures = 0;
+
+void check(bool same, const char *function, int count);
+void random_fields(struct fields *row, int count);
+bool same_fields(const struct fields *first, const struct fields *second,
+                 int count);
+bool raises_overflow(const struct fields *row, int count);
+void check_pack(int count);
+void check_overflow(int count);
+void check_unpack(int count);
+
+int main(void)
+{
+    srand(40);
+
+#ifdef HAVE_AVX2_KERNELS
+    if (!cpu_has_avx2()) {
+        printf("codeword_test: no AVX2 on this CPU, only the scalar "
+               "kernels are checked\n");
+    }
+#endif
+
+    for (int count = 0; count <= MAX_COUNT; count++) {
+        for (int trial = 0; trial < TRIALS; trial++) {
+            check_pack(count);
+            check_unpack(count);
+            if (count > 0) {
+                check_overflow(count);
+            }
+        }
+    }
+
+    if (failures > 0) {
+        printf("codeword_test: %d mismatches\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("codeword_test: passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* check
+ * Purpose: Counts and prints a mismatch between a kernel and the
+ *          Bitpack functions
+ * Parameters: Whether they agreed, the kernel's name, and the length
+ *             of the row
+ * Returns: nothing
+ *
+ * Expected input: none
+ * Success output: none
+ * Failure output: Prints the kernel and length when same is false
+ */
+void check(bool same, const char *function, int count)
+{
+    if (!same) {
+        printf("%s differs at %d codewords\n", function, count);
+        failures++;
+    }
+}
+
+/* random_fields
+ * Purpose: Fills a row with random fields that fit their widths
+ * Parameters: The row and its length
+ * Returns: nothing
+ *
+ * Expected input: A count in [0, MAX_COUNT]
+ * Success output: Every field of the first count codewords is set
+ * Failure output: none
+ */
+void random_fields(struct fields *row, int count)
+{
+    for (int i = 0; i < count; i++) {
+        row->a[i] = rand() % (1 << A_WIDTH);
+        row->b[i] = rand() % (1 << BCD_WIDTH) - (1 << (BCD_WIDTH - 1));
+        row->c[i] = rand() % (1 << BCD_WIDTH) - (1 << (BCD_WIDTH - 1));
+        row->d[i] = rand() % (1 << BCD_WIDTH) - (1 << (BCD_WIDTH - 1));
+        row->pb[i] = rand() % (1 << INDEX_WIDTH);
+        row->pr[i] = rand() % (1 << INDEX_WIDTH);
+    }
+}
+
+/* same_fields
+ * Purpose: Compares the fields of two rows
+ * Parameters: The rows and their length
+ * Returns: true if every field of the first count codewords matches
+ *
+ * Expected input: A count in [0, MAX_COUNT]
+ * Success output: none
+ * Failure output: none
+ */
+bool same_fields(const struct fields *first, const struct fields *second,
+                 int count)
+{
+    size_t bytes = count * sizeof(uint32_t);
+
+    return memcmp(first->a, second->a, bytes) == 0
+           && memcmp(first->b, second->b, bytes) == 0
+           && memcmp(first->c, second->c, bytes) == 0
+           && memcmp(first->d, second->d, bytes) == 0
+           && memcmp(first->pb, second->pb, bytes) == 0
+           && memcmp(first->pr, second->pr, bytes) == 0;
+}
+
+/* raises_overflow
+ * Purpose: Packs a row with pack_codeword_row and reports whether it
+ *          raised Bitpack_Overflow
+ * Parameters: The row and its length
+ * Returns: true if Bitpack_Overflow was raised
+ *
+ * Expected input: A count in [0, MAX_COUNT]
+ * Success output: none
+ * Failure output: none
+ */
+bool raises_overflow(const struct fields *row, int count)
+{
+    uint32_t words[MAX_COUNT];
+    volatile bool raised = false;
+
+    TRY
+        pack_codeword_row(row->a, row->b, row->c, row->d, row->pb, row->pr,
+                          count, words);
+    EXCEPT(Bitpack_Overflow)
+        raised = true;
+    END_TRY;
+
+    return raised;
+}
+
+/* check_pack
+ * Purpose: Packs a row of random fields with each kernel and with the
+ *          Bitpack functions and compares the words
+ * Parameters: The length of the row
+ * Returns: nothing
+ *
+ * Expected input: A count in [0, MAX_COUNT]
+ * Success output: none
+ * Failure output: Reports each kernel whose words differ, or that
+ *                  reports overflow
+ */
+void check_pack(int count)
+{
+    struct fields row;
+    uint32_t expected[MAX_COUNT], words[MAX_COUNT];
+    size_t bytes = count * sizeof(uint32_t);
+
+    random_fields(&row, count);
+    for (int i = 0; i < count; i++) {
+        uint64_t word = 0;
+        word = Bitpack_newu(word, A_WIDTH, A_LSB, row.a[i]);
+        word = Bitpack_news(word, BCD_WIDTH, B_LSB, row.b[i]);
+        word = Bitpack_news(word, BCD_WIDTH, C_LSB, row.c[i]);
+        word = Bitpack_news(word, BCD_WIDTH, D_LSB, row.d[i]);
+        word = Bitpack_newu(word, INDEX_WIDTH, PB_LSB, row.pb[i]);
+        word = Bitpack_newu(word, INDEX_WIDTH, PR_LSB, row.pr[i]);
+        expected[i] = word;
+    }
+
+    uint32_t overflow = pack_codeword_row_scalar(row.a, row.b, row.c,
+                                                 row.d, row.pb, row.pr,
+                                                 count, words);
+    check(overflow == 0 && memcmp(words, expected, bytes) == 0,
+          "pack_codeword_row_scalar", count);
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        overflow = pack_codeword_row_avx2(row.a, row.b, row.c, row.d,
+                                          row.pb, row.pr, count, words);
+        check(overflow == 0 && memcmp(words, expected, bytes) == 0,
+              "pack_codeword_row_avx2", count);
+    }
+#endif
+
+    pack_codeword_row(row.a, row.b, row.c, row.d, row.pb, row.pr, count,
+                      words);
+    check(memcmp(words, expected, bytes) == 0, "pack_codeword_row",
+          count);
+}
+
+/* check_overflow
+ * Purpose: Packs a row in which one field of one codeword does not fit
+ *          its width and checks that every kernel notices
+ * Parameters: The length of the row
+ * Returns: nothing
+ *
+ * Expected input: A count in [1, MAX_COUNT]
+ * Success output: none
+ * Failure output: Reports each kernel that does not report overflow,
+ *                  and pack_codeword_row if it does not raise
+ *                  Bitpack_Overflow
+ */
+void check_overflow(int count)
+{
+    struct fields row;
+    uint32_t words[MAX_COUNT];
+    int i = rand() % count;
+    int32_t too_big = 1 << (BCD_WIDTH - 1);
+
+    random_fields(&row, count);
+    switch (rand() % 6) {
+    case 0:
+        row.a[i] = (1 << A_WIDTH) + rand() % 1000;
+        break;
+    case 1:
+        row.b[i] = rand() % 2 ? too_big + rand() % 1000
+                              : -too_big - 1 - rand() % 1000;
+        break;
+    case 2:
+        row.c[i] = rand() % 2 ? too_big : -too_big - 1;
+        break;
+    case 3:
+        row.d[i] = rand() % 2 ? too_big : -too_big - 1;
+        break;
+    case 4:
+        row.pb[i] = 1 << INDEX_WIDTH;
+        break;
+    case 5:
+        row.pr[i] = UINT32_MAX;
+        break;
+    }
+
+    bool fits = Bitpack_fitsu(row.a[i], A_WIDTH)
+                && Bitpack_fitss(row.b[i], BCD_WIDTH)
+                && Bitpack_fitss(row.c[i], BCD_WIDTH)
+                && Bitpack_fitss(row.d[i], BCD_WIDTH)
+                && Bitpack_fitsu(row.pb[i], INDEX_WIDTH)
+                && Bitpack_fitsu(row.pr[i], INDEX_WIDTH);
+    check(!fits, "the overflow test itself", count);
+
+    check(pack_codeword_row_scalar(row.a, row.b, row.c, row.d, row.pb,
+                                   row.pr, count, words) != 0,
+          "pack_codeword_row_scalar overflow", count);
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        check(pack_codeword_row_avx2(row.a, row.b, row.c, row.d, row.pb,
+                                     row.pr, count, words) != 0,
+              "pack_codeword_row_avx2 overflow", count);
+    }
+#endif
+    check(raises_overflow(&row, count), "pack_codeword_row overflow",
+          count);
+}
+
+/* check_unpack
+ * Purpose: Unpacks a row of random words with each kernel and with the
+ *          Bitpack functions and compares the fields
+ * Parameters: The length of the row
+ * Returns: nothing
+ *
+ * Expected input: A count in [0, MAX_COUNT]
+ * Success output: none
+ * Failure output: Reports each kernel whose fields differ
+ */
+void check_unpack(int count)
+{
+    uint32_t words[MAX_COUNT];
+    struct fields expected, row;
+
+    for (int i = 0; i < count; i++) {
+        words[i] = (uint32_t)rand() << 16 ^ (uint32_t)rand();
+
+        expected.a[i] = Bitpack_getu(words[i], A_WIDTH, A_LSB);
+        expected.b[i] = Bitpack_gets(words[i], BCD_WIDTH, B_LSB);
+        expected.c[i] = Bitpack_gets(words[i], BCD_WIDTH, C_LSB);
+        expected.d[i] = Bitpack_gets(words[i], BCD_WIDTH, D_LSB);
+        expected.pb[i] = Bitpack_getu(words[i], INDEX_WIDTH, PB_LSB);
+        expected.pr[i] = Bitpack_getu(words[i], INDEX_WIDTH, PR_LSB);
+    }
+
+    unpack_codeword_row_scalar(words, count, row.a, row.b, row.c, row.d,
+                               row.pb, row.pr);
+    check(same_fields(&row, &expected, count),
+          "unpack_codeword_row_scalar", count);
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        unpack_codeword_row_avx2(words, count, row.a, row.b, row.c, row.d,
+                                 row.pb, row.pr);
+        check(same_fields(&row, &expected, count),
+              "unpack_codeword_row_avx2", count);
+    }
+#endif
+
+    unpack_codeword_row(words, count, row.a, row.b, row.c, row.d, row.pb,
+                        row.pr);
+    check(same_fields(&row, &expected, count), "unpack_codeword_row",
+          count);
+}
@@ -0,0 +1,269 @@
+/**************************************************************
+ *
+ *                     colorspace_test.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Checks the AVX2 color conversion kernels in colorspace.c
+ *     against the scalar formulas. Random pixels are converted by
+ *     both, for 8- and 16-bit denominators and for every run length
+ *     up to MAX_COUNT, so the vector loop and each length of its
+ *     scalar tail run, and the results must match bit for bit.
+ *     Component video going back to samples also includes values
+ *     that convert to well outside [0, denominator], values on its
+ *     edges and signed zeros, so the AVX2 min/max clamp is checked
+ *     against force_values_into_range, and ypbpr_blocks_to_samples
+ *     is checked against the scalar formulas on rows of blocks long
+ *     enough to be converted in more than one chunk.
+ *     Prints each mismatch and exits with failure if there are any.
+ *     On a CPU without AVX2 there is nothing to compare and the test
+ *     passes.
+ *
+ **************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "colorspace.h"
+#include "simd.h"
+
+/* Longest run converted; every length from 0 up is tried */
+#define MAX_COUNT 40
+/* Most blocks in a row given to ypbpr_blocks_to_samples */
+#define MAX_BLOCKS 80
+/* Random runs tried for each denominator and length */
+#define TRIALS 50
+
+/* The kernels under test, from colorspace.c */
+void samples_to_ypbpr_scalar(const unsigned char *samples, int count,
+                             unsigned denominator, float *y, float *pb,
+                             float *pr);
+void ypbpr_to_samples_scalar(const float *y, const float *pb,
+                             const float *pr, int count,
+                             unsigned denominator, unsigned char *samples);
+#ifdef HAVE_AVX2_KERNELS
+void samples_to_ypbpr_avx2(const unsigned char *samples, int count,
+                           unsigned denominator, float *y, float *pb,
+                           float *pr);
+void ypbpr_to_samples_avx2(const float *y, const float *pb,
+                           const float *pr, int count,
+                           unsigned denominator, unsigned char *samples);
+
+/* Component values that clamp, land on an edge of the range, or are
+ * signed zeros; random_component picks one of these a quarter of the
+ * time */
+static const float edges[] = { 0.0f, -0.0f, 1.0f, -1.0f, 0.5f, -0.5f,
+                               1.00001f, -0.00001f, 2.0f, -2.0f,
+                               1e30f, -1e30f };
+
+static const unsigned denominators[] = { 1, 255, 256, 65535 };
+#endif
+
+static int failures = 0;
+
+void check(bool same, const char *function, unsigned denominator,
+           int count);
+void check_to_ypbpr(unsigned denominator, int count);
+float random_component(void);
+void check_to_samples(unsigned denominator, int count);
+void check_blocks_to_samples(unsigned denominator, int blocks);
+
+int main(void)
+{
+#ifdef HAVE_AVX2_KERNELS
+    if (!cpu_has_avx2()) {
+        printf("colorspace_test: no AVX2 on this CPU, nothing to "
+               "compare\n");
+        return EXIT_SUCCESS;
+    }
+
+    srand(40);
+    for (unsigned k = 0; k < sizeof(denominators) / sizeof(*denominators);
+                                                                     k++) {
+        for (int count = 0; count <= MAX_COUNT; count++) {
+            for (int trial = 0; trial < TRIALS; trial++) {
+                check_to_ypbpr(denominators[k], count);
+                check_to_samples(denominators[k], count);
+            }
+        }
+        for (int blocks = 0; blocks <= MAX_BLOCKS; blocks++) {
+            for (int trial = 0; trial < TRIALS; trial++) {
+                check_blocks_to_samples(denominators[k], blocks);
+            }
+        }
+    }
+#else
+    printf("colorspace_test: no AVX2 kernels on this target, nothing to "
+           "compare\n");
+    return EXIT_SUCCESS;
+#endif
+
+    if (failures > 0) {
+        printf("colorspace_test: %d mismatches\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("colorspace_test: passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* check
+ * Purpose: Counts and prints a mismatch between an AVX2 kernel and
+ *          its scalar version
+ * Parameters: Whether they agreed, the kernel's name, and the
+ *             denominator and run length it was given
+ * Returns: nothing
+ *
+ * Expected input: none
+ * Success output: none
+ * Failure output: Prints the kernel, denominator and length when same
+ *                  is false
+ */
+void check(bool same, const char *function, unsigned denominator,
+           int count)
+{
+    if (!same) {
+        printf("%s differs at denominator %u, %d pixels\n", function,
+               denominator, count);
+        failures++;
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* check_to_ypbpr
+ * Purpose: Converts a run of random pixels to component video with
+ *          both versions of samples_to_ypbpr and compares the bits
+ * Parameters: The denominator and the number of pixels
+ * Returns: nothing
+ *
+ * Expected input: A denominator in [1, 65535] and a count in
+ *                  [0, MAX_COUNT]
+ * Success output: none
+ * Failure output: Reports a mismatch if any y, pb or pr differs in
+ *                  any bit
+ */
+void check_to_ypbpr(unsigned denominator, int count)
+{
+    int sample_bytes = denominator > 255 ? 2 : 1;
+    unsigned char samples[6 * MAX_COUNT];
+    float scalar[3][MAX_COUNT], avx2[3][MAX_COUNT];
+
+    for (int s = 0; s < 3 * count; s++) {
+        unsigned value = rand() % (denominator + 1);
+        if (sample_bytes == 2) {
+            samples[2 * s] = value >> 8;
+            samples[2 * s + 1] = value;
+        } else {
+            samples[s] = value;
+        }
+    }
+
+    samples_to_ypbpr_scalar(samples, count, denominator, scalar[0],
+                            scalar[1], scalar[2]);
+    samples_to_ypbpr_avx2(samples, count, denominator, avx2[0], avx2[1],
+                          avx2[2]);
+
+    bool same = true;
+    for (int c = 0; c < 3; c++) {
+        same &= memcmp(scalar[c], avx2[c], count * sizeof(float)) == 0;
+    }
+    check(same, "samples_to_ypbpr_avx2", denominator, count);
+}
+
+/* random_component
+ * Purpose: Makes a y, pb or pr value for the conversions back to
+ *          samples, most often in [-1, 2) and otherwise from edges
+ * Parameters: none
+ * Returns: A float
+ *
+ * Expected input: none
+ * Success output: A finite float
+ * Failure output: none
+ */
+float random_component(void)
+{
+    if (rand() % 4 == 0) {
+        return edges[rand() % (sizeof(edges) / sizeof(*edges))];
+    }
+    return -1.0f + 3.0f * rand() / ((float)RAND_MAX + 1);
+}
+
+/* check_to_samples
+ * Purpose: Converts a run of random component video pixels to samples
+ *          with both versions of ypbpr_to_samples and compares them
+ * Parameters: The denominator and the number of pixels
+ * Returns: nothing
+ *
+ * Expected input: A denominator in [1, 65535] and a count in
+ *                  [0, MAX_COUNT]
+ * Success output: none
+ * Failure output: Reports a mismatch if any sample byte differs
+ */
+void check_to_samples(unsigned denominator, int count)
+{
+    size_t bytes = (size_t)count * (denominator > 255 ? 6 : 3);
+    float component[3][MAX_COUNT];
+    unsigned char scalar[6 * MAX_COUNT], avx2[6 * MAX_COUNT];
+
+    for (int c = 0; c < 3; c++) {
+        for (int i = 0; i < count; i++) {
+            component[c][i] = random_component();
+        }
+    }
+
+    ypbpr_to_samples_scalar(component[0], component[1], component[2],
+                            count, denominator, scalar);
+    ypbpr_to_samples_avx2(component[0], component[1], component[2],
+                          count, denominator, avx2);
+
+    check(memcmp(scalar, avx2, bytes) == 0, "ypbpr_to_samples_avx2",
+          denominator, count);
+}
+
+/* check_blocks_to_samples
+ * Purpose: Converts a row of random 2-by-2 blocks back to two
+ *          scanlines with ypbpr_blocks_to_samples, which takes the
+ *          AVX2 kernel, and compares them with the scalar formulas
+ *          applied to each pixel and its block's chroma
+ * Parameters: The denominator and the number of blocks
+ * Returns: nothing
+ *
+ * Expected input: A denominator in [1, 65535] and a number of blocks
+ *                  in [0, MAX_BLOCKS]
+ * Success output: none
+ * Failure output: Reports a mismatch if any sample byte differs
+ */
+void check_blocks_to_samples(unsigned denominator, int blocks)
+{
+    size_t bytes = (size_t)2 * blocks * (denominator > 255 ? 6 : 3);
+    float y[2][2 * MAX_BLOCKS], pb[MAX_BLOCKS], pr[MAX_BLOCKS];
+    float pixel_pb[2 * MAX_BLOCKS], pixel_pr[2 * MAX_BLOCKS];
+    unsigned char lines[2][12 * MAX_BLOCKS];
+    unsigned char expected[2][12 * MAX_BLOCKS];
+
+    for (int k = 0; k < blocks; k++) {
+        pb[k] = random_component();
+        pr[k] = random_component();
+        for (int i = 2 * k; i < 2 * k + 2; i++) {
+            y[0][i] = random_component();
+            y[1][i] = random_component();
+            pixel_pb[i] = pb[k];
+            pixel_pr[i] = pr[k];
+        }
+    }
+
+    ypbpr_blocks_to_samples(y[0], y[1], pb, pr, blocks, denominator,
+                            lines[0], lines[1]);
+    for (int line = 0; line < 2; line++) {
+        ypbpr_to_samples_scalar(y[line], pixel_pb, pixel_pr, 2 * blocks,
+                                denominator, expected[line]);
+    }
+
+    check(memcmp(lines[0], expected[0], bytes) == 0
+          && memcmp(lines[1], expected[1], bytes) == 0,
+          "ypbpr_blocks_to_samples", denominator, 2 * blocks);
+}
+#endif
@@ -0,0 +1,289 @@
+/**************************************************************
+ *
+ *                     dctrans_test.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Checks the AVX2 DCT lane kernels in dctrans.c against the
+ *     scalar formulas. Lanes of random blocks are transformed both
+ *     ways for every count up to MAX_COUNT, which runs the vector
+ *     loop, every length of its scalar tail, and rows of more than
+ *     one LANE_CHUNK through dct_block_row and reverse_dct_block_row.
+ *     Many of the blocks are built so b, c or d lands exactly on, or
+ *     one float either side of, the +-0.3 edges where map_bcd stops
+ *     clamping, and many coefficients going back are the ends of the
+ *     mapped range. Results must match bit for bit. Prints each
+ *     mismatch and exits with failure if there are any. On a CPU
+ *     without AVX2 there is nothing to compare and the test passes.
+ *
+ **************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "dctrans.h"
+#include "simd.h"
+
+/* Most blocks transformed at once; more than two LANE_CHUNKs */
+#define MAX_COUNT 150
+/* Random lanes tried for each count */
+#define TRIALS 40
+
+/* The kernels under test, from dctrans.c */
+void dct_blocks_scalar(const float *y1, const float *y2, const float *y3,
+                       const float *y4, int count, uint32_t *a,
+                       int32_t *b, int32_t *c, int32_t *d);
+void reverse_dct_blocks_scalar(const uint32_t *a, const int32_t *b,
+                               const int32_t *c, const int32_t *d,
+                               int count, float *y1, float *y2, float *y3,
+                               float *y4);
+#ifdef HAVE_AVX2_KERNELS
+void dct_blocks_avx2(const float *y1, const float *y2, const float *y3,
+                     const float *y4, int count, uint32_t *a, int32_t *b,
+                     int32_t *c, int32_t *d);
+void reverse_dct_blocks_avx2(const uint32_t *a, const int32_t *b,
+                             const int32_t *c, const int32_t *d, int count,
+                             float *y1, float *y2, float *y3, float *y4);
+
+/* Coefficients going back that are the ends of the mapped range or
+ * just outside it; random_bcd picks one of these half the time */
+static const int32_t bcd_edges[] = { -32, -31, -30, -29, 0, 29, 30, 31 };
+#endif
+
+static int failures = 0;
+
+void check(bool same, const char *function, int count);
+float random_luma(void);
+void make_block(float y[4]);
+int32_t random_bcd(void);
+void check_dct(int count);
+void check_reverse_dct(int count);
+
+int main(void)
+{
+#ifdef HAVE_AVX2_KERNELS
+    if (!cpu_has_avx2()) {
+        printf("dctrans_test: no AVX2 on this CPU, nothing to compare\n");
+        return EXIT_SUCCESS;
+    }
+
+    srand(40);
+    for (int count = 0; count <= MAX_COUNT; count++) {
+        for (int trial = 0; trial < TRIALS; trial++) {
+            check_dct(count);
+            check_reverse_dct(count);
+        }
+    }
+#else
+    printf("dctrans_test: no AVX2 kernels on this target, nothing to "
+           "compare\n");
+    return EXIT_SUCCESS;
+#endif
+
+    if (failures > 0) {
+        printf("dctrans_test: %d mismatches\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("dctrans_test: passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* check
+ * Purpose: Counts and prints a mismatch between a kernel and the
+ *          scalar formulas
+ * Parameters: Whether they agreed, the kernel's name, and the number
+ *             of blocks it was given
+ * Returns: nothing
+ *
+ * Expected input: none
+ * Success output: none
+ * Failure output: Prints the kernel and count when same is false
+ */
+void check(bool same, const char *function, int count)
+{
+    if (!same) {
+        printf("%s differs at %d blocks\n", function, count);
+        failures++;
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* random_luma
+ * Purpose: Makes a random luma value
+ * Parameters: none
+ * Returns: A float in [0, 1]
+ *
+ * Expected input: none
+ * Success output: A luma value, 0 or 1 now and then
+ * Failure output: none
+ */
+float random_luma(void)
+{
+    switch (rand() % 8) {
+    case 0:
+        return 0.0f;
+    case 1:
+        return 1.0f;
+    default:
+        return (float)rand() / RAND_MAX;
+    }
+}
+
+/* make_block
+ * Purpose: Makes the luma of one block, top-left, top-right,
+ *          bottom-left, bottom-right. Half the time it is random;
+ *          otherwise two of the pixels are 2t and two are 0, placed so
+ *          that b, c or d works out to exactly t, where t is +-0.3 or
+ *          the float next to it on either side.
+ * Parameters: An array for the four luma values
+ * Returns: nothing
+ *
+ * Expected input: none
+ * Success output: y holds luma values in [0, 1]
+ * Failure output: none
+ */
+void make_block(float y[4])
+{
+    if (rand() % 2 == 0) {
+        for (int k = 0; k < 4; k++) {
+            y[k] = random_luma();
+        }
+        return;
+    }
+
+    /* The pixels that are added to form b, c and d, when positive */
+    static const int added[3][2] = { { 2, 3 }, { 1, 3 }, { 0, 3 } };
+    static const int taken[3][2] = { { 0, 1 }, { 0, 2 }, { 1, 2 } };
+
+    float edge = 0.3f;
+    switch (rand() % 3) {
+    case 1:
+        edge = nextafterf(edge, 0.0f);
+        break;
+    case 2:
+        edge = nextafterf(edge, 1.0f);
+        break;
+    }
+
+    int which = rand() % 3;
+    const int *set = rand() % 2 ? added[which] : taken[which];
+    y[0] = y[1] = y[2] = y[3] = 0.0f;
+    y[set[0]] = y[set[1]] = 2 * edge;
+}
+
+/* random_bcd
+ * Purpose: Makes a b, c or d coefficient to transform back
+ * Parameters: none
+ * Returns: An int32_t
+ *
+ * Expected input: none
+ * Success output: A value in [-30, 30] half the time and one of
+ *                  bcd_edges otherwise
+ * Failure output: none
+ */
+int32_t random_bcd(void)
+{
+    if (rand() % 2 == 0) {
+        return bcd_edges[rand() % (sizeof(bcd_edges) / sizeof(*bcd_edges))];
+    }
+    return rand() % 61 - 30;
+}
+
+/* check_dct
+ * Purpose: DCTs a lane of random blocks with the AVX2 kernel, the
+ *          scalar one and dct_block_row, and compares the coefficients
+ * Parameters: The number of blocks
+ * Returns: nothing
+ *
+ * Expected input: A count in [0, MAX_COUNT]
+ * Success output: none
+ * Failure output: Reports each kernel whose coefficients differ from
+ *                  the scalar ones
+ */
+void check_dct(int count)
+{
+    float y[4][MAX_COUNT], top[2 * MAX_COUNT], bottom[2 * MAX_COUNT];
+    uint32_t a[2][MAX_COUNT];
+    int32_t b[2][MAX_COUNT], c[2][MAX_COUNT], d[2][MAX_COUNT];
+    size_t bytes = count * sizeof(int32_t);
+
+    for (int i = 0; i < count; i++) {
+        float block[4];
+        make_block(block);
+        for (int k = 0; k < 4; k++) {
+            y[k][i] = block[k];
+        }
+        top[2 * i] = block[0];
+        top[2 * i + 1] = block[1];
+        bottom[2 * i] = block[2];
+        bottom[2 * i + 1] = block[3];
+    }
+
+    dct_blocks_scalar(y[0], y[1], y[2], y[3], count, a[0], b[0], c[0],
+                      d[0]);
+
+    dct_blocks_avx2(y[0], y[1], y[2], y[3], count, a[1], b[1], c[1], d[1]);
+    check(memcmp(a[0], a[1], bytes) == 0 && memcmp(b[0], b[1], bytes) == 0
+          && memcmp(c[0], c[1], bytes) == 0
+          && memcmp(d[0], d[1], bytes) == 0, "dct_blocks_avx2", count);
+
+    dct_block_row(top, bottom, count, a[1], b[1], c[1], d[1]);
+    check(memcmp(a[0], a[1], bytes) == 0 && memcmp(b[0], b[1], bytes) == 0
+          && memcmp(c[0], c[1], bytes) == 0
+          && memcmp(d[0], d[1], bytes) == 0, "dct_block_row", count);
+}
+
+/* check_reverse_dct
+ * Purpose: Reverse DCTs a lane of random coefficients with the AVX2
+ *          kernel, the scalar one and reverse_dct_block_row, and
+ *          compares the luma values bit for bit
+ * Parameters: The number of blocks
+ * Returns: nothing
+ *
+ * Expected input: A count in [0, MAX_COUNT]
+ * Success output: none
+ * Failure output: Reports each kernel whose luma values differ from
+ *                  the scalar ones
+ */
+void check_reverse_dct(int count)
+{
+    uint32_t a[MAX_COUNT];
+    int32_t b[MAX_COUNT], c[MAX_COUNT], d[MAX_COUNT];
+    float scalar[4][MAX_COUNT], avx2[4][MAX_COUNT];
+    float top[2 * MAX_COUNT], bottom[2 * MAX_COUNT];
+
+    for (int i = 0; i < count; i++) {
+        a[i] = rand() % 64;
+        b[i] = random_bcd();
+        c[i] = random_bcd();
+        d[i] = random_bcd();
+    }
+
+    reverse_dct_blocks_scalar(a, b, c, d, count, scalar[0], scalar[1],
+                              scalar[2], scalar[3]);
+
+    reverse_dct_blocks_avx2(a, b, c, d, count, avx2[0], avx2[1], avx2[2],
+                            avx2[3]);
+    bool same = true;
+    for (int k = 0; k < 4; k++) {
+        same &= memcmp(scalar[k], avx2[k], count * sizeof(float)) == 0;
+    }
+    check(same, "reverse_dct_blocks_avx2", count);
+
+    reverse_dct_block_row(a, b, c, d, count, top, bottom);
+    same = true;
+    for (int i = 0; i < count; i++) {
+        float row[4] = { top[2 * i], top[2 * i + 1], bottom[2 * i],
+                         bottom[2 * i + 1] };
+        for (int k = 0; k < 4; k++) {
+            same &= memcmp(&row[k], &scalar[k][i], sizeof(float)) == 0;
+        }
+    }
+    check(same, "reverse_dct_block_row", count);
+}
+#endif
@@ -0,0 +1,366 @@
+/**************************************************************
+ *
+ *                     fixedcodec_test.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Checks the fixed-point codec. Its AVX2 lane kernels must give
+ *     exactly the words and samples of the scalar ones: random
+ *     lanes, with samples of 0 and the denominator mixed in, are
+ *     coded both ways for 8- and 16-bit denominators and every count
+ *     up to LANE_CHUNK. Then a generated image is coded a row of
+ *     blocks at a time with CODEC_FLOAT and CODEC_FIXED, and the
+ *     two round trips, and the two decodings of the same words,
+ *     must stay within the deviation fixedcodec.h documents, as
+ *     ppmdiff measures it. Prints each failure and exits with
+ *     failure if there are any.
+ *
+ **************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#include "blockcodec.h"
+#include "fixedlanes.h"
+
+/* Random lanes tried for each denominator and count */
+#define TRIALS 50
+/* The generated image */
+#define WIDTH 320
+#define HEIGHT 240
+/* The deviations from the float codec fixedcodec.h documents */
+#define ROUND_TRIP_BOUND 0.0041
+#define SAME_WORDS_BOUND 0.0006
+
+static const unsigned denominators[] = { 1, 255, 256, 1000, 65535 };
+static int failures = 0;
+
+void check(bool same, const char *what, unsigned denominator, int count);
+uint16_t random_sample(unsigned denominator);
+void check_encode(unsigned denominator, int count);
+void check_decode(unsigned denominator, int count);
+unsigned char *make_image(unsigned denominator);
+unsigned char *round_trip(const unsigned char *image,
+                          unsigned denominator, Codec_arithmetic encoder,
+                          Codec_arithmetic decoder);
+double difference(const unsigned char *first, const unsigned char *second,
+                  unsigned denominator);
+void check_deviation(unsigned denominator);
+
+int main(void)
+{
+    unsigned kinds = sizeof(denominators) / sizeof(*denominators);
+    srand(40);
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        for (unsigned k = 0; k < kinds; k++) {
+            for (int count = 0; count <= LANE_CHUNK; count++) {
+                for (int trial = 0; trial < TRIALS; trial++) {
+                    check_encode(denominators[k], count);
+                    check_decode(denominators[k], count);
+                }
+            }
+        }
+    } else {
+        printf("fixedcodec_test: no AVX2 on this CPU, kernels not "
+               "compared\n");
+    }
+#endif
+
+    for (unsigned k = 0; k < kinds; k++) {
+        check_deviation(denominators[k]);
+    }
+
+    if (failures > 0) {
+        printf("fixedcodec_test: %d failures\n", failures);
+        return EXIT_FAILURE;
+    }
+    printf("fixedcodec_test: passed\n");
+    return EXIT_SUCCESS;
+}
+
+/* check
+ * Purpose: Counts and prints a failed check
+ * Parameters: Whether it held, what was checked, and the denominator
+ *             and number of blocks
+ * Returns: nothing
+ *
+ * Expected input: none
+ * Success output: none
+ * Failure output: Prints what failed when same is false
+ */
+void check(bool same, const char *what, unsigned denominator, int count)
+{
+    if (!same) {
+        printf("%s fails at denominator %u, %d blocks\n", what,
+               denominator, count);
+        failures++;
+    }
+}
+
+/* random_sample
+ * Purpose: Makes a random sample, 0 or the denominator now and then
+ * Parameters: The denominator
+ * Returns: A sample in [0, denominator]
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: A sample
+ * Failure output: none
+ */
+uint16_t random_sample(unsigned denominator)
+{
+    switch (rand() % 8) {
+    case 0:
+        return 0;
+    case 1:
+        return denominator;
+    default:
+        return rand() % (denominator + 1);
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* check_encode
+ * Purpose: Codes random lanes with both encode kernels and compares
+ *          every field they give
+ * Parameters: The denominator and the number of blocks
+ * Returns: nothing
+ *
+ * Expected input: A denominator in [1, 65535] and a count in
+ *                  [0, LANE_CHUNK]
+ * Success output: none
+ * Failure output: Reports a mismatch if any field differs
+ */
+void check_encode(unsigned denominator, int count)
+{
+    struct sample_scale scale = scale_of_denominator(denominator);
+    Sample_lanes lanes;
+    uint32_t a[2][LANE_CHUNK], pb[2][LANE_CHUNK], pr[2][LANE_CHUNK];
+    int32_t b[2][LANE_CHUNK], c[2][LANE_CHUNK], d[2][LANE_CHUNK];
+    size_t bytes = count * sizeof(uint32_t);
+
+    for (int p = 0; p < 4; p++) {
+        for (int channel = 0; channel < 3; channel++) {
+            for (int k = 0; k < count; k++) {
+                lanes[p][channel][k] = random_sample(denominator);
+            }
+        }
+    }
+
+    fixed_encode_lanes_scalar(lanes, 0, count, scale, a[0], b[0], c[0],
+                              d[0], pb[0], pr[0]);
+    fixed_encode_lanes_avx2(lanes, count, scale, a[1], b[1], c[1], d[1],
+                            pb[1], pr[1]);
+
+    check(memcmp(a[0], a[1], bytes) == 0 && memcmp(b[0], b[1], bytes) == 0
+          && memcmp(c[0], c[1], bytes) == 0
+          && memcmp(d[0], d[1], bytes) == 0
+          && memcmp(pb[0], pb[1], bytes) == 0
+          && memcmp(pr[0], pr[1], bytes) == 0,
+          "fixed_encode_lanes_avx2", denominator, count);
+}
+
+/* check_decode
+ * Purpose: Decodes random fields, over the whole range each field of
+ *          a codeword can hold, with both decode kernels and compares
+ *          the samples
+ * Parameters: The denominator and the number of blocks
+ * Returns: nothing
+ *
+ * Expected input: A denominator in [1, 65535] and a count in
+ *                  [0, LANE_CHUNK]
+ * Success output: none
+ * Failure output: Reports a mismatch if any sample differs
+ */
+void check_decode(unsigned denominator, int count)
+{
+    uint32_t a[LANE_CHUNK], pb[LANE_CHUNK], pr[LANE_CHUNK];
+    int32_t b[LANE_CHUNK], c[LANE_CHUNK], d[LANE_CHUNK];
+    Sample_lanes lanes[2];
+
+    for (int k = 0; k < count; k++) {
+        a[k] = rand() % 64;
+        b[k] = rand() % 64 - 32;
+        c[k] = rand() % 64 - 32;
+        d[k] = rand() % 64 - 32;
+        pb[k] = rand() % 16;
+        pr[k] = rand() % 16;
+    }
+
+    fixed_decode_lanes_scalar(a, b, c, d, pb, pr, 0, count, denominator,
+                              lanes[0]);
+    fixed_decode_lanes_avx2(a, b, c, d, pb, pr, count, denominator,
+                            lanes[1]);
+
+    bool same = true;
+    for (int p = 0; p < 4; p++) {
+        for (int channel = 0; channel < 3; channel++) {
+            same &= memcmp(lanes[0][p][channel], lanes[1][p][channel],
+                           count * sizeof(uint16_t)) == 0;
+        }
+    }
+    check(same, "fixed_decode_lanes_avx2", denominator, count);
+}
+#endif
+
+/* make_image
+ * Purpose: Generates a WIDTH by HEIGHT image of packed samples: smooth
+ *          color gradients with waves and some noise on top, and a
+ *          band of saturated primaries along the bottom
+ * Parameters: The denominator
+ * Returns: The samples, one or two bytes each as ppmstream.h packs
+ *          them
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: A malloc'd image the caller frees
+ * Failure output: Exits if allocation fails
+ */
+unsigned char *make_image(unsigned denominator)
+{
+    int sample_bytes = denominator > 255 ? 2 : 1;
+    unsigned char *image = malloc((size_t)WIDTH * HEIGHT * 3
+                                                      * sample_bytes);
+    if (image == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    unsigned char *sample = image;
+    for (int row = 0; row < HEIGHT; row++) {
+        for (int col = 0; col < WIDTH; col++) {
+            for (int channel = 0; channel < 3; channel++) {
+                double value = (double)col / WIDTH * (channel == 0)
+                             + (double)row / HEIGHT * (channel == 1)
+                             + 0.25 * sin(col * 0.05 + row * 0.03
+                                                    + 2.0 * channel)
+                             + 0.05 * rand() / RAND_MAX + 0.2;
+                if (row >= HEIGHT - 16) {
+                    value = (col / 16 + channel) % 3 == 0;
+                }
+                if (value < 0) {
+                    value = 0;
+                } else if (value > 1) {
+                    value = 1;
+                }
+
+                unsigned scaled = value * denominator + 0.5;
+                if (sample_bytes == 2) {
+                    *sample++ = scaled >> 8;
+                }
+                *sample++ = scaled;
+            }
+        }
+    }
+    return image;
+}
+
+/* round_trip
+ * Purpose: Compresses an image a row of blocks at a time with one
+ *          arithmetic and decompresses the words with another
+ * Parameters: The image, its denominator, and the arithmetic of the
+ *             encoder and of the decoder
+ * Returns: The decompressed image
+ *
+ * Expected input: An image made by make_image
+ * Success output: A malloc'd image the caller frees
+ * Failure output: Exits if allocation fails
+ */
+unsigned char *round_trip(const unsigned char *image,
+                          unsigned denominator, Codec_arithmetic encoder,
+                          Codec_arithmetic decoder)
+{
+    size_t line = (size_t)WIDTH * 3 * (denominator > 255 ? 2 : 1);
+    int blocks = WIDTH / 2;
+    unsigned char *result = malloc(line * HEIGHT);
+    uint32_t *words = malloc(blocks * sizeof(uint32_t));
+    if (result == NULL || words == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    Blockcodec encode = blockcodec_new(blocks, encoder);
+    Blockcodec decode = blockcodec_new(blocks, decoder);
+    for (int row = 0; row < HEIGHT; row += 2) {
+        encode_block_row(encode, image + row * line,
+                         image + (row + 1) * line, denominator, words,
+                         blocks);
+        decode_block_row(decode, words, blocks, denominator,
+                         result + row * line, result + (row + 1) * line);
+    }
+    blockcodec_free(&encode);
+    blockcodec_free(&decode);
+
+    free(words);
+    return result;
+}
+
+/* difference
+ * Purpose: Measures how far apart two images are as ppmdiff does: the
+ *          root mean square of every sample's difference, as a
+ *          fraction of the denominator
+ * Parameters: Two images and their denominator
+ * Returns: The difference, 0 if they are the same
+ *
+ * Expected input: Two WIDTH by HEIGHT images of the same denominator
+ * Success output: A value in [0, 1]
+ * Failure output: none
+ */
+double difference(const unsigned char *first, const unsigned char *second,
+                  unsigned denominator)
+{
+    int samples = WIDTH * HEIGHT * 3;
+    bool deep = denominator > 255;
+    double sum = 0;
+
+    for (int s = 0; s < samples; s++) {
+        int one = deep ? first[2 * s] << 8 | first[2 * s + 1] : first[s];
+        int two = deep ? second[2 * s] << 8 | second[2 * s + 1]
+                       : second[s];
+        double apart = (double)(one - two) / denominator;
+        sum += apart * apart;
+    }
+
+    return sqrt(sum / samples);
+}
+
+/* check_deviation
+ * Purpose: Round trips a generated image with each codec, and decodes
+ *          the float codec's words with each, and checks the results
+ *          stay within the documented bounds of each other
+ * Parameters: The denominator
+ * Returns: nothing
+ *
+ * Expected input: A denominator in [1, 65535]
+ * Success output: Prints both differences
+ * Failure output: Reports each bound that is exceeded
+ */
+void check_deviation(unsigned denominator)
+{
+    unsigned char *image = make_image(denominator);
+    unsigned char *floats = round_trip(image, denominator, CODEC_FLOAT,
+                                       CODEC_FLOAT);
+    unsigned char *fixed = round_trip(image, denominator, CODEC_FIXED,
+                                      CODEC_FIXED);
+    unsigned char *same_words = round_trip(image, denominator, CODEC_FLOAT,
+                                           CODEC_FIXED);
+
+    double round_trips = difference(floats, fixed, denominator);
+    double decodings = difference(floats, same_words, denominator);
+    printf("  denominator %5u: round trips %.4f apart, decodings %.4f\n",
+           denominator, round_trips, decodings);
+    check(round_trips <= ROUND_TRIP_BOUND, "round trip deviation",
+          denominator, WIDTH / 2 * HEIGHT / 2);
+    check(decodings <= SAME_WORDS_BOUND, "decoding deviation",
+          denominator, WIDTH / 2 * HEIGHT / 2);
+
+    free(image);
+    free(floats);
+    free(fixed);
+    free(same_words);
+}
@@ -0,0 +1,208 @@
+/**************************************************************
+ *
+ *                     threadpool.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Implementation of the threadpool class. Workers sleep on a
+ *     condition variable until the generation counter changes,
+ *     which is how threadpool_run hands out a new task.
+ *
+ **************************************************************/
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "threadpool.h"
+
+struct Threadpool {
+    int workers;
+    pthread_t *threads;         /* workers - 1 threads; caller is 0 */
+
+    pthread_mutex_t lock;
+    pthread_cond_t start;       /* signalled when a task is posted */
+    pthread_cond_t done;        /* signalled when the last one ends */
+
+    unsigned generation;        /* bumped once per posted task */
+    int running;                /* threads still busy with the task */
+    bool stopping;
+
+    Threadpool_task *task;
+    void *cl;
+};
+
+struct worker_start {
+    Threadpool pool;
+    int worker;
+};
+
+void *worker_loop(void *arg);
+
+/* threadpool_new
+ * Purpose: Starts a pool of worker threads
+ * Parameters: The total number of workers, including the caller
+ * Returns: A Threadpool
+ *
+ * Expected input: A number of workers of at least 1
+ * Success output: A pool with workers - 1 idle threads
+ * Failure output: Raises a Checked Runtime Error if workers < 1 or a
+ *                  thread cannot be started
+ */
+Threadpool threadpool_new(int workers)
+{
+    assert(workers >= 1);
+
+    Threadpool pool = malloc(sizeof(struct Threadpool));
+    assert(pool);
+
+    pool->workers = workers;
+    pool->generation = 0;
+    pool->running = 0;
+    pool->stopping = false;
+    pool->task = NULL;
+    pool->cl = NULL;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    pool->threads = malloc((workers - 1) * sizeof(pthread_t));
+    assert(workers == 1 || pool->threads != NULL);
+
+    for (int i = 1; i < workers; i++) {
+        struct worker_start *start = malloc(sizeof(struct worker_start));
+        assert(start);
+        start->pool = pool;
+        start->worker = i;
+
+        int failed = pthread_create(&pool->threads[i - 1], NULL,
+                                    worker_loop, start);
+        assert(failed == 0);
+    }
+
+    return pool;
+}
+
+/* threadpool_free
+ * Purpose: Stops and joins every worker thread and frees the pool
+ * Parameters: A pointer to a Threadpool
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid, idle Threadpool
+ * Success output: The pool is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if pool is NULL
+ */
+void threadpool_free(Threadpool *pool)
+{
+    assert(pool != NULL && *pool != NULL);
+    Threadpool p = *pool;
+
+    pthread_mutex_lock(&p->lock);
+    p->stopping = true;
+    pthread_cond_broadcast(&p->start);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 1; i < p->workers; i++) {
+        pthread_join(p->threads[i - 1], NULL);
+    }
+
+    pthread_cond_destroy(&p->done);
+    pthread_cond_destroy(&p->start);
+    pthread_mutex_destroy(&p->lock);
+    free(p->threads);
+    free(p);
+    *pool = NULL;
+}
+
+/* threadpool_workers
+ * Purpose: Returns the number of workers in a pool
+ * Parameters: A Threadpool
+ * Returns: The number of workers, including the caller
+ *
+ * Expected input: A valid Threadpool
+ * Success output: The number of workers the pool was created with
+ * Failure output: Raises a Checked Runtime Error if pool is NULL
+ */
+int threadpool_workers(Threadpool pool)
+{
+    assert(pool != NULL);
+    return pool->workers;
+}
+
+/* threadpool_run
+ * Purpose: Runs a task on every worker and waits for all of them
+ * Parameters: A Threadpool, a task, and a closure for the task
+ * Returns: nothing
+ *
+ * Expected input: A valid Threadpool and task
+ * Success output: task has returned on every worker
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void threadpool_run(Threadpool pool, Threadpool_task *task, void *cl)
+{
+    assert(pool != NULL);
+    assert(task != NULL);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->cl = cl;
+    pool->running = pool->workers - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    task(0, pool->workers, cl);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/* worker_loop
+ * Purpose: Body of every worker thread. Waits for a new task, runs it,
+ *          and reports back until the pool is stopped.
+ * Parameters: A worker_start struct, which this function frees
+ * Returns: NULL
+ *
+ * Expected input: A valid worker_start struct
+ * Success output: none
+ * Failure output: none
+ */
+void *worker_loop(void *arg)
+{
+    struct worker_start start = *(struct worker_start *)arg;
+    free(arg);
+
+    Threadpool pool = start.pool;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        while (pool->generation == seen && !pool->stopping) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->stopping) {
+            break;
+        }
+
+        seen = pool->generation;
+        Threadpool_task *task = pool->task;
+        void *cl = pool->cl;
+        pthread_mutex_unlock(&pool->lock);
+
+        task(start.worker, pool->workers, cl);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->running--;
+        if (pool->running == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
@@ -0,0 +1,73 @@
+/**************************************************************
+ *
+ *                     threadpool.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     This file is the interface of our threadpool class. A
+ *     Threadpool keeps a fixed set of worker threads alive for the
+ *     length of an image and runs the same task on every worker at
+ *     once, each worker picking its share of the work from its
+ *     worker number. The calling thread acts as worker 0.
+ *
+ **************************************************************/
+#ifndef THREADPOOL_INCLUDED
+#define THREADPOOL_INCLUDED
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct Threadpool *Threadpool;
+
+/* A task is called once per worker with its worker number, the total
+ * number of workers, and the closure passed to threadpool_run */
+typedef void Threadpool_task(int worker, int workers, void *cl);
+
+/* threadpool_new
+ * Purpose: Starts a pool of worker threads
+ * Parameters: The total number of workers, including the caller
+ * Returns: A Threadpool
+ *
+ * Expected input: A number of workers of at least 1
+ * Success output: A pool with workers - 1 idle threads
+ * Failure output: Raises a Checked Runtime Error if workers < 1 or a
+ *                  thread cannot be started
+ */
+Threadpool threadpool_new(int workers);
+
+/* threadpool_free
+ * Purpose: Stops and joins every worker thread and frees the pool
+ * Parameters: A pointer to a Threadpool
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid, idle Threadpool
+ * Success output: The pool is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if pool is NULL
+ */
+void threadpool_free(Threadpool *pool);
+
+/* threadpool_workers
+ * Purpose: Returns the number of workers in a pool
+ * Parameters: A Threadpool
+ * Returns: The number of workers, including the caller
+ *
+ * Expected input: A valid Threadpool
+ * Success output: The number of workers the pool was created with
+ * Failure output: Raises a Checked Runtime Error if pool is NULL
+ */
+int threadpool_workers(Threadpool pool);
+
+/* threadpool_run
+ * Purpose: Runs a task on every worker and waits for all of them
+ * Parameters: A Threadpool, a task, and a closure for the task
+ * Returns: nothing
+ *
+ * Expected input: A valid Threadpool and task
+ * Success output: task has returned on every worker
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void threadpool_run(Threadpool pool, Threadpool_task *task, void *cl);
+
+#endif
@@ -1,72 +1,91 @@
 #line 50 "www/solutions/uarray2.nw"
+#include <string.h>
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
 #include "uarray2.h"
+#include "uarray2rep.h"
+#include "imagearena.h"
 
 #define T UArray2_T
 
-/* 
- * Element (i, j) in the world of ideas maps to
- * rows[j][i] where the square brackets stand for access
- * to a Hanson UArray_T
- */
-struct T {
-        int width, height;
-        int size;
-        UArray_T rows; /* UArray_T of 'height' UArray_Ts,
-                          each of length 'width' and size 'size' */
-};
+/* the representation is in uarray2rep.h */
 #line 79 "www/solutions/uarray2.nw"
-static inline UArray_T row(T a, int j)
+static inline char *row(T a, int j)
 {
-        UArray_T *prow = UArray_at(a->rows, j);   /* Ramsey idiom */
-        return *prow;
+        return a->cells + (size_t)j * a->stride;
 }
 #line 92 "www/solutions/uarray2.nw"
 static int is_ok(T a)
 {
-        return a && UArray_length(a->rows) == a->height &&
-               UArray_size(a->rows) == sizeof(UArray_T) &&
-               (a->height == 0 || (UArray_length(row(a, 0)) == a->width
-                                   && UArray_size  (row(a, 0)) == a->size));
+        return a && a->width >= 0 && a->height >= 0 && a->size > 0 &&
+               a->stride == (size_t)a->width * a->size &&
+               a->cells != NULL;
+}
+
+/* storage comes from the selected image arena when there is one */
+static void *storage(Image_arena arena, size_t bytes)
+{
+        if (arena != NULL)
+                return image_arena_alloc(arena, bytes);
+        void *p = ALLOC(bytes > 0 ? bytes : 1);
+        memset(p, 0, bytes);
+        return p;
 }
 #line 109 "www/solutions/uarray2.nw"
 T UArray2_new(int width, int height, int size)
 {
-        int i;  /* interates over row number */
         T array;
         NEW(array);
         array->width  = width;
         array->height = height;
         array->size   = size;
-        array->rows   = UArray_new(height, sizeof(UArray_T));
-        for (i = 0; i < height; i++) {
-                UArray_T *rowp = UArray_at(array->rows, i);
-                *rowp = UArray_new(width, size);
-        }
+        assert(width >= 0 && height >= 0 && size > 0);
+        array->arena  = image_arena_selected();
+        /* one allocation for every cell; rows are stride bytes apart,
+         * which UArray2_shrink leaves alone, so a narrowed array has a
+         * gap after each row */
+        array->stride = (size_t)width * size;
+        array->cells  = storage(array->arena,
+                                array->stride * (size_t)height);
         assert(is_ok(array));
         return array;
 }
 #line 131 "www/solutions/uarray2.nw"
 void UArray2_free(T *array2)
 {
-        int i;
         assert(array2 && *array2);
-        for (i = 0; i < (*array2)->height; i++) {
-                UArray_T p = row(*array2, i);
-                UArray_free(&p);
-        }
-        UArray_free(&(*array2)->rows);
+        /* an arena takes its storage back all at once when reset */
+        if ((*array2)->arena == NULL)
+                FREE((*array2)->cells);
         FREE(*array2);
 }
 #line 151 "www/solutions/uarray2.nw"
 void *UArray2_at(T array2, int i, int j)
 {
         assert(array2);
-        return UArray_at(row(array2, j), i);
+        assert(i >= 0 && i < array2->width);
+        assert(j >= 0 && j < array2->height);
+        return row(array2, j) + (size_t)i * array2->size;
 }
 #line 162 "www/solutions/uarray2.nw"
+void UArray2_shrink(T array2, int width, int height)
+{
+        assert(array2);
+        assert(width >= 0 && width <= array2->width);
+        assert(height >= 0 && height <= array2->height);
+        array2->width  = width;
+        array2->height = height;
+}
+
+void *UArray2_row(T array2, int j, int *length)
+{
+        assert(array2);
+        assert(j >= 0 && j < array2->height);
+        if (length != NULL)
+                *length = array2->width;
+        return row(array2, j);
+}
+
 int UArray2_height(T array2)
 {
         assert(array2);
@@ -94,10 +113,11 @@ void UArray2_map_row_major(T array2,
         int h = array2->height;  /* keeping height and width in registers */
         int w = array2->width;   /* avoids extra memory traffic           */
         for (int j = 0; j < h; j++) {
-                /* don't want row/UArray_at in inner loop */
-                UArray_T thisrow = row(array2, j); 
+                /* don't want row lookup in inner loop */
+                char *thisrow = row(array2, j);
+                int size = array2->size;
                 for (int i = 0; i < w; i++)
-                        apply(i, j, array2, UArray_at(thisrow, i), cl);
+                        apply(i, j, array2, thisrow + (size_t)i * size, cl);
         }
 }
 #line 211 "www/solutions/uarray2.nw"
@@ -111,5 +131,16 @@ void UArray2_map_col_major(T array2,
         int w = array2->width;   /* avoids extra memory traffic           */
         for (int i = 0; i < w; i++)
                 for (int j = 0; j < h; j++)
-                        apply(i, j, array2, UArray_at(row(array2, j), i), cl);
-}
\ No newline at end of file
+                        apply(i, j, array2,
+                              row(array2, j) + (size_t)i * array2->size,
+                              cl);
+}
+
+void UArray2_map_rows(T array2, UArray2_rowfun apply, void *cl)
+{
+        assert(array2);
+        assert(apply);
+        int h = array2->height;
+        for (int j = 0; j < h; j++)
+                apply(j, array2, row(array2, j), array2->width, cl);
+}
@@ -0,0 +1,64 @@
+#ifndef UARRAY2_INCLUDED
+#define UARRAY2_INCLUDED
+
+#define T UArray2_T
+typedef struct T *T;
+
+typedef void UArray2_applyfun(int i, int j, T array2, void *elem, void *cl);
+
+/* 
+ * new 2d array of width * height cells, each of 'size' bytes
+ * and initially zero
+ */
+extern T     UArray2_new (int width, int height, int size);
+extern void  UArray2_free(T *array2);
+
+extern int   UArray2_width (T array2);
+extern int   UArray2_height(T array2);
+extern int   UArray2_size  (T array2);
+
+/* return a pointer to the cell in the given column and row.
+ * index out of range is a checked run-time error
+ */
+extern void *UArray2_at(T array2, int i, int j);
+
+/* 
+ * narrows the array to its first 'width' columns and 'height' rows
+ * without moving or copying any cell; cells outside the new bounds
+ * are kept until the array is freed.  growing the array is a
+ * checked run-time error
+ */
+extern void  UArray2_shrink(T array2, int width, int height);
+
+/* 
+ * return a pointer to the first cell of row j.  the row's 'width'
+ * cells are contiguous, 'size' bytes apart, and if length is not
+ * NULL *length is set to that width.  all the rows share a single
+ * allocation, so the pointer stays valid until the array is freed,
+ * but after UArray2_shrink there is a gap after each row, so row
+ * j + 1 need not start where row j ends.
+ * row out of range is a checked run-time error
+ */
+extern void *UArray2_row(T array2, int j, int *length);
+
+extern void  UArray2_map_row_major(T array2, UArray2_applyfun apply,
+                                   void *cl);
+extern void  UArray2_map_col_major(T array2, UArray2_applyfun apply,
+                                   void *cl);
+
+/* 
+ * calls apply once per row, top to bottom, with the row number, a
+ * pointer to the row's first cell and the number of cells in the
+ * row, so the apply function can run its own loop over the row
+ */
+typedef void UArray2_rowfun(int j, T array2, void *row, int length,
+                            void *cl);
+extern void  UArray2_map_rows(T array2, UArray2_rowfun apply, void *cl);
+
+/* 
+ * it is a checked run-time error to pass a NULL T
+ * to any function in this interface 
+ */
+
+#undef T
+#endif
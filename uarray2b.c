@@ -1,81 +1,110 @@
 #line 59 "www/solutions/uarray2b.nw"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include "assert.h"
 #include "mem.h"
-#include "uarray.h"
-#include "uarray2.h"
 #include "uarray2b.h"
+#include "imagearena.h"
 
 #define T UArray2b_T
 
+/* every block starts on a cache line */
+#define BLOCK_ALIGN 64
+/* slabs of at least this many bytes are aligned to a huge page */
+#define HUGE_PAGE (2 * 1024 * 1024)
+
 struct T { /* represents a 2D array of cells each of size 'size' */
         int width, height;
         unsigned blocksize;
         unsigned size;
-        UArray2_T blocks;
+        int shift;      /* log2 of blocksize, or -1 if it is not a
+                           power of two */
+        unsigned mask;  /* blocksize - 1 */
+        int xblocks, yblocks;
+        size_t block_bytes; /* from one block to the next */
+        char *slab;
+        Image_arena arena; /* owner of the slab, or NULL if malloc'd */
         /*
-         * matrix of blocks, each blocksize * blocksize 
-         *
-         * matrix dimensions are width and height divided by blocksize,
-         * rounded up
+         * xblocks * yblocks blocks, each blocksize * blocksize cells,
+         * carved one row of blocks after another out of a single
+         * slab: block (bx, by) starts at
+         * slab + (by * xblocks + bx) * block_bytes
          *
-         * a block is a Uarray_T of length blocksize * blocksize 
-         * and size 'size'
+         * xblocks and yblocks are width and height divided by
+         * blocksize, rounded up
          *
-         * invariant relating cells in blocks to cells in the abstraction
-         *  described in section on coordinate transformations below
+         * a block is a char * to blocksize * blocksize cells of size
+         * 'size', one row of the block after another, so cell (i, j)
+         * is cell (j % blocksize) * blocksize + i % blocksize of block
+         * (i / blocksize, j / blocksize).  when blocksize is a power
+         * of two the divisions are shifts and the remainders masks
          */
 };
-#line 94 "www/solutions/uarray2b.nw"
-#include <stdio.h>  /* include so we can print diagnostics */
 
+/* 
+ * the slab comes from the selected image arena when there is one.
+ * otherwise it is aligned to a cache line, or to a huge page when it
+ * is big enough to fill one, and the kernel is asked to back it with
+ * huge pages so a walk over the blocks needs fewer TLB entries
+ */
+static char *slab_new(Image_arena arena, size_t bytes)
+{
+        if (arena != NULL)
+                return image_arena_alloc(arena, bytes);
+        size_t align = bytes >= HUGE_PAGE ? HUGE_PAGE : BLOCK_ALIGN;
+        void *slab = NULL;
+        int failed = posix_memalign(&slab, align,
+                                    bytes > 0 ? bytes : BLOCK_ALIGN);
+        assert(!failed);
+#ifdef MADV_HUGEPAGE
+        if (align == HUGE_PAGE)
+                madvise(slab, bytes, MADV_HUGEPAGE);   /* only a hint */
+#endif
+        memset(slab, 0, bytes);
+        return slab;
+}
+
+static inline char *block(T a, int bx, int by)
+{
+        return a->slab + (size_t)(by * a->xblocks + bx) * a->block_bytes;
+}
+
+#line 94 "www/solutions/uarray2b.nw"
 T UArray2b_new(int width, int height, int size, int blocksize)
 {
         assert(blocksize > 0);
+        assert(width >= 0 && height >= 0 && size > 0);
         T array;
         NEW(array);
         array->width  = width;
         array->height = height;
         array->size   = size;
         array->blocksize = blocksize;
-        array->blocks = UArray2_new((width  + blocksize - 1) / blocksize,
-                                    (height + blocksize - 1) / blocksize,
-                                    sizeof(UArray_T));
-        int xblocks = UArray2_width (array->blocks); 
-        int yblocks = UArray2_height(array->blocks);
-        for (int i = 0; i < xblocks; i++) {
-                for (int j = 0; j < yblocks; j++) {
-                        UArray_T *block = UArray2_at(array->blocks, i, j);
-                        *block = UArray_new(blocksize * blocksize, size);
-                        
-#line 169 "www/solutions/uarray2b.nw"
-if (0) {
-        fprintf(stderr, "Allocated %p; put %p at %p\n",
-                (void *)*block, (void *)*(UArray_T*)UArray2_at(array->blocks,
-                                                                         i, j),
-                UArray2_at(array->blocks, i, j));
-}
-#line 115 "www/solutions/uarray2b.nw"
-                                  }
-        }
+        array->mask   = blocksize - 1;
+        array->shift  = -1;
+        if ((blocksize & (blocksize - 1)) == 0)
+                for (array->shift = 0; (1 << array->shift) < blocksize; )
+                        array->shift++;
+        array->arena = image_arena_selected();
+        array->xblocks = (width  + blocksize - 1) / blocksize;
+        array->yblocks = (height + blocksize - 1) / blocksize;
+        size_t bytes = (size_t)blocksize * blocksize * size;
+        array->block_bytes = (bytes + BLOCK_ALIGN - 1)
+                             & ~(size_t)(BLOCK_ALIGN - 1);
+        array->slab = slab_new(array->arena, array->block_bytes
+                               * array->xblocks * array->yblocks);
         return array;
 }
 #line 124 "www/solutions/uarray2b.nw"
 void UArray2b_free(T *array2b)
 {
-        int i;
         assert(array2b && *array2b);
-        T array = *array2b;
-        int xblocks = UArray2_width (array->blocks);
-        int yblocks = UArray2_height(array->blocks);
-        assert(UArray2_size(array->blocks) == sizeof(UArray_T));
-        for (i = 0; i < xblocks; i++) {
-                for (int j = 0; j < yblocks; j++) {
-                        UArray_T *p = UArray2_at(array->blocks, i, j);
-                        UArray_free(p);
-                }
-        }
-        UArray2_free(&(*array2b)->blocks);
+        /* one free for the whole slab; an arena takes it back when
+           it is reset */
+        if ((*array2b)->arena == NULL)
+                free((*array2b)->slab);
         FREE(*array2b);
 }
 #line 148 "www/solutions/uarray2b.nw"
@@ -96,14 +125,40 @@ T UArray2b_new_64K_block(int width, int height, int size)
 #line 200 "www/solutions/uarray2b.nw"
 void *UArray2b_at(T array2b, int i, int j)
 {
+        assert(array2b);
         assert(i >= 0 && j >= 0);
         /* avoid unused cells */
         assert(i < array2b->width && j < array2b->height);
-        int b  = array2b->blocksize;
-        int bx = i / b;   /* block x coordinate */
-        int by = j / b;   /* block y coordinate */
-        UArray_T *blockp = UArray2_at(array2b->blocks, bx, by);
-        return UArray_at(*blockp, (i % b) * b + j % b);
+        int      shift = array2b->shift;
+        unsigned mask  = array2b->mask;
+        if (shift >= 0)
+                return block(array2b, i >> shift, j >> shift)
+                       + (size_t)(((j & mask) << shift) | (i & mask))
+                         * array2b->size;
+        int b = array2b->blocksize;
+        return block(array2b, i / b, j / b)
+               + (size_t)((j % b) * b + i % b) * array2b->size;
+}
+
+void *UArray2b_span(T array2b, int i, int j, int *length)
+{
+        assert(length);
+        char *cell = UArray2b_at(array2b, i, j);
+        int   b    = array2b->blocksize;
+        int   end  = (i / b + 1) * b;   /* first column of the next block */
+        if (end > array2b->width)
+                end = array2b->width;
+        *length = end - i;
+        return cell;
+}
+
+void UArray2b_shrink(T array2b, int width, int height)
+{
+        assert(array2b);
+        assert(width >= 0 && width <= array2b->width);
+        assert(height >= 0 && height <= array2b->height);
+        array2b->width  = width;
+        array2b->height = height;
 }
 #line 222 "www/solutions/uarray2b.nw"
 void UArray2b_map(T array2b, 
@@ -112,34 +167,52 @@ void UArray2b_map(T array2b,
                   void *cl)
 {
         assert(array2b);
-        int       h      = array2b->height;
-        int       w      = array2b->width;
-        int       b      = array2b->blocksize;
-        UArray2_T blocks = array2b->blocks;
-        int       bw     = UArray2_width(blocks);
-        int       bh     = UArray2_height(blocks);
+        int h    = array2b->height;
+        int w    = array2b->width;
+        int b    = array2b->blocksize;
+        int size = array2b->size;
 
-        for (int bx = 0; bx < bw; bx++) {
-                for (int by = 0; by < bh; by++) {
-                        UArray_T *blockp = UArray2_at(blocks, bx, by);
-                        UArray_T  block  = *blockp;
-                        int       len    = UArray_length(block);
+        for (int by = 0; by < array2b->yblocks; by++) {
+                for (int bx = 0; bx < array2b->xblocks; bx++) {
+                        char *cells = block(array2b, bx, by);
                         /* (i0, j0) correspond to upper left */
                         /* corner of block (bx, by)          */
                         int i0 = b * bx; 
                         int j0 = b * by; 
-                        for (int cell = 0; cell < len; cell++) {
-                                int i = i0 + cell / b;
-                                int j = j0 + cell % b;
-                                /* measured overhead 0.5% to 1.5% */
-                                if (i < w && j < h) {
-                                        apply(i, j, array2b, 
-                                              UArray_at(block, cell), cl);
-                                }
+                        int bw = w - i0 < b ? w - i0 : b;
+                        int bh = h - j0 < b ? h - j0 : b;
+                        /* unused cells are skipped, not tested */
+                        for (int r = 0; r < bh; r++) {
+                                char *row = cells + (size_t)r * b * size;
+                                for (int c = 0; c < bw; c++)
+                                        apply(i0 + c, j0 + r, array2b,
+                                              row + (size_t)c * size, cl);
                         }
                 }
         }
 }
+
+void UArray2b_map_blocks(T array2b, UArray2b_blockfun apply, void *cl)
+{
+        assert(array2b);
+        assert(apply);
+        int h = array2b->height;
+        int w = array2b->width;
+        int b = array2b->blocksize;
+
+        for (int by = 0; by < array2b->yblocks; by++) {
+                for (int bx = 0; bx < array2b->xblocks; bx++) {
+                        int i0 = b * bx;
+                        int j0 = b * by;
+                        int bw = w - i0 < b ? w - i0 : b;
+                        int bh = h - j0 < b ? h - j0 : b;
+                        /* blocks left empty by shrink have no cells */
+                        if (bw > 0 && bh > 0)
+                                apply(i0, j0, bw, bh, array2b,
+                                      block(array2b, bx, by), cl);
+                }
+        }
+}
 #line 269 "www/solutions/uarray2b.nw"
 int UArray2b_height(T array2b)
 {
@@ -164,4 +237,4 @@ int UArray2b_blocksize(T array2b)
         return array2b->blocksize;
 }
 #line 296 "www/solutions/uarray2b.nw"
-int UArray2b_version_uses_UArray2_T = 1;
\ No newline at end of file
+int UArray2b_version_uses_UArray2_T = 0;
\ No newline at end of file
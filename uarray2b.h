@@ -28,12 +28,41 @@ extern int   UArray2b_blocksize(T  array2b);
  */
 extern void *UArray2b_at(T array2b, int column, int row);
 
+/* return a pointer to the cell in the given column and row, and set
+ * *length to the number of cells from it to the end of its row of
+ * its block (or of the array, if that comes first).  those cells are
+ * contiguous, 'size' bytes apart.  index out of range is a checked
+ * run-time error
+ */
+extern void *UArray2b_span(T array2b, int column, int row, int *length);
+
+/* 
+ * narrows the array to its first 'width' columns and 'height' rows
+ * without moving or copying any cell.  growing the array is a
+ * checked run-time error
+ */
+extern void  UArray2b_shrink(T array2b, int width, int height);
+
 /* visits every cell in one block before moving to another block */
 extern void  UArray2b_map(T array2b, 
                           void apply(int col, int row, T array2b,
                                      void *elem, void *cl), 
                           void *cl);
 
+/* 
+ * calls apply once per block, one row of blocks after another, with
+ * the column and row of the block's upper left cell, the number of
+ * columns and rows of the block that are inside the array, and a
+ * pointer to that cell.  the cells of a block are stored one row of
+ * the block after another: cell (col + c, row + r) is
+ * (r * blocksize + c) * size bytes past the pointer.  when blocksize
+ * is a power of two, indexing is done with shifts and masks
+ */
+typedef void UArray2b_blockfun(int col, int row, int width, int height,
+                               T array2b, void *block, void *cl);
+extern void  UArray2b_map_blocks(T array2b, UArray2b_blockfun apply,
+                                 void *cl);
+
 /* 
  * it is a checked run-time error to pass a NULL T
  * to any function in this interface 
@@ -0,0 +1,25 @@
+#ifndef UARRAY2REP_INCLUDED
+#define UARRAY2REP_INCLUDED
+
+#include "imagearena.h"
+
+#define T UArray2_T
+
+/* 
+ * the representation of a UArray2, shared by uarray2.c and the
+ * inline row access of plainrows.h.  All the cells live in one
+ * allocation, row after row.  Element (i, j) in the world of ideas
+ * maps to cells + j * stride + i * size
+ */
+struct T {
+        int width, height;
+        int size;
+        size_t stride; /* bytes from one row to the next: the original
+                          width times size, which shrink leaves alone */
+        char *cells;   /* 'height' rows of 'width' elements of size
+                          'size', each 'stride' bytes from the last */
+        Image_arena arena; /* owner of cells, or NULL if malloc'd */
+};
+
+#undef T
+#endif
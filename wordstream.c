@@ -0,0 +1,580 @@
+/**************************************************************
+ *
+ *                     wordstream.c
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     Implementation of the wordstream class.
+ *
+ **************************************************************/
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "wordstream.h"
+#include "simd.h"
+
+/* Bytes a writer buffers before handing them to the output */
+#define WRITER_BUFFER_BYTES (256 * 1024)
+
+struct Word_writer {
+    FILE *output;
+    Word_output how;
+    size_t total, written;          /* words promised and words given */
+
+    /* WORDS_STDIO and WORDS_WRITE swap into buffer */
+    unsigned char *buffer;
+    size_t filled;
+
+    /* WORDS_MMAP swaps straight into the mapped file */
+    unsigned char *map;
+    size_t map_length, map_skip;    /* map_skip: bytes before the body */
+    off_t body_end;
+};
+
+struct Word_reader {
+    FILE *input;
+    size_t total, read;             /* words in the body and words read */
+
+    /* A mapped reader swaps words out of map; NULL means fread */
+    unsigned char *map;
+    size_t map_length, map_skip;    /* map_skip: bytes before the body */
+    off_t body_start;
+};
+
+void words_to_big_endian_scalar(const uint32_t *words, int count,
+                                unsigned char *bytes);
+#ifdef HAVE_AVX2_KERNELS
+void words_to_big_endian_avx2(const uint32_t *words, int count,
+                              unsigned char *bytes);
+#endif
+void words_from_big_endian_scalar(const unsigned char *bytes, int count,
+                                  uint32_t *words);
+#ifdef HAVE_AVX2_KERNELS
+void words_from_big_endian_avx2(const unsigned char *bytes, int count,
+                                uint32_t *words);
+#endif
+void flush_writer(Word_writer writer);
+void write_fully(int fd, const unsigned char *bytes, size_t length);
+bool map_output(Word_writer writer);
+bool map_input(Word_reader reader);
+
+/* words_to_big_endian
+ * Purpose: Stores words as big-endian bytes, 4 per word. Uses an AVX2
+ *          byte shuffle on 8 words at a time when the CPU supports it.
+ * Parameters: An array of words, the number of words, and an array
+ *             for the bytes
+ * Returns: nothing
+ *
+ * Expected input: Arrays holding at least count words and 4 * count
+ *                 bytes
+ * Success output: bytes[4 * i] is the most significant byte of words[i]
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void words_to_big_endian(const uint32_t *words, int count,
+                         unsigned char *bytes)
+{
+    assert(count == 0 || (words != NULL && bytes != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        words_to_big_endian_avx2(words, count, bytes);
+        return;
+    }
+#endif
+
+    words_to_big_endian_scalar(words, count, bytes);
+}
+
+/* words_from_big_endian
+ * Purpose: Builds words from big-endian bytes, 4 per word. Uses an
+ *          AVX2 byte shuffle on 8 words at a time when the CPU
+ *          supports it.
+ * Parameters: An array of bytes, the number of words, and an array
+ *             for the words
+ * Returns: nothing
+ *
+ * Expected input: Arrays holding at least 4 * count bytes and count
+ *                 words. bytes need not be aligned, and may be the
+ *                 same memory as words to swap in place.
+ * Success output: words[i] is built from bytes[4 * i] to
+ *                 bytes[4 * i + 3], most significant byte first
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void words_from_big_endian(const unsigned char *bytes, int count,
+                           uint32_t *words)
+{
+    assert(count == 0 || (bytes != NULL && words != NULL));
+
+#ifdef HAVE_AVX2_KERNELS
+    if (cpu_has_avx2()) {
+        words_from_big_endian_avx2(bytes, count, words);
+        return;
+    }
+#endif
+
+    words_from_big_endian_scalar(bytes, count, words);
+}
+
+/* word_writer_new
+ * Purpose: Returns a writer for the body of a compressed image. The
+ *          header must already have been written to output.
+ * Parameters: A file pointer, the number of words the body will
+ *             hold, and how to write them
+ * Returns: A Word_writer
+ *
+ * Expected input: A writable file positioned just past the header
+ * Success output: A writer ready for word_write_row. A WORDS_MMAP
+ *                 writer whose output cannot be mapped warns on stderr
+ *                 and writes with stdio instead.
+ * Failure output: Raises a Checked Runtime Error if output is NULL or
+ *                 allocation fails
+ */
+Word_writer word_writer_new(FILE *output, size_t total_words,
+                            Word_output how)
+{
+    assert(output != NULL);
+
+    Word_writer writer = malloc(sizeof(struct Word_writer));
+    assert(writer);
+
+    writer->output = output;
+    writer->how = how;
+    writer->total = total_words;
+    writer->written = 0;
+    writer->buffer = NULL;
+    writer->filled = 0;
+    writer->map = NULL;
+
+    /* An empty body needs no map, so only warn when there are words */
+    if (how == WORDS_MMAP && !map_output(writer)) {
+        if (total_words > 0) {
+            fprintf(stderr, "wordstream: cannot map the output (it must "
+                            "be a regular file open for reading and "
+                            "writing, such as 1<>file); using stdio\n");
+        }
+        writer->how = WORDS_STDIO;
+    }
+
+    if (writer->how != WORDS_MMAP) {
+        writer->buffer = malloc(WRITER_BUFFER_BYTES);
+        assert(writer->buffer);
+    }
+
+    /* write goes around stdio, so the header has to be out first */
+    if (writer->how == WORDS_WRITE) {
+        fflush(output);
+    }
+
+    return writer;
+}
+
+/* word_writer_free
+ * Purpose: Writes out anything still buffered and frees the writer.
+ *          Does not close the file.
+ * Parameters: A pointer to a Word_writer
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Word_writer
+ * Success output: Every word given to the writer is in the output and
+ *                 the writer is set to NULL
+ * Failure output: Raises a Checked Runtime Error if writer is NULL or
+ *                 the output cannot be written
+ */
+void word_writer_free(Word_writer *writer)
+{
+    assert(writer != NULL && *writer != NULL);
+    Word_writer w = *writer;
+
+    if (w->how == WORDS_MMAP) {
+        munmap(w->map, w->map_length);
+
+        /* Leave the stream just past the body, as a write would */
+        int moved = fseeko(w->output, w->body_end, SEEK_SET);
+        assert(moved == 0);
+    } else {
+        flush_writer(w);
+    }
+
+    free(w->buffer);
+    free(w);
+    *writer = NULL;
+}
+
+/* word_write_row
+ * Purpose: Adds a row of words to the output in big-endian order
+ * Parameters: A Word_writer, an array of words, and the number of
+ *             words in it
+ * Returns: nothing
+ *
+ * Expected input: A valid writer that has been given no more than
+ *                 total_words words in all
+ * Success output: The words follow the ones written before them
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL,
+ *                 the writer overflows, or the output cannot be written
+ */
+void word_write_row(Word_writer writer, const uint32_t *words, int count)
+{
+    assert(writer != NULL);
+    assert(words != NULL || count == 0);
+    assert(writer->written + count <= writer->total);
+
+    if (writer->how == WORDS_MMAP) {
+        words_to_big_endian(words, count, writer->map + writer->map_skip
+                                                  + 4 * writer->written);
+        writer->written += count;
+        return;
+    }
+
+    while (count > 0) {
+        size_t room = (WRITER_BUFFER_BYTES - writer->filled) / 4;
+        if (room == 0) {
+            flush_writer(writer);
+            continue;
+        }
+
+        int chunk = (size_t)count < room ? count : (int)room;
+        words_to_big_endian(words, chunk, writer->buffer + writer->filled);
+        writer->filled += 4 * (size_t)chunk;
+        writer->written += chunk;
+
+        words += chunk;
+        count -= chunk;
+    }
+}
+
+/* word_reader_new
+ * Purpose: Returns a reader for the body of a compressed image. The
+ *          header must already have been read from input.
+ * Parameters: A file pointer and the number of words the body holds
+ * Returns: A Word_reader
+ *
+ * Expected input: A readable file positioned just past the header
+ * Success output: A reader ready for word_read_row
+ * Failure output: Raises a Checked Runtime Error if input is NULL or
+ *                 allocation fails
+ */
+Word_reader word_reader_new(FILE *input, size_t total_words)
+{
+    assert(input != NULL);
+
+    Word_reader reader = malloc(sizeof(struct Word_reader));
+    assert(reader);
+
+    reader->input = input;
+    reader->total = total_words;
+    reader->read = 0;
+    reader->map = NULL;
+
+    map_input(reader);
+
+    return reader;
+}
+
+/* word_reader_free
+ * Purpose: Frees a reader. Does not close the file.
+ * Parameters: A pointer to a Word_reader
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Word_reader
+ * Success output: The reader is freed and set to NULL
+ * Failure output: Raises a Checked Runtime Error if reader is NULL
+ */
+void word_reader_free(Word_reader *reader)
+{
+    assert(reader != NULL && *reader != NULL);
+    Word_reader r = *reader;
+
+    if (r->map != NULL) {
+        munmap(r->map, r->map_length);
+
+        /* Leave the stream just past the words read, as fread would */
+        int moved = fseeko(r->input, r->body_start + 4 * (off_t)r->read,
+                                                               SEEK_SET);
+        assert(moved == 0);
+    }
+
+    free(r);
+    *reader = NULL;
+}
+
+/* word_read_row
+ * Purpose: Reads the next row of words of the body. A mapped reader
+ *          swaps them out of the mapping; otherwise the bytes are
+ *          read straight into words with one fread and swapped there.
+ * Parameters: A Word_reader, an array for the words, and the number
+ *             of words to read
+ * Returns: nothing
+ *
+ * Expected input: A valid reader that has been asked for no more than
+ *                 total_words words in all, and an array with room
+ *                 for count words
+ * Success output: words holds the next count words of the body
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL,
+ *                 the reader is asked for too many words, or the file
+ *                 ends before the row does
+ */
+void word_read_row(Word_reader reader, uint32_t *words, int count)
+{
+    assert(reader != NULL);
+    assert(words != NULL || count == 0);
+    assert(reader->read + count <= reader->total);
+
+    if (reader->map != NULL) {
+        words_from_big_endian(reader->map + reader->map_skip
+                                          + 4 * reader->read, count, words);
+        reader->read += count;
+        return;
+    }
+
+    size_t got = fread(words, 4, count, reader->input);
+    assert(got == (size_t)count);    /* the body is cut short */
+
+    words_from_big_endian((unsigned char *)words, count, words);
+    reader->read += count;
+}
+
+/* words_to_big_endian_scalar
+ * Purpose: Reference version of words_to_big_endian
+ * Parameters: Same as words_to_big_endian
+ * Returns: nothing
+ *
+ * Expected input: Same as words_to_big_endian
+ * Success output: Same as words_to_big_endian
+ * Failure output: none
+ */
+void words_to_big_endian_scalar(const uint32_t *words, int count,
+                                unsigned char *bytes)
+{
+    for (int i = 0; i < count; i++, bytes += 4) {
+        bytes[0] = words[i] >> 24;
+        bytes[1] = words[i] >> 16;
+        bytes[2] = words[i] >> 8;
+        bytes[3] = words[i];
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* words_to_big_endian_avx2
+ * Purpose: AVX2 version of words_to_big_endian. One byte shuffle
+ *          reverses the bytes of 8 words at once.
+ * Parameters: Same as words_to_big_endian
+ * Returns: nothing
+ *
+ * Expected input: Same as words_to_big_endian, on a CPU with AVX2
+ * Success output: Same as words_to_big_endian
+ * Failure output: none
+ */
+AVX2_KERNEL
+void words_to_big_endian_avx2(const uint32_t *words, int count,
+                              unsigned char *bytes)
+{
+    const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                             11, 10, 9, 8, 15, 14, 13, 12,
+                                             3, 2, 1, 0, 7, 6, 5, 4,
+                                             11, 10, 9, 8, 15, 14, 13, 12);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&words[i]);
+        _mm256_storeu_si256((__m256i *)&bytes[4 * i],
+                            _mm256_shuffle_epi8(v, reverse));
+    }
+
+    words_to_big_endian_scalar(words + i, count - i, bytes + 4 * i);
+}
+#endif
+
+/* words_from_big_endian_scalar
+ * Purpose: Reference version of words_from_big_endian
+ * Parameters: Same as words_from_big_endian
+ * Returns: nothing
+ *
+ * Expected input: Same as words_from_big_endian
+ * Success output: Same as words_from_big_endian
+ * Failure output: none
+ */
+void words_from_big_endian_scalar(const unsigned char *bytes, int count,
+                                  uint32_t *words)
+{
+    for (int i = 0; i < count; i++, bytes += 4) {
+        /* All four bytes are read before words[i] overwrites them */
+        words[i] = (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16
+                 | (uint32_t)bytes[2] << 8 | bytes[3];
+    }
+}
+
+#ifdef HAVE_AVX2_KERNELS
+/* words_from_big_endian_avx2
+ * Purpose: AVX2 version of words_from_big_endian, using the same
+ *          shuffle as words_to_big_endian_avx2
+ * Parameters: Same as words_from_big_endian
+ * Returns: nothing
+ *
+ * Expected input: Same as words_from_big_endian, on a CPU with AVX2
+ * Success output: Same as words_from_big_endian
+ * Failure output: none
+ */
+AVX2_KERNEL
+void words_from_big_endian_avx2(const unsigned char *bytes, int count,
+                                uint32_t *words)
+{
+    const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                             11, 10, 9, 8, 15, 14, 13, 12,
+                                             3, 2, 1, 0, 7, 6, 5, 4,
+                                             11, 10, 9, 8, 15, 14, 13, 12);
+    int i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)&bytes[4 * i]);
+        _mm256_storeu_si256((__m256i *)&words[i],
+                            _mm256_shuffle_epi8(v, reverse));
+    }
+
+    words_from_big_endian_scalar(bytes + 4 * i, count - i, words + i);
+}
+#endif
+
+/* flush_writer
+ * Purpose: Helper function that hands everything in a writer's buffer
+ *          to the output and empties the buffer
+ * Parameters: A Word_writer
+ * Returns: nothing
+ *
+ * Expected input: A valid WORDS_STDIO or WORDS_WRITE writer
+ * Success output: The buffered bytes are written
+ * Failure output: Raises a Checked Runtime Error if the output cannot
+ *                 be written
+ */
+void flush_writer(Word_writer writer)
+{
+    if (writer->filled == 0) {
+        return;
+    }
+
+    if (writer->how == WORDS_WRITE) {
+        write_fully(fileno(writer->output), writer->buffer, writer->filled);
+    } else {
+        size_t wrote = fwrite(writer->buffer, 1, writer->filled,
+                                                 writer->output);
+        assert(wrote == writer->filled);
+    }
+
+    writer->filled = 0;
+}
+
+/* write_fully
+ * Purpose: Helper function that writes a buffer straight to a file
+ *          descriptor with write, retrying until every byte is out
+ * Parameters: A file descriptor, an array of bytes, and its length
+ * Returns: nothing
+ *
+ * Expected input: A writable file descriptor
+ * Success output: Every byte is written, in order
+ * Failure output: Raises a Checked Runtime Error if write fails
+ */
+void write_fully(int fd, const unsigned char *bytes, size_t length)
+{
+    while (length > 0) {
+        ssize_t wrote = write(fd, bytes, length);
+        assert(wrote > 0);
+
+        bytes += wrote;
+        length -= wrote;
+    }
+}
+
+/* map_output
+ * Purpose: Helper function that sizes the output file to hold the
+ *          whole body and maps the part of it the body goes in
+ * Parameters: A Word_writer
+ * Returns: true if the body was mapped, false if the output cannot be
+ *          mapped and the writer should use stdio instead
+ *
+ * Expected input: A writer whose output has just had its header
+ *                 written
+ * Success output: map, map_length, map_skip and body_end are set
+ * Failure output: none
+ */
+bool map_output(Word_writer writer)
+{
+    struct stat info;
+    int fd = fileno(writer->output);
+
+    fflush(writer->output);
+    off_t start = ftello(writer->output);
+    if (start < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+
+    /* mmap offsets must fall on a page boundary */
+    off_t page = sysconf(_SC_PAGESIZE);
+    off_t base = start - start % page;
+    writer->map_skip = start - base;
+    writer->map_length = writer->map_skip + 4 * writer->total;
+    writer->body_end = start + 4 * (off_t)writer->total;
+
+    /* Size the file first so an empty body still cuts off whatever the
+     * file held before */
+    if (ftruncate(fd, writer->body_end) != 0 || writer->total == 0) {
+        return false;
+    }
+
+    void *map = mmap(NULL, writer->map_length, PROT_READ | PROT_WRITE,
+                                               MAP_SHARED, fd, base);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+
+    writer->map = map;
+    return true;
+}
+
+/* map_input
+ * Purpose: Helper function that maps the body of a reader's input
+ *          read-only, with a hint that it will be read front to back
+ * Parameters: A Word_reader
+ * Returns: true if the body was mapped, false if the input cannot be
+ *          mapped and the reader should use fread instead
+ *
+ * Expected input: A reader whose input has just had its header read
+ * Success output: map, map_length, map_skip and body_start are set
+ * Failure output: none
+ */
+bool map_input(Word_reader reader)
+{
+    struct stat info;
+    int fd = fileno(reader->input);
+
+    /* ftello counts the bytes stdio has buffered but not handed out */
+    off_t start = ftello(reader->input);
+    if (start < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        return false;
+    }
+
+    /* A short body is left to fread, which stops where the file does */
+    off_t body_end = start + 4 * (off_t)reader->total;
+    if (reader->total == 0 || info.st_size < body_end) {
+        return false;
+    }
+
+    /* mmap offsets must fall on a page boundary */
+    off_t page = sysconf(_SC_PAGESIZE);
+    off_t base = start - start % page;
+    size_t length = body_end - base;
+
+    void *map = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, base);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+    madvise(map, length, MADV_SEQUENTIAL);
+
+    reader->map = map;
+    reader->map_length = length;
+    reader->map_skip = start - base;
+    reader->body_start = start;
+    return true;
+}
@@ -0,0 +1,162 @@
+/**************************************************************
+ *
+ *                     wordstream.h
+ *
+ *     Assignment: Arith
+ *     Authors:  Eli Intriligator (eintri01), Max Behrendt (mbehre01)
+ *     Date:     Oct 28, 2021
+ *
+ *     Summary
+ *     This file is the interface of our wordstream class, which
+ *     moves the body of a comp40 compressed image in bulk. A
+ *     Word_writer byte-swaps whole rows of codewords into big-endian
+ *     order in a large buffer and hands the buffer to the output in
+ *     one call, instead of writing each byte on its own. A
+ *     Word_reader does the reverse, reading a whole row of bytes at
+ *     once and swapping them into words where they landed. When its
+ *     input is a regular file it maps the body instead and swaps
+ *     the words straight out of the mapping.
+ *
+ **************************************************************/
+#ifndef WORDSTREAM_INCLUDED
+#define WORDSTREAM_INCLUDED
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <assert.h>
+
+typedef struct Word_writer *Word_writer;
+typedef struct Word_reader *Word_reader;
+
+/* How a Word_writer gets its bytes to the output. WORDS_STDIO writes
+ * each full buffer with fwrite. WORDS_WRITE hands each full buffer
+ * straight to the file descriptor with write, skipping stdio's copy.
+ * WORDS_MMAP maps the rest of the output file and swaps the words
+ * straight into it; it needs an output that is a regular file open for
+ * reading and writing (for example 1<>file). A plain > redirect opens
+ * the file write-only, which cannot be mapped, so WORDS_MMAP then says
+ * so on stderr and falls back to WORDS_STDIO. */
+typedef enum { WORDS_STDIO, WORDS_WRITE, WORDS_MMAP } Word_output;
+
+/* words_to_big_endian
+ * Purpose: Stores words as big-endian bytes, 4 per word. Uses an AVX2
+ *          byte shuffle on 8 words at a time when the CPU supports it.
+ * Parameters: An array of words, the number of words, and an array
+ *             for the bytes
+ * Returns: nothing
+ *
+ * Expected input: Arrays holding at least count words and 4 * count
+ *                 bytes
+ * Success output: bytes[4 * i] is the most significant byte of words[i]
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void words_to_big_endian(const uint32_t *words, int count,
+                         unsigned char *bytes);
+
+/* words_from_big_endian
+ * Purpose: Builds words from big-endian bytes, 4 per word. Uses an
+ *          AVX2 byte shuffle on 8 words at a time when the CPU
+ *          supports it.
+ * Parameters: An array of bytes, the number of words, and an array
+ *             for the words
+ * Returns: nothing
+ *
+ * Expected input: Arrays holding at least 4 * count bytes and count
+ *                 words. bytes need not be aligned, and may be the
+ *                 same memory as words to swap in place.
+ * Success output: words[i] is built from bytes[4 * i] to
+ *                 bytes[4 * i + 3], most significant byte first
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL
+ */
+void words_from_big_endian(const unsigned char *bytes, int count,
+                           uint32_t *words);
+
+/* word_writer_new
+ * Purpose: Returns a writer for the body of a compressed image. The
+ *          header must already have been written to output.
+ * Parameters: A file pointer, the number of words the body will
+ *             hold, and how to write them
+ * Returns: A Word_writer
+ *
+ * Expected input: A writable file positioned just past the header
+ * Success output: A writer ready for word_write_row
+ * Failure output: Raises a Checked Runtime Error if output is NULL or
+ *                 allocation fails
+ */
+Word_writer word_writer_new(FILE *output, size_t total_words,
+                            Word_output how);
+
+/* word_writer_free
+ * Purpose: Writes out anything still buffered and frees the writer.
+ *          Does not close the file.
+ * Parameters: A pointer to a Word_writer
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Word_writer
+ * Success output: Every word given to the writer is in the output and
+ *                 the writer is set to NULL
+ * Failure output: Raises a Checked Runtime Error if writer is NULL or
+ *                 the output cannot be written
+ */
+void word_writer_free(Word_writer *writer);
+
+/* word_write_row
+ * Purpose: Adds a row of words to the output in big-endian order
+ * Parameters: A Word_writer, an array of words, and the number of
+ *             words in it
+ * Returns: nothing
+ *
+ * Expected input: A valid writer that has been given no more than
+ *                 total_words words in all
+ * Success output: The words follow the ones written before them
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL,
+ *                 the writer overflows, or the output cannot be written
+ */
+void word_write_row(Word_writer writer, const uint32_t *words, int count);
+
+/* word_reader_new
+ * Purpose: Returns a reader for the body of a compressed image. The
+ *          header must already have been read from input. If input
+ *          is a regular file holding the whole body, the body is
+ *          mapped read-only and read from the mapping; otherwise the
+ *          reader uses fread.
+ * Parameters: A file pointer and the number of words the body holds
+ * Returns: A Word_reader
+ *
+ * Expected input: A readable file positioned just past the header
+ * Success output: A reader ready for word_read_row
+ * Failure output: Raises a Checked Runtime Error if input is NULL or
+ *                 allocation fails
+ */
+Word_reader word_reader_new(FILE *input, size_t total_words);
+
+/* word_reader_free
+ * Purpose: Frees a reader. Does not close the file.
+ * Parameters: A pointer to a Word_reader
+ * Returns: nothing
+ *
+ * Expected input: A pointer to a valid Word_reader
+ * Success output: The reader is freed and set to NULL. A mapped
+ *                 reader leaves the file just past the words it read.
+ * Failure output: Raises a Checked Runtime Error if reader is NULL
+ */
+void word_reader_free(Word_reader *reader);
+
+/* word_read_row
+ * Purpose: Reads the next row of words of the body
+ * Parameters: A Word_reader, an array for the words, and the number
+ *             of words to read
+ * Returns: nothing
+ *
+ * Expected input: A valid reader that has been asked for no more than
+ *                 total_words words in all, and an array with room
+ *                 for count words
+ * Success output: words holds the next count words of the body
+ * Failure output: Raises a Checked Runtime Error if a pointer is NULL,
+ *                 the reader is asked for too many words, or the file
+ *                 ends before the row does
+ */
+void word_read_row(Word_reader reader, uint32_t *words, int count);
+
+#endif